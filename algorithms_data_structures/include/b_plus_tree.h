@@ -0,0 +1,493 @@
+#pragma once
+#include <algorithm>
+#include <string>
+
+// B+ tree ordered map with the same insert/getValue/deleteKey interface as alg::BST
+// Every node holds many keys in a contiguous array sized to <NodeBytes> (a few cache lines by
+// default), so a lookup touches one node per level instead of one node per key comparison
+// and the tree is only log_B(n) levels deep. Values live in the leaves only and the leaves
+// are linked, so in-order scans never go back up the tree.
+// https://en.wikipedia.org/wiki/B%2B_tree
+
+namespace alg {
+	template <typename KeyT, typename ValueT, int NodeBytes = 512>
+	class BPlusTree {
+	private:
+		class BPlusTreeKeyNotFoundException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "key not found";
+			}
+		} exception_key_not_found;
+
+		struct Node {
+			int count; // number of keys
+		};
+
+		// fit as many entries as possible into NodeBytes, but at least 4
+		// (an enum so the constants are never odr-used)
+		enum {
+			LEAF_ENTRIES = (NodeBytes - 2 * sizeof(void*)) / (sizeof(KeyT) + sizeof(ValueT)),
+			INNER_ENTRIES = (NodeBytes - 2 * sizeof(void*)) / (sizeof(KeyT) + sizeof(void*)),
+			LEAF_CAPACITY = LEAF_ENTRIES < 4 ? 4 : LEAF_ENTRIES,
+			INNER_CAPACITY = INNER_ENTRIES < 4 ? 4 : INNER_ENTRIES,
+			// nodes other than the root never drop below half full
+			LEAF_MINIMUM = LEAF_CAPACITY / 2,
+			INNER_MINIMUM = INNER_CAPACITY / 2
+		};
+
+		struct Leaf : Node {
+			Leaf* next;
+			KeyT keys[LEAF_CAPACITY];
+			ValueT values[LEAF_CAPACITY];
+		};
+
+		// child i holds the keys in [keys[i - 1], keys[i])
+		struct Inner : Node {
+			KeyT keys[INNER_CAPACITY];
+			Node* children[INNER_CAPACITY + 1];
+		};
+
+	// member variables
+	private:
+		Node* m_root;
+		int m_height; // number of inner levels above the leaves
+		int m_size;
+
+	// methods
+	private:
+		static inline Leaf* asLeaf(Node* node) {
+			return static_cast<Leaf*>(node);
+		}
+
+		static inline Inner* asInner(Node* node) {
+			return static_cast<Inner*>(node);
+		}
+
+		/* Index of the first of the <count> sorted keys that is greater than <key>
+		* Note: branchless binary search; the loop only depends on count, so it compiles to
+		* conditional moves instead of hard to predict branches
+		*/
+		static inline int upperBound(const KeyT* keys, int count, const KeyT& key) {
+			if (count == 0) return 0;
+
+			const KeyT* base = keys;
+			while (count > 1) {
+				int half = count / 2;
+				base = (key < base[half]) ? base : base + half;
+				count -= half;
+			}
+			return (int)(base - keys) + !(key < *base);
+		}
+
+		/* Index of the first of the <count> sorted keys that is not less than <key>
+		*/
+		static inline int lowerBound(const KeyT* keys, int count, const KeyT& key) {
+			if (count == 0) return 0;
+
+			const KeyT* base = keys;
+			while (count > 1) {
+				int half = count / 2;
+				base = (base[half] < key) ? base + half : base;
+				count -= half;
+			}
+			return (int)(base - keys) + (*base < key);
+		}
+
+		/* Index of the child of <inner> that covers <key>
+		*/
+		static inline int childIndex(const Inner* inner, const KeyT& key) {
+			return upperBound(inner->keys, inner->count, key);
+		}
+
+		/* Index of the first key in <leaf> that is not less than <key>
+		*/
+		static inline int leafIndex(const Leaf* leaf, const KeyT& key) {
+			return lowerBound(leaf->keys, leaf->count, key);
+		}
+
+		Leaf* newLeaf() {
+			Leaf* leaf = new Leaf;
+			leaf->count = 0;
+			leaf->next = nullptr;
+			return leaf;
+		}
+
+		void destruct(Node* node, int level) {
+			if (level > 0) {
+				Inner* inner = asInner(node);
+				for (int i = 0; i <= inner->count; i++) {
+					destruct(inner->children[i], level - 1);
+				}
+				delete inner;
+			}
+			else {
+				delete asLeaf(node);
+			}
+		}
+
+		/* Returns the leaf that would contain <key>
+		*/
+		inline Leaf* findLeaf(const KeyT& key) const {
+			Node* node = m_root;
+			for (int level = m_height; level > 0; level--) {
+				Inner* inner = asInner(node);
+				node = inner->children[childIndex(inner, key)];
+			}
+			return asLeaf(node);
+		}
+
+		/* Inserts into the subtree rooted at <node>
+		* @return true if <node> was split; the new right sibling and its separator key are
+		* returned through <splitKey> and <splitNode>
+		*/
+		bool insert(Node* node, int level, const KeyT& key, const ValueT& value, KeyT& splitKey, Node*& splitNode) {
+			if (level == 0) {
+				Leaf* leaf = asLeaf(node);
+				int index = leafIndex(leaf, key);
+
+				if (index < leaf->count && !(key < leaf->keys[index])) {
+					// the key is already present so replace its value
+					leaf->values[index] = value;
+					return false;
+				}
+				m_size++;
+
+				if (leaf->count < LEAF_CAPACITY) {
+					insertIntoLeaf(leaf, index, key, value);
+					return false;
+				}
+
+				// split the full leaf in half and insert into the half the key belongs to
+				Leaf* right = newLeaf();
+				int half = LEAF_CAPACITY / 2;
+				std::move(leaf->keys + half, leaf->keys + LEAF_CAPACITY, right->keys);
+				std::move(leaf->values + half, leaf->values + LEAF_CAPACITY, right->values);
+				right->count = LEAF_CAPACITY - half;
+				leaf->count = half;
+				right->next = leaf->next;
+				leaf->next = right;
+
+				if (index <= half) {
+					insertIntoLeaf(leaf, index, key, value);
+				}
+				else {
+					insertIntoLeaf(right, index - half, key, value);
+				}
+
+				splitKey = right->keys[0];
+				splitNode = right;
+				return true;
+			}
+
+			Inner* inner = asInner(node);
+			int index = childIndex(inner, key);
+			KeyT childKey;
+			Node* childNode;
+			if (!insert(inner->children[index], level - 1, key, value, childKey, childNode)) return false;
+
+			if (inner->count < INNER_CAPACITY) {
+				insertIntoInner(inner, index, childKey, childNode);
+				return false;
+			}
+
+			// split the full inner node; the middle key moves up instead of being copied
+			Inner* right = new Inner;
+			int half = INNER_CAPACITY / 2;
+			if (index < half) {
+				// the new entry goes left, so the left half keeps one key less before inserting
+				splitKey = inner->keys[half - 1];
+				right->count = INNER_CAPACITY - half;
+				std::move(inner->keys + half, inner->keys + INNER_CAPACITY, right->keys);
+				std::move(inner->children + half, inner->children + INNER_CAPACITY + 1, right->children);
+				inner->count = half - 1;
+				insertIntoInner(inner, index, childKey, childNode);
+			}
+			else if (index == half) {
+				// the new entry sits exactly in the middle, so its key is the one that moves up
+				splitKey = childKey;
+				right->count = INNER_CAPACITY - half;
+				std::move(inner->keys + half, inner->keys + INNER_CAPACITY, right->keys);
+				right->children[0] = childNode;
+				std::move(inner->children + half + 1, inner->children + INNER_CAPACITY + 1, right->children + 1);
+				inner->count = half;
+			}
+			else {
+				splitKey = inner->keys[half];
+				right->count = INNER_CAPACITY - half - 1;
+				std::move(inner->keys + half + 1, inner->keys + INNER_CAPACITY, right->keys);
+				std::move(inner->children + half + 1, inner->children + INNER_CAPACITY + 1, right->children);
+				inner->count = half;
+				insertIntoInner(right, index - half - 1, childKey, childNode);
+			}
+
+			splitNode = right;
+			return true;
+		}
+
+		static void insertIntoLeaf(Leaf* leaf, int index, const KeyT& key, const ValueT& value) {
+			std::move_backward(leaf->keys + index, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+			std::move_backward(leaf->values + index, leaf->values + leaf->count, leaf->values + leaf->count + 1);
+			leaf->keys[index] = key;
+			leaf->values[index] = value;
+			leaf->count++;
+		}
+
+		/* Inserts <key> at <index> and <child> right after it
+		*/
+		static void insertIntoInner(Inner* inner, int index, const KeyT& key, Node* child) {
+			std::move_backward(inner->keys + index, inner->keys + inner->count, inner->keys + inner->count + 1);
+			std::move_backward(inner->children + index + 1, inner->children + inner->count + 1,
+				inner->children + inner->count + 2);
+			inner->keys[index] = key;
+			inner->children[index + 1] = child;
+			inner->count++;
+		}
+
+		/* Removes key <index> and the child right after it
+		*/
+		static void removeFromInner(Inner* inner, int index) {
+			std::move(inner->keys + index + 1, inner->keys + inner->count, inner->keys + index);
+			std::move(inner->children + index + 2, inner->children + inner->count + 1, inner->children + index + 1);
+			inner->count--;
+		}
+
+		/* Deletes from the subtree rooted at <node>; underfull children are fixed on the way up
+		* @return true if the key was found
+		*/
+		bool deleteKey(Node* node, int level, const KeyT& key) {
+			if (level == 0) {
+				Leaf* leaf = asLeaf(node);
+				int index = leafIndex(leaf, key);
+				if (index == leaf->count || key < leaf->keys[index]) return false;
+
+				std::move(leaf->keys + index + 1, leaf->keys + leaf->count, leaf->keys + index);
+				std::move(leaf->values + index + 1, leaf->values + leaf->count, leaf->values + index);
+				leaf->count--;
+				m_size--;
+				return true;
+			}
+
+			Inner* inner = asInner(node);
+			int index = childIndex(inner, key);
+			if (!deleteKey(inner->children[index], level - 1, key)) return false;
+
+			int minimum = level == 1 ? LEAF_MINIMUM : INNER_MINIMUM;
+			if (inner->children[index]->count < minimum) {
+				rebalance(inner, index, level - 1);
+			}
+			return true;
+		}
+
+		/* Fixes the underfull child <index> of <parent> by borrowing an entry from a sibling,
+		* or merging with a sibling if neither can spare one
+		*/
+		void rebalance(Inner* parent, int index, int childLevel) {
+			int minimum = childLevel == 0 ? LEAF_MINIMUM : INNER_MINIMUM;
+			Node* left = index > 0 ? parent->children[index - 1] : nullptr;
+			Node* right = index < parent->count ? parent->children[index + 1] : nullptr;
+
+			if (left != nullptr && left->count > minimum) {
+				borrowFromLeft(parent, index, childLevel);
+			}
+			else if (right != nullptr && right->count > minimum) {
+				borrowFromRight(parent, index, childLevel);
+			}
+			else if (left != nullptr) {
+				merge(parent, index - 1, childLevel);
+			}
+			else {
+				merge(parent, index, childLevel);
+			}
+		}
+
+		void borrowFromLeft(Inner* parent, int index, int childLevel) {
+			if (childLevel == 0) {
+				Leaf* child = asLeaf(parent->children[index]);
+				Leaf* left = asLeaf(parent->children[index - 1]);
+				insertIntoLeaf(child, 0, left->keys[left->count - 1], left->values[left->count - 1]);
+				left->count--;
+				parent->keys[index - 1] = child->keys[0];
+			}
+			else {
+				// rotate through the parent: separator comes down, left's last key goes up
+				Inner* child = asInner(parent->children[index]);
+				Inner* left = asInner(parent->children[index - 1]);
+				std::move_backward(child->keys, child->keys + child->count, child->keys + child->count + 1);
+				std::move_backward(child->children, child->children + child->count + 1, child->children + child->count + 2);
+				child->keys[0] = parent->keys[index - 1];
+				child->children[0] = left->children[left->count];
+				child->count++;
+				parent->keys[index - 1] = left->keys[left->count - 1];
+				left->count--;
+			}
+		}
+
+		void borrowFromRight(Inner* parent, int index, int childLevel) {
+			if (childLevel == 0) {
+				Leaf* child = asLeaf(parent->children[index]);
+				Leaf* right = asLeaf(parent->children[index + 1]);
+				child->keys[child->count] = right->keys[0];
+				child->values[child->count] = right->values[0];
+				child->count++;
+				std::move(right->keys + 1, right->keys + right->count, right->keys);
+				std::move(right->values + 1, right->values + right->count, right->values);
+				right->count--;
+				parent->keys[index] = right->keys[0];
+			}
+			else {
+				Inner* child = asInner(parent->children[index]);
+				Inner* right = asInner(parent->children[index + 1]);
+				child->keys[child->count] = parent->keys[index];
+				child->children[child->count + 1] = right->children[0];
+				child->count++;
+				parent->keys[index] = right->keys[0];
+				std::move(right->keys + 1, right->keys + right->count, right->keys);
+				std::move(right->children + 1, right->children + right->count + 1, right->children);
+				right->count--;
+			}
+		}
+
+		/* Merges child <index> + 1 of <parent> into child <index>
+		*/
+		void merge(Inner* parent, int index, int childLevel) {
+			if (childLevel == 0) {
+				Leaf* left = asLeaf(parent->children[index]);
+				Leaf* right = asLeaf(parent->children[index + 1]);
+				std::move(right->keys, right->keys + right->count, left->keys + left->count);
+				std::move(right->values, right->values + right->count, left->values + left->count);
+				left->count += right->count;
+				left->next = right->next;
+				delete right;
+			}
+			else {
+				// the separator comes down between the two halves
+				Inner* left = asInner(parent->children[index]);
+				Inner* right = asInner(parent->children[index + 1]);
+				left->keys[left->count] = parent->keys[index];
+				std::move(right->keys, right->keys + right->count, left->keys + left->count + 1);
+				std::move(right->children, right->children + right->count + 1, left->children + left->count + 1);
+				left->count += right->count + 1;
+				delete right;
+			}
+
+			removeFromInner(parent, index);
+		}
+
+		std::string toString(Node* node, int level, int indent) {
+			std::string str;
+			for (int i = 0; i < indent; i++) str += " ";
+
+			if (level == 0) {
+				Leaf* leaf = asLeaf(node);
+				str += "[";
+				for (int i = 0; i < leaf->count; i++) {
+					if (i > 0) str += ", ";
+					str += std::to_string(leaf->keys[i]) + ": " + std::to_string(leaf->values[i]);
+				}
+				return str + "]\n";
+			}
+
+			Inner* inner = asInner(node);
+			str += "(";
+			for (int i = 0; i < inner->count; i++) {
+				if (i > 0) str += ", ";
+				str += std::to_string(inner->keys[i]);
+			}
+			str += ")\n";
+			for (int i = 0; i <= inner->count; i++) {
+				str += toString(inner->children[i], level - 1, indent + 1);
+			}
+			return str;
+		}
+
+	public:
+		BPlusTree() {
+			m_root = newLeaf();
+			m_height = 0;
+			m_size = 0;
+		}
+
+		~BPlusTree() {
+			destruct(m_root, m_height);
+		}
+
+		BPlusTree(const BPlusTree&) = delete;
+		BPlusTree& operator=(const BPlusTree&) = delete;
+
+		/* Insert a key, value pair
+		* Note: unlike BST, keys are unique; inserting an existing key replaces its value
+		*/
+		void insert(const KeyT& key, const ValueT& value) {
+			KeyT splitKey;
+			Node* splitNode;
+			if (!insert(m_root, m_height, key, value, splitKey, splitNode)) return;
+
+			// the root was split so the tree grows a level
+			Inner* root = new Inner;
+			root->count = 1;
+			root->keys[0] = splitKey;
+			root->children[0] = m_root;
+			root->children[1] = splitNode;
+			m_root = root;
+			m_height++;
+		}
+
+		/* Return the value corresponding to a given key
+		* Note: throws an error if the key is not found
+		*/
+		ValueT getValue(const KeyT& key) {
+			Leaf* leaf = findLeaf(key);
+			int index = leafIndex(leaf, key);
+
+			if (index == leaf->count || key < leaf->keys[index]) {
+				throw exception_key_not_found;
+			}
+
+			return leaf->values[index];
+		}
+
+		bool deleteKey(const KeyT& key) {
+			if (!deleteKey(m_root, m_height, key)) return false;
+
+			// an inner root left with a single child is replaced by that child
+			if (m_height > 0 && m_root->count == 0) {
+				Inner* oldRoot = asInner(m_root);
+				m_root = oldRoot->children[0];
+				delete oldRoot;
+				m_height--;
+			}
+			return true;
+		}
+
+		/* Calls callback(key, value) for every key in [lo, hi] in ascending order
+		* Note: walks the linked leaves, so the cost is one descent plus the size of the range
+		*/
+		template <typename F>
+		void range(const KeyT& lo, const KeyT& hi, F callback) {
+			Leaf* leaf = findLeaf(lo);
+			int index = leafIndex(leaf, lo);
+
+			while (leaf != nullptr) {
+				for (; index < leaf->count; index++) {
+					if (hi < leaf->keys[index]) return;
+					callback(leaf->keys[index], leaf->values[index]);
+				}
+				leaf = leaf->next;
+				index = 0;
+			}
+		}
+
+		inline int getSize() const {
+			return m_size;
+		}
+
+		inline int getHeight() const {
+			return m_height + 1;
+		}
+
+		std::string toString() {
+			return toString(m_root, m_height, 0);
+		}
+	};
+}
@@ -0,0 +1,293 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// benchmark harness with machine readable output
+// a benchmark is a setup step (untimed: build the input, fill the container) and a body that
+// performs a known number of operations. Every benchmark is warmed up, then run a number of
+// times, each run on a fresh setup, and reported as nanoseconds per operation. The median is
+// over whole runs, which is stable against the odd slow run. The 99th percentile is over
+// latency samples: a body that takes a LatencyRecorder ticks it after every operation, and
+// every BATCH ticks become one sample, so the tail shows slow stretches inside a run (a
+// resize, a rebalance, cache misses) instead of only slow runs. A body made of one indivisible
+// call (a sort) has no samples but its runs, so its p99 is the percentile of the run averages.
+// The results are written as JSON, one benchmark per line, so two runs can be
+// compared with compareBenchmarks or any diff tool.
+// Inputs come in the distributions sorting and search structures are sensitive to: random,
+// sorted, reversed and few unique values.
+// https://en.wikipedia.org/wiki/Benchmark_(computing)
+// https://en.wikipedia.org/wiki/Percentile
+
+namespace alg {
+	enum class Distribution { Random, Sorted, Reversed, FewUnique };
+
+	inline const char* DistributionName(Distribution distribution) {
+		switch (distribution) {
+		case Distribution::Sorted: return "sorted";
+		case Distribution::Reversed: return "reversed";
+		case Distribution::FewUnique: return "few_unique";
+		default: return "random";
+		}
+	}
+
+	/* <size> ints in the given distribution; the same <seed> gives the same input
+	*/
+	inline std::vector<int> MakeInput(int size, Distribution distribution, unsigned int seed = 1) {
+		std::vector<int> values(size);
+		std::mt19937 rng(seed);
+		switch (distribution) {
+		case Distribution::Sorted:
+			for (int i = 0; i < size; i++) values[i] = i;
+			break;
+		case Distribution::Reversed:
+			for (int i = 0; i < size; i++) values[i] = size - i;
+			break;
+		case Distribution::FewUnique:
+			// 16 distinct values
+			for (int& value : values) value = (int)(rng() % 16);
+			break;
+		default:
+			for (int& value : values) value = (int)(rng() >> 1);
+			break;
+		}
+		return values;
+	}
+
+	struct BenchmarkResult {
+		std::string name; // "suite/case"
+		std::string distribution;
+		int size;
+		long long operations; // per run
+		int runs;
+		double medianNs; // per operation, over runs
+		double p99Ns; // per operation, over latency samples
+		long long samples; // latency samples behind p99Ns
+		double maxNs; // the slowest run
+		double minNs;
+		double meanNs;
+	};
+
+	namespace benchmark_detail {
+		/* Keeps <value> alive so the optimizer can not drop the work that computed it
+		*/
+		inline volatile char sink;
+
+		template <typename T>
+		inline void keep(const T& value) {
+			const char* bytes = reinterpret_cast<const char*>(&value);
+			for (size_t i = 0; i < sizeof(T); i++) sink = bytes[i];
+		}
+
+		/* The smallest sample with at least <fraction> of the samples at or below it
+		*/
+		inline double percentile(const std::vector<double>& sorted, double fraction) {
+			size_t rank = (size_t)std::ceil(fraction * sorted.size());
+			return sorted[rank == 0 ? 0 : rank - 1];
+		}
+
+		inline std::string escape(const std::string& text) {
+			std::string escaped;
+			for (char c : text) {
+				if (c == '"' || c == '\\') escaped += '\\';
+				escaped += c;
+			}
+			return escaped;
+		}
+
+		/* The number after "<field>": in a line written by BenchmarkRunner::toJson
+		* @return false if the field is missing
+		*/
+		inline bool findNumber(const std::string& line, const char* field, double& value) {
+			std::string key = std::string("\"") + field + "\": ";
+			size_t position = line.find(key);
+			if (position == std::string::npos) return false;
+			value = std::strtod(line.c_str() + position + key.size(), nullptr);
+			return true;
+		}
+
+		inline bool findString(const std::string& line, const char* field, std::string& value) {
+			std::string key = std::string("\"") + field + "\": \"";
+			size_t position = line.find(key);
+			if (position == std::string::npos) return false;
+			size_t end = line.find('"', position + key.size());
+			value = line.substr(position + key.size(), end - position - key.size());
+			return true;
+		}
+	}
+
+	/* Turns the operations of a benchmark body into latency samples: one sample of the
+	* nanoseconds per operation every BATCH ticks
+	* Note: timing every operation alone would mostly measure the clock; a batch of 256 keeps the
+	* clock under a nanosecond per operation and still sees stalls that last a few operations
+	*/
+	class LatencyRecorder {
+	public:
+		static const int BATCH = 256;
+
+	private:
+		std::vector<double>& m_samples;
+		std::chrono::steady_clock::time_point m_last;
+		int m_pending;
+
+	public:
+		explicit LatencyRecorder(std::vector<double>& samples) : m_samples(samples), m_pending(0) {}
+
+		/* Starts the first batch; called by BenchmarkRunner right before the body
+		*/
+		inline void start() {
+			m_pending = 0;
+			m_last = std::chrono::steady_clock::now();
+		}
+
+		/* Call after every operation
+		*/
+		inline void tick() {
+			if (++m_pending < BATCH) return;
+			auto now = std::chrono::steady_clock::now();
+			m_samples.push_back(std::chrono::duration<double, std::nano>(now - m_last).count() / m_pending);
+			m_last = now;
+			m_pending = 0;
+		}
+	};
+
+	class BenchmarkRunner {
+	private:
+		int m_warmupRuns;
+		int m_runs;
+		std::string m_filter;
+		std::vector<BenchmarkResult> m_results;
+
+	public:
+		/* @param runs timed runs per benchmark
+		* @param warmupRuns untimed runs before them
+		* @param filter only benchmarks whose name contains this run; empty runs all
+		*/
+		BenchmarkRunner(int runs = 15, int warmupRuns = 2, const std::string& filter = "")
+			: m_warmupRuns(warmupRuns), m_runs(runs < 1 ? 1 : runs), m_filter(filter) {}
+
+		/* Times <body> over m_runs fresh states made by <setup>
+		* @param setup returns the state a run works on; not timed
+		* @param body does <operations> operations on the state and returns something that
+		* depends on them, which is kept alive so the work can not be optimized away. A body
+		* taking (state, LatencyRecorder&) is passed a recorder to tick after every operation.
+		*/
+		template <typename Setup, typename Body>
+		void run(const std::string& name, Distribution distribution, int size, long long operations,
+			Setup setup, Body body) {
+			if (!m_filter.empty() && name.find(m_filter) == std::string::npos) return;
+
+			typedef decltype(setup()) State;
+			std::vector<double> samples, latencies, warmupLatencies;
+			for (int i = 0; i < m_warmupRuns + m_runs; i++) {
+				auto state = setup();
+				LatencyRecorder recorder(i >= m_warmupRuns ? latencies : warmupLatencies);
+				auto start = std::chrono::steady_clock::now();
+				if constexpr (std::is_invocable<Body&, State&, LatencyRecorder&>::value) {
+					recorder.start();
+					benchmark_detail::keep(body(state, recorder));
+				}
+				else {
+					benchmark_detail::keep(body(state));
+				}
+				auto end = std::chrono::steady_clock::now();
+				if (i >= m_warmupRuns) {
+					samples.push_back(std::chrono::duration<double, std::nano>(end - start).count() / operations);
+				}
+				warmupLatencies.clear();
+			}
+
+			std::sort(samples.begin(), samples.end());
+			if (latencies.empty()) latencies = samples;
+			std::sort(latencies.begin(), latencies.end());
+			BenchmarkResult result;
+			result.name = name;
+			result.distribution = DistributionName(distribution);
+			result.size = size;
+			result.operations = operations;
+			result.runs = m_runs;
+			result.medianNs = benchmark_detail::percentile(samples, 0.5);
+			result.p99Ns = benchmark_detail::percentile(latencies, 0.99);
+			result.samples = (long long)latencies.size();
+			result.minNs = samples.front();
+			result.maxNs = samples.back();
+			double sum = 0;
+			for (double sample : samples) sum += sample;
+			result.meanNs = sum / samples.size();
+			m_results.push_back(result);
+
+			std::fprintf(stderr, "%-40s %-10s %9d  median %10.2f ns/op  p99 %10.2f ns/op\n", name.c_str(),
+				result.distribution.c_str(), size, result.medianNs, result.p99Ns);
+		}
+
+		inline const std::vector<BenchmarkResult>& getResults() const {
+			return m_results;
+		}
+
+		/* The results as a JSON array with one object per line
+		*/
+		std::string toJson() const {
+			std::ostringstream json;
+			json.precision(6);
+			json << std::fixed;
+			json << "[\n";
+			for (size_t i = 0; i < m_results.size(); i++) {
+				const BenchmarkResult& r = m_results[i];
+				json << "  {\"name\": \"" << benchmark_detail::escape(r.name) << "\", \"distribution\": \""
+					<< r.distribution << "\", \"size\": " << r.size << ", \"operations\": " << r.operations
+					<< ", \"runs\": " << r.runs << ", \"median_ns\": " << r.medianNs << ", \"p99_ns\": " << r.p99Ns << ", \"samples\": "
+					<< r.samples << ", \"max_ns\": " << r.maxNs
+					<< ", \"min_ns\": " << r.minNs << ", \"mean_ns\": " << r.meanNs << "}"
+					<< (i + 1 < m_results.size() ? ",\n" : "\n");
+			}
+			json << "]\n";
+			return json.str();
+		}
+	};
+
+	/* Compares the medians of <current> against a baseline file written by toJson
+	* Prints every benchmark that got slower by more than <threshold> (0.1 = 10%)
+	* @return the number of such regressions, or -1 if the baseline can not be read
+	* Note: benchmarks are matched by name, distribution and size; ones missing from the
+	* baseline are skipped
+	*/
+	inline int compareBenchmarks(const std::vector<BenchmarkResult>& current, const std::string& baselinePath,
+		double threshold) {
+		std::ifstream baseline(baselinePath);
+		if (!baseline) {
+			std::fprintf(stderr, "could not open the baseline %s\n", baselinePath.c_str());
+			return -1;
+		}
+
+		int regressions = 0;
+		std::string line;
+		while (std::getline(baseline, line)) {
+			std::string name, distribution;
+			double size, median;
+			if (!benchmark_detail::findString(line, "name", name) ||
+				!benchmark_detail::findString(line, "distribution", distribution) ||
+				!benchmark_detail::findNumber(line, "size", size) ||
+				!benchmark_detail::findNumber(line, "median_ns", median)) {
+				continue;
+			}
+
+			for (const BenchmarkResult& r : current) {
+				if (r.name != name || r.distribution != distribution || r.size != (int)size) continue;
+				if (r.medianNs > median * (1 + threshold)) {
+					std::fprintf(stderr, "REGRESSION %s %s %d: %.2f -> %.2f ns/op (%+.1f%%)\n", name.c_str(),
+						distribution.c_str(), r.size, median, r.medianNs, (r.medianNs / median - 1) * 100);
+					regressions++;
+				}
+			}
+		}
+		return regressions;
+	}
+}
@@ -1,8 +1,23 @@
 #pragma once
+#include "frozen_bst.h"
+#include "instrumentation.h"
+#include "memory_usage.h"
+#include "node_pool.h"
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
 #include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace alg {
-	template <typename KeyT, typename ValueT>
+	/* Binary search tree
+	* Note: nodes come from <Allocator> rebound to the node type; the default NodePool hands
+	* them out of slabs, pass std::allocator<KeyT> to use the global heap instead
+	*/
+	template <typename KeyT, typename ValueT, typename Allocator = NodePool<KeyT>>
 	class BST {
 	private:
 		class BSTKeyNotFoundException : public std::exception {
@@ -19,19 +34,58 @@ namespace alg {
 			TreeNode* right;
 		};
 
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<TreeNode> NodeAllocator;
+
 	// member variables
 	private:
 		TreeNode* m_root;
+		size_t m_size;
+		NodeAllocator m_allocator;
 
 	// methods
 	private:
-		void destruct(TreeNode* node) {
-			if (node == nullptr) return;
+		TreeNode* createNode(const KeyT& key, const ValueT& value) {
+			ALG_COUNT(BSTAllocations);
+			TreeNode* node = m_allocator.allocate(1);
+			try {
+				new (node) TreeNode{ key, value, nullptr, nullptr };
+			}
+			catch (...) {
+				m_allocator.deallocate(node, 1);
+				throw;
+			}
+			return node;
+		}
+
+		void destroyNode(TreeNode* node) {
+			node->~TreeNode();
+			m_allocator.deallocate(node, 1);
+		}
+
+		/* Destroys every node one by one
+		* Note: iterative, rotating left children up until the node to destroy has none, so
+		* degenerate (list shaped) trees can not overflow the stack
+		*/
+		void destruct(TreeNode* node, std::false_type) {
+			while (node != nullptr) {
+				if (node->left != nullptr) {
+					TreeNode* left = node->left;
+					node->left = left->right;
+					left->right = node;
+					node = left;
+				}
+				else {
+					TreeNode* right = node->right;
+					destroyNode(node);
+					node = right;
+				}
+			}
+		}
 
-			// post order traversal
-			destruct(node->left);
-			destruct(node->right);
-			delete node;
+		/* Nothing to destroy, so drop the whole pool at once
+		*/
+		void destruct(TreeNode*, std::true_type) {
+			m_allocator.release();
 		}
 
 		std::string toString(const TreeNode* node, const int indent) {
@@ -51,13 +105,18 @@ namespace alg {
 			return str;
 		}
 
-		/* Returns the value corresponding to the given key
-		* @return the corresponding value
+		/* Returns the node with the given key
+		* @param parent set to the parent of the returned node (nullptr for the root)
+		* @return the node, nullptr if the key is not in the tree
 		*/
-		inline TreeNode* find(const KeyT& key) {
+		inline TreeNode* find(const KeyT& key, TreeNode*& parent) {
 			TreeNode* node = m_root;
+			parent = nullptr;
+			unsigned long long visited = 0; // only read by the instrumentation hooks
 			while (node != nullptr && key != node->key) {
-				if (key < node->value) {
+				visited++;
+				parent = node;
+				if (key < node->key) {
 					node = node->left;
 				}
 				else {
@@ -65,59 +124,80 @@ namespace alg {
 				}
 			}
 
+			if (node != nullptr) visited++;
+			ALG_COUNT_N(BSTNodesVisited, visited);
+			ALG_RECORD(BSTFindVisits, visited);
 			return node;
 		}
 
-		/* Finds the minimum node belonging to the tree starting at <node>
+		/* Fills <stack> with the path to the first node whose key is not less than <key> (or
+		* greater than <key> if <upper> is set), keeping only the nodes the descent went left
+		* from; those are exactly the nodes an in-order walk visits next
 		*/
-		inline TreeNode* minimum(TreeNode* node) {
-			while (node->left != nullptr) {
-				node = node->left;
-			}
-
-			return node;
-		}
-
-		/* Finds the parent node of a given node. <node> should be a valid node in the tree
-		* @return the parent node of <node>, nullptr if <node> is m_root
-		*/
-		TreeNode* getParent(TreeNode* node) {
-			TreeNode* current = m_root;
-			TreeNode* previous = nullptr;
-			while (current != nullptr && current != node) {
-				previous = current;
-				if (node->key < current->key) {
-					current = current->left;
+		void bound(const KeyT& key, bool upper, std::vector<TreeNode*>& stack) {
+			TreeNode* node = m_root;
+			while (node != nullptr) {
+				if (upper ? key < node->key : !(node->key < key)) {
+					stack.push_back(node);
+					node = node->left;
 				}
 				else {
-					current = current->right;
+					node = node->right;
 				}
 			}
+		}
 
-			return previous;
+		/* Builds a balanced tree out of the sorted arrays keys[first, last) and values[first, last)
+		* into <slot>; every node is linked in as soon as it is made so nothing leaks if a copy throws
+		*/
+		void build(TreeNode*& slot, const KeyT keys[], const ValueT values[], int first, int last) {
+			if (first >= last) return;
+
+			int middle = first + (last - first) / 2;
+			slot = createNode(keys[middle], values[middle]);
+			build(slot->left, keys, values, first, middle);
+			build(slot->right, keys, values, middle + 1, last);
 		}
 
 	public:
 		BST() {
 			m_root = nullptr;
+			m_size = 0;
 		}
 
+		/* Allocates the nodes through a copy of <allocator>, e.g. a TrackingAllocator with its
+		* own MemoryStats
+		*/
+		explicit BST(const Allocator& allocator) : m_root(nullptr), m_size(0), m_allocator(allocator) {}
+
 		~BST() {
-			destruct(m_root);
+			clear();
+		}
+
+		BST(const BST&) = delete;
+		BST& operator=(const BST&) = delete;
+
+		/* Remove every key
+		* Note: O(slabs) rather than O(n) with a NodePool and trivially destructible keys and values
+		*/
+		void clear() {
+			typedef std::integral_constant<bool, node_pool_detail::ReleasesInBulk<NodeAllocator>::value &&
+				std::is_trivially_destructible<TreeNode>::value> ReleaseAll;
+			destruct(m_root, ReleaseAll());
+			m_root = nullptr;
+			m_size = 0;
 		}
 
 		void insert(const KeyT& key, const ValueT& value) {
 			// make a new node
-			TreeNode* newNode = new TreeNode;
-			newNode->key = key;
-			newNode->value = value;
-			newNode->left = nullptr;
-			newNode->right = nullptr;
+			TreeNode* newNode = createNode(key, value);
 
 			// traverse through the tree keeping track of the current and previous nodes
 			TreeNode* current = m_root;
 			TreeNode* previous = nullptr;
+			unsigned long long visited = 0; // only read by the instrumentation hooks
 			while (current != nullptr) {
+				visited++;
 				previous = current;
 				if (key < current->key) {
 					current = current->left;
@@ -126,8 +206,11 @@ namespace alg {
 					current = current->right;
 				}
 			}
+			ALG_COUNT_N(BSTNodesVisited, visited);
+			ALG_RECORD(BSTInsertVisits, visited);
 			
 			// insert the new node
+			m_size++;
 			if (previous == nullptr) {
 				// tree is empty so make a new root
 				m_root = newNode;
@@ -144,7 +227,8 @@ namespace alg {
 		* Note: throws an error if the key is not found
 		*/
 		ValueT getValue(const KeyT& key) {
-			TreeNode* node = find(key);
+			TreeNode* parent;
+			TreeNode* node = find(key, parent);
 
 			if (node == nullptr) {
 				throw exception_key_not_found;
@@ -154,66 +238,199 @@ namespace alg {
 		}
 
 		bool deleteKey(const KeyT& key) {
-			TreeNode* node = find(key);
-			
+			TreeNode* parent;
+			TreeNode* node = find(key, parent);
+
 			if (node == nullptr) return false;
 
-			TreeNode* parent = getParent(node);
+			if (node->left != nullptr && node->right != nullptr) {
+				// case: there are two children
+				// RE: https://en.wikipedia.org/wiki/Binary_search_tree#Deletion
 
-			if (node->left == nullptr) {
-				// case: there are no children or there is only a right child
-				if (node == m_root) {
-					m_root = node->right;
-				}
-				else if (node == parent->left) {
-					parent->left = node->right;
-				}
-				else {
-					parent->right = node->right;
+				// move the minimum of the right subtree into this node and delete that one
+				// instead; it has no left child so it falls into the cases below
+				parent = node;
+				TreeNode* successor = node->right;
+				while (successor->left != nullptr) {
+					parent = successor;
+					successor = successor->left;
 				}
 
-				delete node;
+				node->key = successor->key;
+				node->value = successor->value;
+				node = successor;
 			}
-			else if (node->right == nullptr) {
-				// case: there is only a left child
-				if (node == m_root) {
-					m_root = node->left;
-				}
-				else if (node == parent->left) {
-					parent->left = node->left;
-				}
-				else {
-					parent->right = node->left;
-				}
 
-				delete node;
+			// case: there is at most one child, which takes the node's place
+			TreeNode* child = node->left != nullptr ? node->left : node->right;
+			if (parent == nullptr) {
+				m_root = child;
+			}
+			else if (node == parent->left) {
+				parent->left = child;
 			}
 			else {
-				// case: there are two children
-				// RE: https://en.wikipedia.org/wiki/Binary_search_tree#Deletion
+				parent->right = child;
+			}
+
+			destroyNode(node);
+			m_size--;
+			return true;
+		}
+
+		/* Replace the contents of the tree with a perfectly balanced tree built in O(n)
+		* @param keys the keys in ascending order
+		* @param values the value of each key
+		* @param size the number of keys
+		*/
+		void bulkLoad(const KeyT keys[], const ValueT values[], int size) {
+			clear();
+			build(m_root, keys, values, 0, size);
+			m_size = size > 0 ? size : 0;
+		}
+
+		/* In-order iterator; dereferences to a (key, value) pair of references
+		* Note: keeps the path of nodes still to visit, so it is not invalidated by lookups but
+		* is by inserts and deletes
+		*/
+		class iterator {
+		private:
+			friend class BST;
+			std::vector<TreeNode*> m_stack; // the current node is on top
+
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef std::pair<const KeyT&, ValueT&> value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef value_type reference;
+			typedef void pointer;
 
-				// new base = minimum from right subtree
-				TreeNode* newRoot = minimum(node->right);
+			inline const KeyT& key() const {
+				return m_stack.back()->key;
+			}
 
-				// copy values from newRoot to the root node
-				node->key = newRoot->key;
-				node->value = newRoot->value;
+			inline ValueT& value() const {
+				return m_stack.back()->value;
+			}
 
-				// find newRoot's parent and replace newRoot with newRoot's right child
-				// (it can only have right children)
-				TreeNode* parent = getParent(newRoot);
+			inline reference operator*() const {
+				return reference(m_stack.back()->key, m_stack.back()->value);
+			}
 
-				if (newRoot->key < parent->key) {
-					// newRoot used to be a left child so replace itself with its children
-					parent->left = newRoot->right;
+			iterator& operator++() {
+				TreeNode* node = m_stack.back()->right;
+				m_stack.pop_back();
+				while (node != nullptr) {
+					m_stack.push_back(node);
+					node = node->left;
 				}
-				else {
-					parent->right = newRoot->right;
+				return *this;
+			}
+
+			iterator operator++(int) {
+				iterator previous = *this;
+				++*this;
+				return previous;
+			}
+
+			inline bool operator==(const iterator& other) const {
+				if (m_stack.empty() || other.m_stack.empty()) return m_stack.empty() == other.m_stack.empty();
+				return m_stack.back() == other.m_stack.back();
+			}
+
+			inline bool operator!=(const iterator& other) const {
+				return !(*this == other);
+			}
+		};
+
+		iterator begin() {
+			iterator it;
+			for (TreeNode* node = m_root; node != nullptr; node = node->left) {
+				it.m_stack.push_back(node);
+			}
+			return it;
+		}
+
+		iterator end() {
+			return iterator();
+		}
+
+		/* @return an iterator to the first key not less than <key>, end() if there is none
+		*/
+		iterator lower_bound(const KeyT& key) {
+			iterator it;
+			bound(key, false, it.m_stack);
+			return it;
+		}
+
+		/* @return an iterator to the first key greater than <key>, end() if there is none
+		*/
+		iterator upper_bound(const KeyT& key) {
+			iterator it;
+			bound(key, true, it.m_stack);
+			return it;
+		}
+
+		/* Calls callback(key, value) for every key in [lo, hi] in ascending order
+		* Note: one descent plus the size of the range, the rest of the tree is never touched
+		*/
+		template <typename F>
+		void range(const KeyT& lo, const KeyT& hi, F callback) {
+			std::vector<TreeNode*> stack;
+			bound(lo, false, stack);
+
+			while (!stack.empty()) {
+				TreeNode* node = stack.back();
+				if (hi < node->key) return;
+				callback(node->key, node->value);
+
+				stack.pop_back();
+				for (node = node->right; node != nullptr; node = node->left) {
+					stack.push_back(node);
 				}
+			}
+		}
+
+		inline size_t getSize() const {
+			return m_size;
+		}
 
-				delete newRoot;
+		/* Copy the tree into an immutable FrozenBST for read only use
+		* Note: O(n); lookups in the copy are branchless walks over one flat array, several
+		* times faster than following the node pointers once the tree is larger than the cache.
+		* With duplicate keys both return the value inserted first.
+		*/
+		FrozenBST<KeyT, ValueT> freeze() const {
+			std::vector<KeyT> keys;
+			std::vector<ValueT> values;
+			keys.reserve(m_size);
+			values.reserve(m_size);
+
+			// in-order walk without recursion, so degenerate trees can not overflow the stack
+			std::vector<const TreeNode*> stack;
+			const TreeNode* node = m_root;
+			while (node != nullptr || !stack.empty()) {
+				for (; node != nullptr; node = node->left) stack.push_back(node);
+				node = stack.back();
+				stack.pop_back();
+				keys.push_back(node->key);
+				values.push_back(node->value);
+				node = node->right;
 			}
-			return true;
+			return FrozenBST<KeyT, ValueT>(keys.data(), values.data(), keys.size());
+		}
+
+		/* Bytes held by the tree; with a NodePool the allocated bytes are whole slabs
+		*/
+		MemoryUsage memoryUsage() const {
+			MemoryUsage usage;
+			usage.objectBytes = sizeof(*this);
+			usage.allocatedBytes = node_pool_detail::heldBytes(m_allocator, m_size, sizeof(TreeNode));
+			usage.liveBytes = m_size * sizeof(TreeNode);
+			usage.payloadBytes = m_size * (sizeof(KeyT) + sizeof(ValueT));
+			usage.elementCount = m_size;
+			usage.nodeCount = m_size;
+			return usage;
 		}
 
 		std::string toString() {
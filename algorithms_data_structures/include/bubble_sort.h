@@ -1,4 +1,5 @@
 #pragma once
+#include "instrumentation.h"
 
 namespace alg {
 	template <typename T>
@@ -15,21 +16,30 @@ namespace alg {
 	static void BubbleSort(T arr[], int start, int end) {
 		bool swapped = true; // something has been swapped so keep sorting
 		T temp;
+		// only read by the instrumentation hooks
+		unsigned long long comparisons = 0, swaps = 0, passes = 0;
 
 		while (swapped) {
 			swapped = false;
+			passes++;
 			for (int i = start; i < end; i++) {
+				comparisons++;
 				if (arr[i] > arr[i + 1]) {
 					//swap elements
 					temp = arr[i];
 					arr[i] = arr[i + 1];
 					arr[i + 1] = temp;
 					swapped = true;
+					swaps++;
 				}
 			}
 
 			// we know that the last element is sorted so we can skip it
 			end--;
 		}
+
+		ALG_COUNT_N(SortComparisons, comparisons);
+		ALG_COUNT_N(SortSwaps, swaps);
+		ALG_RECORD(BubbleSortPasses, passes);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,313 @@
+#pragma once
+#include "epoch.h"
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <new>
+
+// lock-free ordered map (skip list) with the insert/getValue/deleteKey interface of alg::BST
+// every node is in the level 0 list and, with probability 1/2 per level, in the lists above it.
+// A node is deleted by marking the low bit of its next pointers (top level first); whoever
+// marks level 0 owns the deletion. Marked nodes are physically unlinked by any thread that walks
+// past them, and freed through epoch based reclamation once nothing can reach them anymore.
+// Lookups never write to shared memory and never retry, so they can not be blocked by writers.
+// RE: Herlihy & Shavit, The Art of Multiprocessor Programming, section 14.4
+// https://en.wikipedia.org/wiki/Skip_list
+
+namespace alg {
+	template <typename KeyT, typename ValueT>
+	class ConcurrentSkipList {
+	private:
+		class ConcurrentSkipListKeyNotFoundException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "key not found";
+			}
+		} exception_key_not_found;
+
+		enum { MAX_LEVEL = 32 };
+
+		typedef std::atomic<uintptr_t> Link; // a Node* with the deletion mark in the low bit
+
+		// aligned so that the links can follow it directly
+		struct alignas(Link) Node {
+			KeyT key;
+			ValueT value;
+			int height;
+			// the inserting and the deleting thread each hold one; the one to let go last retires
+			// the node, which guarantees that both have finished linking and unlinking it
+			std::atomic<int> owners;
+
+			// the <height> links are allocated right behind the node
+			inline Link* next() {
+				return reinterpret_cast<Link*>(this + 1);
+			}
+		};
+
+	// member variables
+	private:
+		Link m_head[MAX_LEVEL];
+
+	// methods
+	private:
+		static inline Node* pointer(uintptr_t link) {
+			return reinterpret_cast<Node*>(link & ~(uintptr_t)1);
+		}
+
+		static inline bool isMarked(uintptr_t link) {
+			return (link & 1) != 0;
+		}
+
+		static Node* createNode(const KeyT& key, const ValueT& value, int height) {
+			void* memory = ::operator new(sizeof(Node) + height * sizeof(Link));
+			Node* node = static_cast<Node*>(memory);
+			try {
+				new (&node->key) KeyT(key);
+				try {
+					new (&node->value) ValueT(value);
+				}
+				catch (...) {
+					node->key.~KeyT();
+					throw;
+				}
+			}
+			catch (...) {
+				::operator delete(memory);
+				throw;
+			}
+			node->height = height;
+			new (&node->owners) std::atomic<int>(2);
+			for (int i = 0; i < height; i++) new (&node->next()[i]) Link(0);
+			return node;
+		}
+
+		static void destroyNode(void* memory) {
+			Node* node = static_cast<Node*>(memory);
+			node->key.~KeyT();
+			node->value.~ValueT();
+			::operator delete(memory);
+		}
+
+		/* Drops one of the two owners of <node>, retiring it if that was the last
+		*/
+		static void release(Node* node) {
+			if (node->owners.fetch_sub(1) == 1) EpochRetire(node, &ConcurrentSkipList::destroyNode);
+		}
+
+		/* Random height with P(height > h) = 1 / 2^h
+		*/
+		static int randomHeight() {
+			thread_local uint64_t state = 0x9E3779B97F4A7C15ull ^ (uint64_t)(uintptr_t)&state;
+			// xorshift64
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+
+			int height = 1;
+			uint64_t bits = state;
+			while ((bits & 1) != 0 && height < MAX_LEVEL) {
+				height++;
+				bits >>= 1;
+			}
+			return height;
+		}
+
+		/* Finds the links around <key> on every level, unlinking the marked nodes on the way
+		* @param preds set to the last link before <key> on each level
+		* @param succs set to the first node not less than <key> on each level
+		* @param pastEqual go past the nodes equal to <key> as well (to unlink a marked one)
+		* @return true if succs[0] holds <key>
+		*/
+		bool search(const KeyT& key, Link** preds, Node** succs, bool pastEqual) {
+		retry:
+			Link* pred = m_head;
+			for (int level = MAX_LEVEL - 1; level >= 0; level--) {
+				Node* current = pointer(pred[level].load());
+				while (current != nullptr) {
+					uintptr_t succ = current->next()[level].load();
+					if (isMarked(succ)) {
+						// current is being deleted: unlink it here; if pred changed or got marked
+						// itself in the meantime, start over
+						uintptr_t expected = (uintptr_t)current;
+						if (!pred[level].compare_exchange_strong(expected, succ & ~(uintptr_t)1)) goto retry;
+						current = pointer(succ);
+						continue;
+					}
+
+					if (current->key < key || (pastEqual && !(key < current->key))) {
+						pred = current->next();
+						current = pointer(succ);
+					}
+					else {
+						break;
+					}
+				}
+
+				if (preds != nullptr) {
+					preds[level] = &pred[level];
+					succs[level] = current;
+				}
+			}
+
+			return succs != nullptr && succs[0] != nullptr && !(key < succs[0]->key);
+		}
+
+		/* Finds the node with <key> without modifying anything
+		* @return the node, nullptr if the key is not in the map
+		*/
+		Node* find(const KeyT& key) {
+			Link* pred = m_head;
+			Node* current = nullptr;
+			for (int level = MAX_LEVEL - 1; level >= 0; level--) {
+				current = pointer(pred[level].load(std::memory_order_acquire));
+				while (current != nullptr) {
+					uintptr_t succ = current->next()[level].load(std::memory_order_acquire);
+					if (isMarked(succ)) {
+						// skip nodes that are being deleted
+						current = pointer(succ);
+					}
+					else if (current->key < key) {
+						pred = current->next();
+						current = pointer(succ);
+					}
+					else {
+						break;
+					}
+				}
+			}
+
+			if (current == nullptr || key < current->key) return nullptr;
+			return current;
+		}
+
+	public:
+		ConcurrentSkipList() {
+			for (int i = 0; i < MAX_LEVEL; i++) m_head[i].store(0);
+		}
+
+		/* Note: no other thread may use the map while it is destroyed
+		*/
+		~ConcurrentSkipList() {
+			// every node still on level 0 is owned by the map; deleted nodes were unlinked
+			// before they were retired
+			Node* node = pointer(m_head[0].load());
+			while (node != nullptr) {
+				Node* next = pointer(node->next()[0].load());
+				destroyNode(node);
+				node = next;
+			}
+		}
+
+		ConcurrentSkipList(const ConcurrentSkipList&) = delete;
+		ConcurrentSkipList& operator=(const ConcurrentSkipList&) = delete;
+
+		/* Insert a key, value pair
+		* @return false (and leaves the map unchanged) if the key is already in the map; unlike
+		* BST keys are unique, since a duplicate could not be told apart from a concurrent insert
+		*/
+		bool insert(const KeyT& key, const ValueT& value) {
+			EpochGuard guard;
+			Link* preds[MAX_LEVEL];
+			Node* succs[MAX_LEVEL];
+			Node* node = nullptr;
+
+			// link level 0, which makes the node part of the map
+			while (true) {
+				if (search(key, preds, succs, false)) {
+					if (node != nullptr) destroyNode(node);
+					return false;
+				}
+
+				if (node == nullptr) node = createNode(key, value, randomHeight());
+				for (int level = 0; level < node->height; level++) {
+					node->next()[level].store((uintptr_t)succs[level], std::memory_order_relaxed);
+				}
+
+				uintptr_t expected = (uintptr_t)succs[0];
+				if (preds[0]->compare_exchange_strong(expected, (uintptr_t)node)) break;
+			}
+
+			// link the levels above; they are only shortcuts, so give up as soon as the node
+			// gets deleted
+			for (int level = 1; level < node->height; level++) {
+				while (true) {
+					uintptr_t next = node->next()[level].load();
+					if (isMarked(next)) goto linked;
+					if (next != (uintptr_t)succs[level] &&
+						!node->next()[level].compare_exchange_strong(next, (uintptr_t)succs[level])) {
+						goto linked;
+					}
+
+					uintptr_t expected = (uintptr_t)succs[level];
+					if (preds[level]->compare_exchange_strong(expected, (uintptr_t)node)) break;
+					search(key, preds, succs, false);
+				}
+			}
+
+		linked:
+			// if the node was deleted while its levels were linked, the deleting thread may have
+			// missed the later ones, so unlink it again before letting go
+			if (isMarked(node->next()[0].load())) search(key, nullptr, nullptr, true);
+			release(node);
+			return true;
+		}
+
+		/* Return the value corresponding to a given key
+		* Note: throws an error if the key is not found; never blocks
+		*/
+		ValueT getValue(const KeyT& key) {
+			EpochGuard guard;
+			Node* node = find(key);
+
+			if (node == nullptr) {
+				throw exception_key_not_found;
+			}
+
+			return node->value;
+		}
+
+		/* Copies the value of <key> into <value>
+		* @return false if the key is not found
+		*/
+		bool tryGetValue(const KeyT& key, ValueT& value) {
+			EpochGuard guard;
+			Node* node = find(key);
+
+			if (node == nullptr) return false;
+
+			value = node->value;
+			return true;
+		}
+
+		bool contains(const KeyT& key) {
+			EpochGuard guard;
+			return find(key) != nullptr;
+		}
+
+		bool deleteKey(const KeyT& key) {
+			EpochGuard guard;
+			Link* preds[MAX_LEVEL];
+			Node* succs[MAX_LEVEL];
+
+			if (!search(key, preds, succs, false)) return false;
+			Node* node = succs[0];
+
+			// mark the upper levels top down so no new links to the node can appear there
+			for (int level = node->height - 1; level > 0; level--) {
+				uintptr_t next = node->next()[level].load();
+				while (!isMarked(next) && !node->next()[level].compare_exchange_weak(next, next | 1)) {}
+			}
+
+			// marking level 0 is the actual deletion; only one thread can win it
+			uintptr_t next = node->next()[0].load();
+			while (true) {
+				if (isMarked(next)) return false;
+				if (node->next()[0].compare_exchange_strong(next, next | 1)) break;
+			}
+
+			search(key, nullptr, nullptr, true);
+			release(node);
+			return true;
+		}
+	};
+}
@@ -0,0 +1,330 @@
+#pragma once
+#include "cpu_features.h"
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <utility>
+
+// lock-free stack (Treiber stack) with an elimination array
+// the top of the stack is one 64 bit word: the index of the top node and a tag that every
+// successful compare-and-swap increments. A pop that read the top, got preempted and finds the
+// same node on top again (after it was popped, reused and pushed back: the ABA problem) fails
+// its compare-and-swap because the tag moved on.
+// Nodes come from a pool owned by the stack and go back to it (a second Treiber stack, the free
+// list) instead of being deleted, so their memory stays valid while a slow thread may still read
+// them and push/pop never reach the global allocator once the pool is big enough. The pool grows
+// in chunks of doubling size and is only freed with the stack.
+// When the compare-and-swap on the top fails, a push offers its node in a random slot of the
+// elimination array for a short while, and a pop checks a random slot for such an offer; a push
+// and a pop that meet there cancel out without touching the top at all.
+// RE: R. K. Treiber, Systems Programming: Coping with Parallelism (1986)
+// RE: Hendler, Shavit & Yerushalmi, A Scalable Lock-free Stack Algorithm (2004)
+// https://en.wikipedia.org/wiki/Treiber_stack
+// https://en.wikipedia.org/wiki/ABA_problem
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace alg {
+	namespace concurrent_stack_detail {
+		// the first chunk of the node pool has 1 << FIRST_CHUNK_SHIFT nodes, every next one twice
+		// as many as the one before
+		const int FIRST_CHUNK_SHIFT = 6;
+		const int MAX_CHUNKS = 32 - FIRST_CHUNK_SHIFT;
+		const int ELIMINATION_SLOTS = 16;
+		// how long a push waits in the elimination array for a pop to take its node
+		const int ELIMINATION_SPINS = 64;
+
+		/* Index of the highest set bit of <value>, which must not be 0
+		*/
+		inline int floorLog2(uint32_t value) {
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanReverse(&index, value);
+			return (int)index;
+#else
+			return 31 - __builtin_clz(value);
+#endif
+		}
+
+		inline uint32_t randomSlot() {
+			thread_local uint32_t state = 0x9E3779B9u ^ (uint32_t)(uintptr_t)&state;
+			// xorshift32
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state % ELIMINATION_SLOTS;
+		}
+	}
+
+	template <typename T>
+	class ConcurrentStack {
+	private:
+		class StackEmptyException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "stack is empty";
+			}
+		} exception_empty;
+
+		enum { CACHE_LINE = 64 };
+
+		struct Node {
+			// read by pops that lost the race for this node, so it has to be atomic
+			std::atomic<uint32_t> next;
+			alignas(T) unsigned char storage[sizeof(T)];
+
+			inline T* value() {
+				return reinterpret_cast<T*>(storage);
+			}
+		};
+
+		// (tag << 32) | index; index 0 is the empty stack (node indices start at 1)
+		typedef uint64_t Tagged;
+
+		static inline uint32_t indexOf(Tagged word) {
+			return (uint32_t)word;
+		}
+
+		static inline Tagged tagged(uint32_t index, Tagged previous) {
+			return ((previous >> 32) + 1) << 32 | index;
+		}
+
+		alignas(CACHE_LINE) std::atomic<Tagged> m_top;
+		alignas(CACHE_LINE) std::atomic<Tagged> m_free;
+		// slots hold a tagged node index while a push offers it; index 0 means empty
+		alignas(CACHE_LINE) std::atomic<Tagged> m_elimination[concurrent_stack_detail::ELIMINATION_SLOTS];
+
+		alignas(CACHE_LINE) std::atomic<Node*> m_chunks[concurrent_stack_detail::MAX_CHUNKS];
+		std::atomic<int> m_chunkCount;
+		std::mutex m_growMutex;
+		bool m_eliminate;
+
+		/* The node with <index>; chunk k holds the indices from ((1 << k) - 1) << FIRST_CHUNK_SHIFT on
+		*/
+		inline Node* node(uint32_t index) {
+			using namespace concurrent_stack_detail;
+			uint32_t position = index - 1;
+			int chunk = floorLog2((position >> FIRST_CHUNK_SHIFT) + 1);
+			uint32_t first = ((1u << chunk) - 1) << FIRST_CHUNK_SHIFT;
+			return &m_chunks[chunk].load(std::memory_order_acquire)[position - first];
+		}
+
+		/* Push the chain <first> .. <last> (already linked through next) onto <list>
+		*/
+		void pushChain(std::atomic<Tagged>& list, uint32_t first, uint32_t last) {
+			Node* tail = node(last);
+			Tagged top = list.load(std::memory_order_relaxed);
+			do {
+				tail->next.store(indexOf(top), std::memory_order_relaxed);
+			} while (!list.compare_exchange_weak(top, tagged(first, top), std::memory_order_release,
+				std::memory_order_relaxed));
+		}
+
+		/* Pop a node index off <list>
+		* @return 0 if the list is empty
+		*/
+		uint32_t popNode(std::atomic<Tagged>& list) {
+			Tagged top = list.load(std::memory_order_acquire);
+			while (indexOf(top) != 0) {
+				// the node may be popped and reused right after the load; then the next read
+				// here is stale, but the tag makes the compare-and-swap fail
+				uint32_t next = node(indexOf(top))->next.load(std::memory_order_relaxed);
+				if (list.compare_exchange_weak(top, tagged(next, top), std::memory_order_acquire,
+					std::memory_order_acquire)) {
+					return indexOf(top);
+				}
+			}
+			return 0;
+		}
+
+		/* Add the next chunk to the pool and put its nodes on the free list
+		*/
+		void addChunk() {
+			using namespace concurrent_stack_detail;
+			int chunk = m_chunkCount.load(std::memory_order_relaxed);
+			if (chunk == MAX_CHUNKS) throw std::bad_alloc();
+			uint32_t size = 1u << (FIRST_CHUNK_SHIFT + chunk);
+			uint32_t first = (((1u << chunk) - 1) << FIRST_CHUNK_SHIFT) + 1;
+
+			Node* nodes = static_cast<Node*>(::operator new(sizeof(Node) * size));
+			for (uint32_t i = 0; i < size; i++) new (&nodes[i].next) std::atomic<uint32_t>(first + i + 1);
+			m_chunks[chunk].store(nodes, std::memory_order_release);
+			m_chunkCount.store(chunk + 1, std::memory_order_relaxed);
+
+			pushChain(m_free, first, first + size - 1);
+		}
+
+		/* Grow the pool once the free list ran empty
+		*/
+		void grow() {
+			std::lock_guard<std::mutex> lock(m_growMutex);
+			// another thread may have grown the pool while this one waited
+			if (indexOf(m_free.load(std::memory_order_acquire)) != 0) return;
+			addChunk();
+		}
+
+		uint32_t allocateNode() {
+			uint32_t index;
+			while ((index = popNode(m_free)) == 0) grow();
+			return index;
+		}
+
+		/* Offer node <index> to a pop through the elimination array
+		* @return true if a pop took it
+		*/
+		bool eliminatePush(uint32_t index) {
+			using namespace concurrent_stack_detail;
+			std::atomic<Tagged>& slot = m_elimination[randomSlot()];
+			Tagged empty = slot.load(std::memory_order_relaxed);
+			if (indexOf(empty) != 0) return false;
+
+			Tagged offer = tagged(index, empty);
+			if (!slot.compare_exchange_strong(empty, offer, std::memory_order_release, std::memory_order_relaxed)) {
+				return false;
+			}
+			for (int i = 0; i < ELIMINATION_SPINS; i++) {
+				if (slot.load(std::memory_order_relaxed) != offer) return true;
+				CpuRelax();
+			}
+			// withdraw the offer; failing to means a pop took it after all
+			return !slot.compare_exchange_strong(offer, tagged(0, offer), std::memory_order_relaxed);
+		}
+
+		/* Take a node offered by a push in the elimination array
+		* @return its index, 0 if there was none
+		*/
+		uint32_t eliminatePop() {
+			using namespace concurrent_stack_detail;
+			std::atomic<Tagged>& slot = m_elimination[randomSlot()];
+			Tagged offer = slot.load(std::memory_order_relaxed);
+			if (indexOf(offer) == 0) return 0;
+			if (!slot.compare_exchange_strong(offer, tagged(0, offer), std::memory_order_acquire,
+				std::memory_order_relaxed)) {
+				return 0;
+			}
+			return indexOf(offer);
+		}
+
+		void pushIndex(uint32_t index) {
+			Node* n = node(index);
+			Tagged top = m_top.load(std::memory_order_relaxed);
+			while (true) {
+				n->next.store(indexOf(top), std::memory_order_relaxed);
+				if (m_top.compare_exchange_weak(top, tagged(index, top), std::memory_order_release,
+					std::memory_order_relaxed)) {
+					return;
+				}
+				// contended: try to hand the node to a pop directly
+				if (m_eliminate && eliminatePush(index)) return;
+				top = m_top.load(std::memory_order_relaxed);
+			}
+		}
+
+		uint32_t popIndex() {
+			Tagged top = m_top.load(std::memory_order_acquire);
+			while (indexOf(top) != 0) {
+				uint32_t next = node(indexOf(top))->next.load(std::memory_order_relaxed);
+				if (m_top.compare_exchange_weak(top, tagged(next, top), std::memory_order_acquire,
+					std::memory_order_acquire)) {
+					return indexOf(top);
+				}
+				if (m_eliminate) {
+					uint32_t index = eliminatePop();
+					if (index != 0) return index;
+					top = m_top.load(std::memory_order_acquire);
+				}
+			}
+			return 0;
+		}
+
+	public:
+		/* @param reserve number of nodes to allocate up front
+		* @param eliminate use the elimination array under contention
+		*/
+		ConcurrentStack(int reserve = 0, bool eliminate = true) : m_top(0), m_free(0), m_chunkCount(0),
+			m_eliminate(eliminate) {
+			for (int i = 0; i < concurrent_stack_detail::ELIMINATION_SLOTS; i++) m_elimination[i].store(0);
+			for (int i = 0; i < concurrent_stack_detail::MAX_CHUNKS; i++) m_chunks[i].store(nullptr);
+			while (getPoolSize() < reserve) addChunk();
+		}
+
+		/* Note: no other thread may use the stack while it is destroyed
+		*/
+		~ConcurrentStack() {
+			for (uint32_t index = indexOf(m_top.load()); index != 0;) {
+				Node* n = node(index);
+				index = n->next.load();
+				n->value()->~T();
+			}
+			for (int i = 0; i < m_chunkCount.load(); i++) ::operator delete(m_chunks[i].load());
+		}
+
+		ConcurrentStack(const ConcurrentStack&) = delete;
+		ConcurrentStack& operator=(const ConcurrentStack&) = delete;
+
+		/* Push an element to the top of the stack
+		*/
+		void push(T value) {
+			emplace(std::move(value));
+		}
+
+		/* Construct an element from <args> at the top of the stack
+		*/
+		template <typename... Args>
+		void emplace(Args&&... args) {
+			uint32_t index = allocateNode();
+			try {
+				new (node(index)->value()) T(std::forward<Args>(args)...);
+			}
+			catch (...) {
+				pushChain(m_free, index, index);
+				throw;
+			}
+			pushIndex(index);
+		}
+
+		/* Move the element at the top of the stack into <value>
+		@return false if the stack is empty
+		*/
+		bool try_pop(T& value) {
+			uint32_t index = popIndex();
+			if (index == 0) return false;
+
+			T* element = node(index)->value();
+			value = std::move(*element);
+			element->~T();
+			pushChain(m_free, index, index);
+			return true;
+		}
+
+		/* Remove the element at the top of the stack and return it
+		* Note: throws an error if the stack is empty
+		*/
+		T pop() {
+			uint32_t index = popIndex();
+			if (index == 0) throw exception_empty;
+
+			T* element = node(index)->value();
+			T value = std::move(*element);
+			element->~T();
+			pushChain(m_free, index, index);
+			return value;
+		}
+
+		/* Note: only a snapshot while other threads are running
+		*/
+		inline bool is_empty() const {
+			return indexOf(m_top.load(std::memory_order_acquire)) == 0;
+		}
+
+		/* Number of nodes in the pool, used or not
+		*/
+		inline int getPoolSize() const {
+			return ((1 << m_chunkCount.load(std::memory_order_relaxed)) - 1) << concurrent_stack_detail::FIRST_CHUNK_SHIFT;
+		}
+	};
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+// runtime CPU feature detection so that SIMD kernels can be picked at runtime while the
+// rest of the program is compiled for the baseline instruction set
+// https://en.wikipedia.org/wiki/CPUID
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ALG_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#else
+#define ALG_X86 0
+#endif
+
+// functions using AVX2 intrinsics have to be marked so gcc/clang allow them without -mavx2;
+// MSVC allows any intrinsic anywhere
+#if defined(_MSC_VER)
+#define ALG_TARGET_AVX2
+#define ALG_FORCE_INLINE __forceinline
+#else
+#define ALG_TARGET_AVX2 __attribute__((target("avx2")))
+#define ALG_FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
+namespace alg {
+	struct CpuFeatures {
+		bool sse2;
+		bool avx2;
+	};
+
+	namespace cpu_detail {
+#if ALG_X86
+		inline void cpuid(int info[4], int leaf, int subleaf) {
+#if defined(_MSC_VER)
+			__cpuidex(info, leaf, subleaf);
+#else
+			unsigned int a, b, c, d;
+			__cpuid_count(leaf, subleaf, a, b, c, d);
+			info[0] = (int)a;
+			info[1] = (int)b;
+			info[2] = (int)c;
+			info[3] = (int)d;
+#endif
+		}
+
+		/* Returns the XCR0 register, which tells whether the OS saves the AVX registers
+		* on context switches
+		*/
+		inline unsigned long long xgetbv() {
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			unsigned int eax, edx;
+			__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+			return ((unsigned long long)edx << 32) | eax;
+#endif
+		}
+#endif
+
+		inline CpuFeatures detect() {
+			CpuFeatures features = { false, false };
+#if ALG_X86
+			int info[4];
+			cpuid(info, 0, 0);
+			int maxLeaf = info[0];
+			if (maxLeaf < 1) return features;
+
+			cpuid(info, 1, 0);
+			features.sse2 = (info[3] & (1 << 26)) != 0;
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+
+			// AVX needs both the CPU and the OS (XMM and YMM state enabled in XCR0)
+			bool osAvx = osxsave && avx && (xgetbv() & 6) == 6;
+
+			if (osAvx && maxLeaf >= 7) {
+				cpuid(info, 7, 0);
+				features.avx2 = (info[1] & (1 << 5)) != 0;
+			}
+#endif
+			return features;
+		}
+	}
+
+	/* Tell the CPU that the thread is spin waiting (pause on x86), which saves power and
+	* leaves the core to the other hyperthread
+	*/
+	static inline void CpuRelax() {
+#if ALG_X86
+		_mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+		__asm__ __volatile__("yield");
+#endif
+	}
+
+	/* Returns the SIMD features supported by the CPU the program is running on
+	* Note: detected once and cached
+	*/
+	static const CpuFeatures& GetCpuFeatures() {
+		static const CpuFeatures features = cpu_detail::detect();
+		return features;
+	}
+}
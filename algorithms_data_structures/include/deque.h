@@ -0,0 +1,354 @@
+#pragma once
+#include <exception>
+#include <new>
+#include <string>
+#include <utility>
+
+// unbounded double ended queue made of fixed size blocks
+// the elements live in blocks of BLOCK_SIZE slots; a block map, itself a circular buffer of block
+// pointers, keeps them in order. Both ends grow by one block at a time, so pushing and popping
+// at either end never moves an element, and the i-th element is found with a shift and a mask.
+// Blocks that run empty are kept as spares (up to SPARE_BLOCKS) and reused, so a deque that
+// goes up and down around the same size stops allocating; everything beyond that is freed, so
+// the memory used follows the number of elements instead of the largest burst.
+// https://en.wikipedia.org/wiki/Double-ended_queue
+// https://en.wikipedia.org/wiki/Circular_buffer
+
+namespace alg {
+	namespace deque_detail {
+		// about this many bytes per block, and never fewer than 16 elements
+		const size_t BLOCK_BYTES = 4096;
+
+		constexpr int blockShift(size_t elementSize) {
+			int shift = 4;
+			while (((size_t)2 << shift) * elementSize <= BLOCK_BYTES) shift++;
+			return shift;
+		}
+	}
+
+	template<typename T>
+	class Deque {
+	private:
+		class DequeEmptyException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "deque is empty";
+			}
+		} exception_empty;
+
+		class DequeIndexOutOfBoundsException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "deque index out of bounds";
+			}
+		} exception_ioob;
+
+		enum {
+			BLOCK_SHIFT = deque_detail::blockShift(sizeof(T)),
+			BLOCK_SIZE = 1 << BLOCK_SHIFT, // elements per block
+			BLOCK_MASK = BLOCK_SIZE - 1,
+			MIN_MAP_CAPACITY = 8,
+			SPARE_BLOCKS = 2
+		};
+
+		T** m_map; // circular buffer of blocks; its capacity is a power of two
+		int m_mapCapacity;
+		int m_mapFront; // map index of the first block
+		int m_blockCount; // blocks in use
+		int m_size;
+
+		// cursors into the first and the last block, so that the ends are reached without going
+		// through the map; all of them are null while there are no blocks
+		T* m_front; // the front element
+		T* m_frontEnd; // end of the first block
+		T* m_back; // one past the last element
+		T* m_backEnd; // end of the last block
+
+		T* m_spare[SPARE_BLOCKS];
+		int m_spareCount;
+
+		inline T*& block(int index) {
+			return m_map[(m_mapFront + index) & (m_mapCapacity - 1)];
+		}
+
+		/* The element <index> places behind the front
+		*/
+		inline T& element(int index) {
+			int position = (int)(m_front - (m_frontEnd - BLOCK_SIZE)) + index;
+			return block(position >> BLOCK_SHIFT)[position & BLOCK_MASK];
+		}
+
+		T* acquireBlock() {
+			if (m_spareCount > 0) return m_spare[--m_spareCount];
+			return static_cast<T*>(::operator new(sizeof(T) * BLOCK_SIZE));
+		}
+
+		void releaseBlock(T* b) {
+			if (m_spareCount < SPARE_BLOCKS) {
+				m_spare[m_spareCount++] = b;
+			}
+			else {
+				::operator delete(b);
+			}
+		}
+
+		/* Lay the blocks out again from the start of a map of <capacity> entries
+		*/
+		void resizeMap(int capacity) {
+			T** map = new T*[capacity];
+			for (int i = 0; i < m_blockCount; i++) map[i] = block(i);
+			delete[] m_map;
+			m_map = map;
+			m_mapCapacity = capacity;
+			m_mapFront = 0;
+		}
+
+		// the map only shrinks once it is a quarter full, so it can not flip back and forth
+		inline void shrinkMap() {
+			if (m_mapCapacity > MIN_MAP_CAPACITY && m_blockCount * 4 <= m_mapCapacity) {
+				resizeMap(m_mapCapacity / 2);
+			}
+		}
+
+		/* Give up the last remaining block of an empty deque
+		*/
+		void removeLastBlock() {
+			releaseBlock(block(0));
+			m_blockCount = 0;
+			m_mapFront = 0;
+			m_front = m_frontEnd = m_back = m_backEnd = nullptr;
+		}
+
+		/* Append an empty block and move the back cursor to its start
+		*/
+		void addBlockBack() {
+			if (m_blockCount == m_mapCapacity) resizeMap(m_mapCapacity * 2);
+			T* b = acquireBlock();
+			block(m_blockCount++) = b;
+			m_back = b;
+			m_backEnd = b + BLOCK_SIZE;
+			if (m_blockCount == 1) {
+				m_front = b;
+				m_frontEnd = m_backEnd;
+			}
+		}
+
+		/* Prepend an empty block and move the front cursor to its end
+		*/
+		void addBlockFront() {
+			if (m_blockCount == m_mapCapacity) resizeMap(m_mapCapacity * 2);
+			T* b = acquireBlock();
+			m_mapFront = (m_mapFront - 1) & (m_mapCapacity - 1);
+			m_map[m_mapFront] = b;
+			m_front = m_frontEnd = b + BLOCK_SIZE;
+			if (++m_blockCount == 1) m_back = m_backEnd = m_frontEnd;
+		}
+
+		/* Drop the last block, which holds no elements; the back cursor moves to the end of the
+		* block before it
+		*/
+		void removeBlockBack() {
+			if (m_blockCount == 1) {
+				removeLastBlock();
+				return;
+			}
+			releaseBlock(block(--m_blockCount));
+			m_back = m_backEnd = block(m_blockCount - 1) + BLOCK_SIZE;
+			shrinkMap();
+		}
+
+		/* Drop the first block, which holds no elements; the front cursor moves to the start of
+		* the block after it
+		*/
+		void removeBlockFront() {
+			if (m_blockCount == 1) {
+				removeLastBlock();
+				return;
+			}
+			releaseBlock(m_map[m_mapFront]);
+			m_mapFront = (m_mapFront + 1) & (m_mapCapacity - 1);
+			m_blockCount--;
+			m_front = m_map[m_mapFront];
+			m_frontEnd = m_front + BLOCK_SIZE;
+			shrinkMap();
+		}
+
+	public:
+		Deque() {
+			m_mapCapacity = MIN_MAP_CAPACITY;
+			m_map = new T*[m_mapCapacity];
+			m_mapFront = 0;
+			m_blockCount = 0;
+			m_size = 0;
+			m_front = m_frontEnd = m_back = m_backEnd = nullptr;
+			m_spareCount = 0;
+		}
+
+		~Deque() {
+			clear();
+			shrink_to_fit();
+			delete[] m_map;
+		}
+
+		Deque(const Deque&) = delete;
+		Deque& operator=(const Deque&) = delete;
+
+		inline bool is_empty() const {
+			return m_size == 0;
+		}
+
+		inline int getSize() const {
+			return m_size;
+		}
+
+		/* Number of blocks holding elements, not counting the spares
+		*/
+		inline int getBlockCount() const {
+			return m_blockCount;
+		}
+
+		inline static int getBlockSize() {
+			return BLOCK_SIZE;
+		}
+
+		/* Construct an element from <args> at the end of the deque
+		@return the new element
+		*/
+		template <typename... Args>
+		T& emplace_back(Args&&... args) {
+			bool added = m_back == m_backEnd;
+			if (added) addBlockBack();
+
+			try {
+				new (m_back) T(std::forward<Args>(args)...);
+			}
+			catch (...) {
+				if (added) removeBlockBack();
+				throw;
+			}
+			m_size++;
+			return *m_back++;
+		}
+
+		/* Construct an element from <args> at the front of the deque
+		@return the new element
+		*/
+		template <typename... Args>
+		T& emplace_front(Args&&... args) {
+			bool added = m_blockCount == 0 || m_front == m_frontEnd - BLOCK_SIZE;
+			if (added) addBlockFront();
+
+			try {
+				new (m_front - 1) T(std::forward<Args>(args)...);
+			}
+			catch (...) {
+				if (added) removeBlockFront();
+				throw;
+			}
+			m_size++;
+			return *--m_front;
+		}
+
+		inline void push_back(const T& value) {
+			emplace_back(value);
+		}
+
+		inline void push_back(T&& value) {
+			emplace_back(std::move(value));
+		}
+
+		inline void push_front(const T& value) {
+			emplace_front(value);
+		}
+
+		inline void push_front(T&& value) {
+			emplace_front(std::move(value));
+		}
+
+		/* Remove the element at the end of the deque and return it (moved out)
+		* Note: throws an error if the deque is empty
+		*/
+		T pop_back() {
+			if (m_size == 0) throw exception_empty;
+
+			T* slot = --m_back;
+			T value = std::move(*slot);
+			slot->~T();
+			m_size--;
+
+			// the last block ran empty
+			if (m_back == m_backEnd - BLOCK_SIZE) removeBlockBack();
+			return value;
+		}
+
+		/* Remove the element at the front of the deque and return it (moved out)
+		* Note: throws an error if the deque is empty
+		*/
+		T pop_front() {
+			if (m_size == 0) throw exception_empty;
+
+			T* slot = m_front++;
+			T value = std::move(*slot);
+			slot->~T();
+			m_size--;
+
+			// the first block ran empty
+			if (m_front == m_frontEnd) removeBlockFront();
+			return value;
+		}
+
+		inline T& front() {
+			if (m_size == 0) throw exception_empty;
+			return *m_front;
+		}
+
+		inline T& back() {
+			if (m_size == 0) throw exception_empty;
+			return *(m_back - 1);
+		}
+
+		/* Return value by index, starting at the front of the deque
+		@return the element at the specified index
+		*/
+		inline T& operator [] (int index) {
+			if (index < 0 || index >= m_size) {
+				throw exception_ioob;
+			}
+			return element(index);
+		}
+
+		inline const T& operator [] (int index) const {
+			return const_cast<Deque&>(*this)[index];
+		}
+
+		/* Remove every element; the blocks go back to the spares (or are freed)
+		*/
+		void clear() {
+			for (int i = 0; i < m_size; i++) element(i).~T();
+			while (m_blockCount > 0) releaseBlock(block(--m_blockCount));
+			if (m_mapCapacity > MIN_MAP_CAPACITY) resizeMap(MIN_MAP_CAPACITY);
+			m_mapFront = 0;
+			m_size = 0;
+			m_front = m_frontEnd = m_back = m_backEnd = nullptr;
+		}
+
+		/* Free the spare blocks
+		*/
+		void shrink_to_fit() {
+			while (m_spareCount > 0) ::operator delete(m_spare[--m_spareCount]);
+		}
+
+		// WARNING: make sure std::to_string works on type T
+		std::string toString() {
+			std::string str;
+			str += "Printing Deque:\n\t[";
+			for (int i = 0; i < m_size; i++) {
+				if (i > 0) str += ", ";
+				str += std::to_string(element(i));
+			}
+			str += "]\n\tSize: " + std::to_string(m_size);
+			str += " Blocks: " + std::to_string(m_blockCount) + "\n";
+			return str;
+		}
+	};
+}
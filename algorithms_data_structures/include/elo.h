@@ -1,9 +1,19 @@
 #pragma once
+#include "cpu_features.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <tuple>
 #include <math.h>
 
 #define KVALUE 32
 
+// passing vectors by value between the force inlined kernel and its helpers is fine here
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
 namespace alg {
 	// reference: https://en.wikipedia.org/wiki/Elo_rating_system#Mathematical_details
 	// cool video: https://www.youtube.com/watch?v=AsYfbmp0To0
@@ -29,4 +39,154 @@ namespace alg {
 
 		return std::make_tuple((int)newA, (int)newB);
 	}
-}
\ No newline at end of file
+
+	namespace elo_detail {
+		const double LN2 = 0.693147180559945309417;
+		// 10^(x / 400) == 2^(x * LOG2_10 / 400)
+		const double LOG2_10_OVER_400 = 3.32192809488736234787 / 400;
+		// clamp for the exponent; 2^-1000 is far below what can still move an expectation
+		const double MAX_EXPONENT = 1000.0;
+		// adding and subtracting 1.5 * 2^52 rounds anything this small to the nearest integer
+		// (ties to even), without needing SSE4.1 or a call to nearbyint
+		const double ROUNDING = 6755399441055744.0;
+
+		// 2^x = 2^n * e^(r) with n = round(x) and r = (x - n) * ln 2, |r| <= 0.35; e^(r) is
+		// its Taylor series up to r^12 (1/k! below), whose remainder is under 2e-16 relative,
+		// so the result stays within a few ulp of pow()
+		const double C2 = 1.0 / 2, C3 = 1.0 / 6, C4 = 1.0 / 24, C5 = 1.0 / 120, C6 = 1.0 / 720,
+			C7 = 1.0 / 5040, C8 = 1.0 / 40320, C9 = 1.0 / 362880, C10 = 1.0 / 3628800,
+			C11 = 1.0 / 39916800, C12 = 1.0 / 479001600;
+
+		/* 2^x for |x| <= MAX_EXPONENT
+		* Note: the AVX2 kernel does the same operations in the same order, so both agree to
+		* the bit
+		*/
+		inline double exp2(double x) {
+			x = x < -MAX_EXPONENT ? -MAX_EXPONENT : (x > MAX_EXPONENT ? MAX_EXPONENT : x);
+			double n = (x + ROUNDING) - ROUNDING;
+			double r = (x - n) * LN2;
+			double p = C12;
+			p = p * r + C11;
+			p = p * r + C10;
+			p = p * r + C9;
+			p = p * r + C8;
+			p = p * r + C7;
+			p = p * r + C6;
+			p = p * r + C5;
+			p = p * r + C4;
+			p = p * r + C3;
+			p = p * r + C2;
+			p = p * r + 1.0;
+			p = p * r + 1.0;
+
+			// 2^n, built directly in the exponent field
+			uint64_t bits = (uint64_t)((int64_t)n + 1023) << 52;
+			double scale;
+			std::memcpy(&scale, &bits, sizeof(scale));
+			return p * scale;
+		}
+
+		/* Plays one game: player A's expected score is 1 / (1 + 10^((B - A) / 400)), and
+		* whatever A gains B loses
+		*/
+		inline void playGame(double* ratings, int a, int b, double resultA, double k) {
+			double expectedA = 1.0 / (1.0 + exp2((ratings[b] - ratings[a]) * LOG2_10_OVER_400));
+			double delta = k * (resultA - expectedA);
+			ratings[a] += delta;
+			ratings[b] -= delta;
+		}
+
+		inline void evaluateScalar(double* ratings, const int* playersA, const int* playersB,
+			const double* resultsA, size_t count, double k) {
+			for (size_t i = 0; i < count; i++) playGame(ratings, playersA[i], playersB[i], resultsA[i], k);
+		}
+
+#if ALG_X86
+		ALG_TARGET_AVX2 ALG_FORCE_INLINE __m256d exp2Avx2(__m256d x) {
+			x = _mm256_max_pd(_mm256_min_pd(x, _mm256_set1_pd(MAX_EXPONENT)), _mm256_set1_pd(-MAX_EXPONENT));
+			__m256d rounding = _mm256_set1_pd(ROUNDING);
+			__m256d n = _mm256_sub_pd(_mm256_add_pd(x, rounding), rounding);
+			__m256d r = _mm256_mul_pd(_mm256_sub_pd(x, n), _mm256_set1_pd(LN2));
+			const double coefficients[] = { C11, C10, C9, C8, C7, C6, C5, C4, C3, C2, 1.0, 1.0 };
+			__m256d p = _mm256_set1_pd(C12);
+			for (double c : coefficients) p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(c));
+
+			__m256i exponent = _mm256_cvtepi32_epi64(_mm_add_epi32(_mm256_cvtpd_epi32(n), _mm_set1_epi32(1023)));
+			__m256d scale = _mm256_castsi256_pd(_mm256_slli_epi64(exponent, 52));
+			return _mm256_mul_pd(p, scale);
+		}
+
+		/* Four games at a time; a group of four in which a player shows up twice is played one
+		* game after the other instead, so the result is exactly that of the scalar loop
+		*/
+		ALG_TARGET_AVX2 static void evaluateAvx2(double* ratings, const int* playersA, const int* playersB,
+			const double* resultsA, size_t count, double k) {
+			const __m256d one = _mm256_set1_pd(1.0);
+			const __m256d scale = _mm256_set1_pd(LOG2_10_OVER_400);
+			const __m256d kValue = _mm256_set1_pd(k);
+			// rotating the 8 indices by 1 to 4 lanes lines every pair up once
+			const __m256i rotations[] = {
+				_mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0), _mm256_setr_epi32(2, 3, 4, 5, 6, 7, 0, 1),
+				_mm256_setr_epi32(3, 4, 5, 6, 7, 0, 1, 2), _mm256_setr_epi32(4, 5, 6, 7, 0, 1, 2, 3)
+			};
+
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				__m128i a = _mm_loadu_si128((const __m128i*)(playersA + i));
+				__m128i b = _mm_loadu_si128((const __m128i*)(playersB + i));
+				__m256i players = _mm256_setr_m128i(a, b);
+				__m256i same = _mm256_setzero_si256();
+				for (const __m256i& rotation : rotations) {
+					same = _mm256_or_si256(same, _mm256_cmpeq_epi32(players, _mm256_permutevar8x32_epi32(players, rotation)));
+				}
+				if (!_mm256_testz_si256(same, same)) {
+					evaluateScalar(ratings, playersA + i, playersB + i, resultsA + i, 4, k);
+					continue;
+				}
+
+				const int* A = playersA + i;
+				const int* B = playersB + i;
+				__m256d ratingA = _mm256_setr_pd(ratings[A[0]], ratings[A[1]], ratings[A[2]], ratings[A[3]]);
+				__m256d ratingB = _mm256_setr_pd(ratings[B[0]], ratings[B[1]], ratings[B[2]], ratings[B[3]]);
+				__m256d q = exp2Avx2(_mm256_mul_pd(_mm256_sub_pd(ratingB, ratingA), scale));
+				__m256d expectedA = _mm256_div_pd(one, _mm256_add_pd(one, q));
+				__m256d delta = _mm256_mul_pd(kValue, _mm256_sub_pd(_mm256_loadu_pd(resultsA + i), expectedA));
+
+				// no scatter in AVX2
+				double newA[4], newB[4];
+				_mm256_storeu_pd(newA, _mm256_add_pd(ratingA, delta));
+				_mm256_storeu_pd(newB, _mm256_sub_pd(ratingB, delta));
+				for (int lane = 0; lane < 4; lane++) {
+					ratings[playersA[i + lane]] = newA[lane];
+					ratings[playersB[i + lane]] = newB[lane];
+				}
+			}
+			evaluateScalar(ratings, playersA + i, playersB + i, resultsA + i, count - i, k);
+		}
+#endif
+	}
+
+	/* Replays <count> games in order against a table of ratings, keeping full precision
+	* The games are given as parallel arrays (structure of arrays), so four of them can be
+	* loaded into SIMD registers at once; 10^(x/400) is approximated to within a few ulp instead
+	* of calling pow() twice. Uses AVX2 when the CPU has it, with identical results either way.
+	* @param ratings: the rating of every player, updated in place
+	* @param playersA, playersB: the indices into <ratings> of the two players of each game
+	* @param resultsA: the result of each game according to player A;
+	* 1 A wins, 0 B wins, 0.5 tie
+	*/
+	static void EloEvaluateBatch(double* ratings, const int* playersA, const int* playersB,
+		const double* resultsA, size_t count, double k = KVALUE) {
+#if ALG_X86
+		if (GetCpuFeatures().avx2) {
+			elo_detail::evaluateAvx2(ratings, playersA, playersB, resultsA, count, k);
+			return;
+		}
+#endif
+		elo_detail::evaluateScalar(ratings, playersA, playersB, resultsA, count, k);
+	}
+}
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
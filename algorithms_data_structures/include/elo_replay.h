@@ -0,0 +1,144 @@
+#pragma once
+#include "elo.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// parallel replay of a time ordered game log
+// a game only reads and writes the ratings of its own two players, so two games that share no
+// player can be played in either order, or at the same time, with the same outcome. The log is
+// split into waves once: a game goes into the wave right after the last wave that holds one of
+// its players, which keeps every player's games in their original order while no player shows
+// up twice within a wave. The waves are then played one after the other, each one spread over
+// the threads, and the ratings come out bit-identical to a serial replay of the log, whatever
+// the number of threads.
+// https://en.wikipedia.org/wiki/Elo_rating_system
+// https://en.wikipedia.org/wiki/Graph_coloring (the waves are a greedy edge coloring that
+// respects the order of the games)
+
+namespace alg {
+	namespace elo_replay_detail {
+		// waves smaller than this are played on the calling thread alone
+		const size_t PARALLEL_THRESHOLD = 1 << 12;
+		// smallest piece of a wave handed to one task
+		const size_t GRAIN = 1 << 11;
+	}
+
+	class EloReplay {
+	private:
+		class IndexOutOfBoundsException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "player index out of bounds";
+			}
+		} exception_ioob;
+
+		// the games, regrouped by wave (and in log order within a wave)
+		std::vector<int> m_playersA;
+		std::vector<int> m_playersB;
+		std::vector<double> m_resultsA;
+		// wave w holds the games [m_waveStart[w], m_waveStart[w + 1])
+		std::vector<size_t> m_waveStart;
+		int m_playerCount;
+
+		void playWave(ThreadPool& pool, double* ratings, size_t wave, double k) const {
+			using namespace elo_replay_detail;
+			size_t first = m_waveStart[wave];
+			size_t size = m_waveStart[wave + 1] - first;
+			int threads = pool.getThreadCount() + 1;
+			if (size < PARALLEL_THRESHOLD || threads <= 1) {
+				EloEvaluateBatch(ratings, &m_playersA[first], &m_playersB[first], &m_resultsA[first], size, k);
+				return;
+			}
+
+			// a few pieces per thread so that stealing can even out the load
+			size_t grain = std::max(GRAIN, size / (threads * 4));
+			TaskGroup group(pool);
+			for (size_t begin = first; begin < first + size; begin += grain) {
+				size_t count = std::min(grain, first + size - begin);
+				group.run([this, ratings, begin, count, k]() {
+					EloEvaluateBatch(ratings, &m_playersA[begin], &m_playersB[begin], &m_resultsA[begin], count, k);
+				});
+			}
+			group.wait();
+		}
+
+	public:
+		/* Splits a game log into waves; the schedule can be replayed any number of times
+		* @param playersA, playersB: the two players of each game, indices below <playerCount>
+		* @param resultsA: the result of each game according to player A;
+		* 1 A wins, 0 B wins, 0.5 tie
+		* @param count: the number of games, in the order they were played
+		* Note: O(count + playerCount); throws an error if a player index is out of bounds
+		*/
+		EloReplay(const int* playersA, const int* playersB, const double* resultsA, size_t count, int playerCount) {
+			m_playerCount = playerCount;
+
+			// the wave of every game, and the number of games per wave
+			std::vector<int> waveOf(count);
+			std::vector<int> lastWave(playerCount, -1);
+			std::vector<size_t> waveSize;
+			for (size_t i = 0; i < count; i++) {
+				int a = playersA[i];
+				int b = playersB[i];
+				if (a < 0 || a >= playerCount || b < 0 || b >= playerCount) throw exception_ioob;
+
+				int wave = std::max(lastWave[a], lastWave[b]) + 1;
+				lastWave[a] = wave;
+				lastWave[b] = wave;
+				waveOf[i] = wave;
+				if (wave == (int)waveSize.size()) waveSize.push_back(0);
+				waveSize[wave]++;
+			}
+
+			// counting sort of the games by wave, stable so each wave keeps the log order
+			m_waveStart.assign(waveSize.size() + 1, 0);
+			for (size_t w = 0; w < waveSize.size(); w++) m_waveStart[w + 1] = m_waveStart[w] + waveSize[w];
+
+			std::vector<size_t> position(m_waveStart.begin(), m_waveStart.end() - 1);
+			m_playersA.resize(count);
+			m_playersB.resize(count);
+			m_resultsA.resize(count);
+			for (size_t i = 0; i < count; i++) {
+				size_t target = position[waveOf[i]]++;
+				m_playersA[target] = playersA[i];
+				m_playersB[target] = playersB[i];
+				m_resultsA[target] = resultsA[i];
+			}
+		}
+
+		/* Replays every game against <ratings> (playerCount entries, updated in place) using the
+		* threads of <pool>; the calling thread helps as well
+		* Note: the result is identical to EloEvaluateBatch over the log in its original order
+		*/
+		void replay(ThreadPool& pool, double* ratings, double k = KVALUE) const {
+			for (size_t wave = 0; wave + 1 < m_waveStart.size(); wave++) playWave(pool, ratings, wave, k);
+		}
+
+		/* Replays every game on <threads> threads
+		* @param threads the number of threads to use including the calling one;
+		* 0 uses every hardware thread
+		* Note: starts a pool for the call; pass a ThreadPool to reuse one across calls
+		*/
+		void replay(double* ratings, int threads, double k = KVALUE) const {
+			if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+			ThreadPool pool(threads - 1);
+			replay(pool, ratings, k);
+		}
+
+		inline size_t getGameCount() const {
+			return m_playersA.size();
+		}
+
+		inline size_t getWaveCount() const {
+			return m_waveStart.size() - 1;
+		}
+
+		inline int getPlayerCount() const {
+			return m_playerCount;
+		}
+	};
+}
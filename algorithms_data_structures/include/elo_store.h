@@ -0,0 +1,533 @@
+#pragma once
+#include "elo.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// persistent table of player ratings in a memory mapped file
+// the file is a header followed by one fixed size record per player ID, so opening it is a
+// single map call, a lookup is an index into the mapping, and rating updates are written in
+// place (the operating system writes the pages back; flush forces it). Any number of processes
+// can map the same file and read it while one process updates it.
+// Every record carries a sequence number (a seqlock): a writer makes it odd before it changes
+// the record and even again afterwards, and a reader retries until it saw the same even number
+// before and after reading, so it never returns half of an update. A record found with an odd
+// number when the file is opened was being written when its writer died: a torn write.
+// The process that opens the store for writing holds an exclusive lock on the file, which the
+// operating system drops when the process dies. A reader that keeps finding an odd number
+// checks that lock: while a writer holds it the reader waits (the writer may just not be
+// scheduled), once nobody does the record is torn and the reader throws. Torn records stay
+// torn, and are reported, until they are rewritten or explicitly repaired, since their fields
+// may be half of an update.
+// The header carries a checksum over its fields, so a truncated, foreign or half created file
+// is refused instead of being misread.
+// https://en.wikipedia.org/wiki/Memory-mapped_file
+// https://en.wikipedia.org/wiki/Seqlock
+
+namespace alg {
+	class EloStoreException : public std::exception {
+	private:
+		const char* m_message;
+	public:
+		EloStoreException(const char* message) : m_message(message) {}
+
+		virtual const char* what() const throw() {
+			return m_message;
+		}
+	};
+
+	/* One player's entry, as read from an EloStore
+	*/
+	struct EloRecord {
+		double rating;
+		uint32_t games;
+	};
+
+	namespace elo_store_detail {
+		const char MAGIC[8] = { 'A', 'L', 'G', 'E', 'L', 'O', 0, 0 };
+		const uint32_t VERSION = 1;
+		// a reader spins this many times on an odd sequence, then checks for a live writer and
+		// yields the thread
+		const int SPIN_LIMIT = 64;
+		// the byte the writer locks, far beyond the end of any store so the lock never covers
+		// data (locks are mandatory on Windows)
+		const uint64_t WRITER_LOCK_OFFSET = 1ull << 40;
+
+		struct Header {
+			char magic[8];
+			uint32_t version;
+			uint32_t recordSize;
+			uint64_t capacity;
+			double initialRating;
+			uint64_t checksum; // of every field above
+			unsigned char reserved[24];
+		};
+
+		struct Record {
+			std::atomic<uint32_t> sequence; // odd while the record is being written
+			std::atomic<uint32_t> games;
+			std::atomic<double> rating;
+		};
+
+		static_assert(sizeof(Header) == 64, "the header is one cache line");
+		static_assert(sizeof(Record) == 16, "records are 16 bytes in the file");
+		// the atomics live in memory shared between processes, so they must not hide a lock
+		static_assert(sizeof(std::atomic<uint32_t>) == 4 && sizeof(std::atomic<double>) == 8,
+			"atomics have to be plain values in the file");
+
+		/* FNV-1a over <size> bytes
+		*/
+		inline uint64_t checksum(const void* data, size_t size) {
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < size; i++) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+
+		inline uint64_t headerChecksum(const Header& header) {
+			return checksum(&header, offsetof(Header, checksum));
+		}
+	}
+
+	class EloStore {
+	private:
+		typedef elo_store_detail::Header Header;
+		typedef elo_store_detail::Record Record;
+
+		class IndexOutOfBoundsException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "player ID out of bounds";
+			}
+		} exception_ioob;
+
+		class ReadOnlyException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "rating store is opened read only";
+			}
+		} exception_read_only;
+
+		void* m_mapping;
+		size_t m_mappingSize;
+		Header* m_header;
+		Record* m_records;
+		int m_capacity;
+		bool m_readOnly;
+		int m_tornCount;
+		// (player, sequence) of the records that were torn when the store was opened, by player
+		std::vector<std::pair<int, uint32_t>> m_torn;
+#if defined(_WIN32)
+		HANDLE m_file;
+		HANDLE m_fileMapping;
+#else
+		int m_file;
+#endif
+
+		/* Opens (or creates with <capacity> records) the file at <path> and maps all of it
+		* @return true if the file was created
+		*/
+		bool mapFile(const char* path, int capacity) {
+			bool create = capacity > 0;
+			bool created = false;
+			size_t fileSize = 0;
+#if defined(_WIN32)
+			DWORD access = m_readOnly ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE;
+			m_file = CreateFileA(path, access, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+				create ? CREATE_NEW : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE && create && GetLastError() == ERROR_FILE_EXISTS) {
+				m_file = CreateFileA(path, access, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+					FILE_ATTRIBUTE_NORMAL, nullptr);
+			}
+			else if (m_file != INVALID_HANDLE_VALUE && create) {
+				created = true;
+			}
+			if (m_file == INVALID_HANDLE_VALUE) throw EloStoreException("could not open the rating store");
+
+			if (created) {
+				LARGE_INTEGER size;
+				size.QuadPart = (LONGLONG)(sizeof(Header) + sizeof(Record) * (size_t)capacity);
+				if (!SetFilePointerEx(m_file, size, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file)) {
+					throw EloStoreException("could not size the rating store");
+				}
+			}
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(m_file, &size)) throw EloStoreException("could not read the rating store size");
+			fileSize = (size_t)size.QuadPart;
+			if (fileSize < sizeof(Header)) throw EloStoreException("rating store is truncated");
+
+			m_fileMapping = CreateFileMappingA(m_file, nullptr, m_readOnly ? PAGE_READONLY : PAGE_READWRITE, 0, 0, nullptr);
+			if (m_fileMapping == nullptr) throw EloStoreException("could not map the rating store");
+			m_mapping = MapViewOfFile(m_fileMapping, m_readOnly ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, fileSize);
+			if (m_mapping == nullptr) throw EloStoreException("could not map the rating store");
+#else
+			int flags = m_readOnly ? O_RDONLY : O_RDWR;
+			m_file = create ? open(path, flags | O_CREAT | O_EXCL, 0644) : -1;
+			if (m_file >= 0) {
+				created = true;
+			}
+			else {
+				m_file = open(path, flags);
+			}
+			if (m_file < 0) throw EloStoreException("could not open the rating store");
+
+			if (created && ftruncate(m_file, (off_t)(sizeof(Header) + sizeof(Record) * (size_t)capacity)) != 0) {
+				throw EloStoreException("could not size the rating store");
+			}
+			struct stat status;
+			if (fstat(m_file, &status) != 0) throw EloStoreException("could not read the rating store size");
+			fileSize = (size_t)status.st_size;
+			if (fileSize < sizeof(Header)) throw EloStoreException("rating store is truncated");
+
+			void* mapping = mmap(nullptr, fileSize, m_readOnly ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+			if (mapping == MAP_FAILED) throw EloStoreException("could not map the rating store");
+			m_mapping = mapping;
+#endif
+			m_mappingSize = fileSize;
+			m_header = static_cast<Header*>(m_mapping);
+			m_records = reinterpret_cast<Record*>(m_header + 1);
+			return created;
+		}
+
+		void unmapFile() {
+#if defined(_WIN32)
+			if (m_mapping != nullptr) UnmapViewOfFile(m_mapping);
+			if (m_fileMapping != nullptr) CloseHandle(m_fileMapping);
+			if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+			m_fileMapping = nullptr;
+			m_file = INVALID_HANDLE_VALUE;
+#else
+			if (m_mapping != nullptr) munmap(m_mapping, m_mappingSize);
+			if (m_file >= 0) close(m_file);
+			m_file = -1;
+#endif
+			m_mapping = nullptr;
+		}
+
+		/* Takes the writer lock
+		* @return false if another store holds it
+		*/
+		bool lockWriter() {
+#if defined(_WIN32)
+			OVERLAPPED overlapped = {};
+			overlapped.Offset = (DWORD)elo_store_detail::WRITER_LOCK_OFFSET;
+			overlapped.OffsetHigh = (DWORD)(elo_store_detail::WRITER_LOCK_OFFSET >> 32);
+			return LockFileEx(m_file, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped) != 0;
+#elif defined(F_OFD_SETLK)
+			// an open file description lock: it conflicts with the probes of readers in the same process
+			struct flock lock = {};
+			lock.l_type = F_WRLCK;
+			lock.l_whence = SEEK_SET;
+			lock.l_start = (off_t)elo_store_detail::WRITER_LOCK_OFFSET;
+			lock.l_len = 1;
+			return fcntl(m_file, F_OFD_SETLK, &lock) == 0;
+#else
+			return flock(m_file, LOCK_EX | LOCK_NB) == 0;
+#endif
+		}
+
+		/* @return true if a store holds the writer lock (or it can not be told)
+		*/
+		bool writerAlive() const {
+#if defined(_WIN32)
+			// taking the lock shared for a moment is the only way to test it
+			OVERLAPPED overlapped = {};
+			overlapped.Offset = (DWORD)elo_store_detail::WRITER_LOCK_OFFSET;
+			overlapped.OffsetHigh = (DWORD)(elo_store_detail::WRITER_LOCK_OFFSET >> 32);
+			if (!LockFileEx(m_file, LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped)) return true;
+			UnlockFileEx(m_file, 0, 1, 0, &overlapped);
+			return false;
+#elif defined(F_OFD_GETLK)
+			struct flock lock = {};
+			lock.l_type = F_WRLCK;
+			lock.l_whence = SEEK_SET;
+			lock.l_start = (off_t)elo_store_detail::WRITER_LOCK_OFFSET;
+			lock.l_len = 1;
+			if (fcntl(m_file, F_OFD_GETLK, &lock) != 0) return true;
+			return lock.l_type != F_UNLCK;
+#else
+			if (flock(m_file, LOCK_SH | LOCK_NB) != 0) return true;
+			flock(m_file, LOCK_UN);
+			return false;
+#endif
+		}
+
+		/* @return true if <player>'s record still is the torn record found when the store was opened
+		*/
+		bool tornAtOpen(int player, uint32_t sequence) const {
+			auto found = std::lower_bound(m_torn.begin(), m_torn.end(), std::make_pair(player, (uint32_t)0));
+			return found != m_torn.end() && found->first == player && found->second == sequence;
+		}
+
+		/* Fills the records of a new file, then writes the header (checksum last), so that a
+		* file whose creator died half way is refused
+		*/
+		void format(int capacity, double initialRating) {
+			for (int i = 0; i < capacity; i++) {
+				new (&m_records[i].sequence) std::atomic<uint32_t>(0);
+				new (&m_records[i].games) std::atomic<uint32_t>(0);
+				new (&m_records[i].rating) std::atomic<double>(initialRating);
+			}
+
+			Header header;
+			std::memset(&header, 0, sizeof(header));
+			std::memcpy(header.magic, elo_store_detail::MAGIC, sizeof(header.magic));
+			header.version = elo_store_detail::VERSION;
+			header.recordSize = sizeof(Record);
+			header.capacity = (uint64_t)capacity;
+			header.initialRating = initialRating;
+			std::memcpy(m_header, &header, sizeof(header));
+			flush();
+
+			uint64_t checksum = elo_store_detail::headerChecksum(header);
+			std::memcpy(&m_header->checksum, &checksum, sizeof(checksum));
+			flush();
+		}
+
+		void validate() {
+			Header header;
+			std::memcpy(&header, m_header, sizeof(header));
+			if (std::memcmp(header.magic, elo_store_detail::MAGIC, sizeof(header.magic)) != 0) {
+				throw EloStoreException("not a rating store");
+			}
+			if (header.checksum != elo_store_detail::headerChecksum(header)) {
+				throw EloStoreException("rating store header is corrupt or still being created");
+			}
+			if (header.version != elo_store_detail::VERSION || header.recordSize != sizeof(Record)) {
+				throw EloStoreException("unsupported rating store version");
+			}
+			if (header.capacity > (uint64_t)INT32_MAX ||
+				m_mappingSize < sizeof(Header) + sizeof(Record) * (size_t)header.capacity) {
+				throw EloStoreException("rating store is truncated");
+			}
+			m_capacity = (int)header.capacity;
+
+			// torn records are only counted; their fields may be half of an update, so they stay
+			// torn until they are rewritten or repaired
+			m_torn.clear();
+			for (int i = 0; i < m_capacity; i++) {
+				uint32_t sequence = m_records[i].sequence.load(std::memory_order_relaxed);
+				if (sequence & 1) m_torn.push_back(std::make_pair(i, sequence));
+			}
+			m_tornCount = (int)m_torn.size();
+		}
+
+		void init(const char* path, int capacity, double initialRating) {
+			m_mapping = nullptr;
+			m_mappingSize = 0;
+#if defined(_WIN32)
+			m_file = INVALID_HANDLE_VALUE;
+			m_fileMapping = nullptr;
+#else
+			m_file = -1;
+#endif
+			try {
+				bool created = mapFile(path, capacity);
+				if (!m_readOnly && !lockWriter()) {
+					throw EloStoreException("rating store is already opened for writing");
+				}
+				if (created) format(capacity, initialRating);
+				validate();
+			}
+			catch (...) {
+				unmapFile();
+				throw;
+			}
+		}
+
+		inline Record& record(int player) const {
+			if (player < 0 || player >= m_capacity) throw exception_ioob;
+			return m_records[player];
+		}
+
+		/* Seqlock write: the sequence is odd while the fields change
+		*/
+		void write(Record& r, double rating, uint32_t games) {
+			// a torn record (odd already) goes straight to the next odd number
+			uint32_t sequence = (r.sequence.load(std::memory_order_relaxed) + 1) | 1;
+			r.sequence.store(sequence, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			r.rating.store(rating, std::memory_order_relaxed);
+			r.games.store(games, std::memory_order_relaxed);
+			r.sequence.store(sequence + 1, std::memory_order_release);
+		}
+
+		/* Seqlock read: retries until the sequence was the same even number before and after
+		* @throws EloStoreException if the record is torn
+		*/
+		EloRecord read(int player) const {
+			const Record& r = record(player);
+			EloRecord result;
+			int spins = 0;
+			for (;;) {
+				uint32_t before = r.sequence.load(std::memory_order_acquire);
+				if (before & 1) {
+					if (++spins <= elo_store_detail::SPIN_LIMIT) {
+						CpuRelax();
+						continue;
+					}
+					// the writer of a read-write store is this process, which only leaves the records
+					// torn at open behind; in a read only store the record is torn once no writer is
+					// alive and the number still has not moved
+					bool torn = m_readOnly ? !writerAlive() && r.sequence.load(std::memory_order_acquire) == before
+						: tornAtOpen(player, before);
+					if (torn) throw EloStoreException("rating record is torn");
+					std::this_thread::yield();
+					continue;
+				}
+				result.rating = r.rating.load(std::memory_order_relaxed);
+				result.games = r.games.load(std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				uint32_t after = r.sequence.load(std::memory_order_relaxed);
+				if (before == after) return result;
+			}
+		}
+
+	public:
+		/* Opens the store at <path> for reading and writing, creating it with <capacity>
+		* players rated <initialRating> if it does not exist yet
+		* Note: an existing store keeps its own capacity; only one store can have it open for
+		* writing at a time, a second one throws
+		*/
+		EloStore(const char* path, int capacity, double initialRating = 1500.0) {
+			m_readOnly = false;
+			init(path, capacity > 0 ? capacity : 0, initialRating);
+		}
+
+		/* Opens an existing store at <path> for reading only
+		*/
+		explicit EloStore(const char* path) {
+			m_readOnly = true;
+			init(path, 0, 0);
+		}
+
+		/* Note: unmaps without flushing; the operating system still writes the pages back
+		*/
+		~EloStore() {
+			unmapFile();
+		}
+
+		EloStore(const EloStore&) = delete;
+		EloStore& operator=(const EloStore&) = delete;
+
+		/* The player's rating and games played; never a half written update
+		* Note: waits while a live writer is in the middle of the record, however long it takes
+		* @throws EloStoreException if the record was torn by a writer that died and has not been
+		* rewritten or repaired since
+		*/
+		inline EloRecord get(int player) const {
+			return read(player);
+		}
+
+		inline double getRating(int player) const {
+			return get(player).rating;
+		}
+
+		/* Overwrites the player's record; this also ends a torn record
+		* Note: a record must only be written by one thread at a time
+		*/
+		void set(int player, double rating, uint32_t games) {
+			if (m_readOnly) throw exception_read_only;
+			write(record(player), rating, games);
+		}
+
+		/* Plays one game and writes both new ratings through to the store
+		* @param resultA: the result according to player A; 1 A wins, 0 B wins, 0.5 tie
+		* Note: same formula (and results) as EloEvaluateBatch
+		*/
+		void play(int playerA, int playerB, double resultA, double k = KVALUE) {
+			if (m_readOnly) throw exception_read_only;
+			Record& a = record(playerA);
+			Record& b = record(playerB);
+			// a torn rating is no base for the next one
+			if ((a.sequence.load(std::memory_order_relaxed) | b.sequence.load(std::memory_order_relaxed)) & 1) {
+				throw EloStoreException("rating record is torn");
+			}
+			// the writer is the only one changing these records, so it can read them directly
+			double ratings[2] = { a.rating.load(std::memory_order_relaxed), b.rating.load(std::memory_order_relaxed) };
+			elo_detail::playGame(ratings, 0, 1, resultA, k);
+			write(a, ratings[0], a.games.load(std::memory_order_relaxed) + 1);
+			write(b, ratings[1], b.games.load(std::memory_order_relaxed) + 1);
+		}
+
+		/* Plays <count> games in order, see EloEvaluateBatch
+		*/
+		void play(const int* playersA, const int* playersB, const double* resultsA, size_t count,
+			double k = KVALUE) {
+			for (size_t i = 0; i < count; i++) play(playersA[i], playersB[i], resultsA[i], k);
+		}
+
+		/* Writes the changed pages back to the file and waits for it
+		*/
+		void flush() {
+			if (m_readOnly) return;
+#if defined(_WIN32)
+			if (!FlushViewOfFile(m_mapping, 0) || !FlushFileBuffers(m_file)) {
+				throw EloStoreException("could not flush the rating store");
+			}
+#else
+			if (msync(m_mapping, m_mappingSize, MS_SYNC) != 0) throw EloStoreException("could not flush the rating store");
+#endif
+		}
+
+		/* Accepts a torn record's fields as they are, making it readable again
+		*/
+		void repair(int player) {
+			if (m_readOnly) throw exception_read_only;
+			Record& r = record(player);
+			uint32_t sequence = r.sequence.load(std::memory_order_relaxed);
+			if (sequence & 1) r.sequence.store(sequence + 1, std::memory_order_release);
+		}
+
+		/* @return true if the player's last update was cut off by a writer that died (or, in a
+		* read only store, is being written right now)
+		*/
+		inline bool isTorn(int player) const {
+			return (record(player).sequence.load(std::memory_order_acquire) & 1) != 0;
+		}
+
+		/* Number of torn records found when the store was opened
+		*/
+		inline int getTornCount() const {
+			return m_tornCount;
+		}
+
+		inline int getCapacity() const {
+			return m_capacity;
+		}
+
+		inline double getInitialRating() const {
+			return m_header->initialRating;
+		}
+
+		inline bool isReadOnly() const {
+			return m_readOnly;
+		}
+	};
+}
@@ -0,0 +1,237 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// epoch based memory reclamation for lock-free data structures
+// readers wrap every access in an EpochGuard, which announces the global epoch the thread
+// started in. Memory that has been unlinked is retired instead of deleted and only freed once
+// the global epoch has moved two steps past the epoch it was retired in; the epoch can only
+// advance when every thread inside a guard has seen the current one, so by then no thread can
+// still hold a pointer to it.
+// RE: Fraser, Practical lock-freedom (2004), section 5.2.3
+// https://en.wikipedia.org/wiki/Read-copy-update
+
+namespace alg {
+	namespace epoch_detail {
+		// try to advance the epoch after this many retirements on a thread
+		const unsigned ADVANCE_INTERVAL = 64;
+
+		struct Retired {
+			void* pointer;
+			void (*deleter)(void*);
+		};
+
+		// one per thread that ever entered a guard; never freed, but reused after the thread exits
+		struct ThreadRecord {
+			// (epoch << 1) | 1 while the thread is inside a guard, 0 otherwise
+			std::atomic<uint64_t> state;
+			std::atomic<bool> inUse;
+			ThreadRecord* next; // the record list only ever grows at the head
+
+			// owned by the thread using the record
+			unsigned nesting;
+			unsigned retiredSinceAdvance;
+			std::vector<Retired> limbo[3]; // bucket epoch % 3 holds what was retired in epoch
+			uint64_t limboEpoch[3];
+		};
+
+		struct Domain {
+			alignas(64) std::atomic<uint64_t> epoch;
+			std::atomic<ThreadRecord*> records;
+
+			// retired memory left behind by exited threads, tagged with a safe retire epoch
+			std::mutex orphanMutex;
+			std::vector<std::pair<uint64_t, Retired>> orphans;
+
+			Domain() : epoch(0), records(nullptr) {}
+		};
+
+		inline Domain& domain() {
+			static Domain instance;
+			return instance;
+		}
+
+		inline void freeAll(std::vector<Retired>& retired) {
+			for (const Retired& r : retired) r.deleter(r.pointer);
+			retired.clear();
+		}
+
+		/* Frees the buckets of <record> that are at least two epochs old
+		*/
+		inline void freeExpired(ThreadRecord& record, uint64_t epoch) {
+			for (int i = 0; i < 3; i++) {
+				if (!record.limbo[i].empty() && record.limboEpoch[i] + 2 <= epoch) freeAll(record.limbo[i]);
+			}
+		}
+
+		inline void freeOrphans(Domain& d, uint64_t epoch) {
+			std::unique_lock<std::mutex> lock(d.orphanMutex, std::try_to_lock);
+			if (!lock.owns_lock()) return;
+
+			size_t kept = 0;
+			for (size_t i = 0; i < d.orphans.size(); i++) {
+				if (d.orphans[i].first + 2 <= epoch) {
+					d.orphans[i].second.deleter(d.orphans[i].second.pointer);
+				}
+				else {
+					d.orphans[kept++] = d.orphans[i];
+				}
+			}
+			d.orphans.resize(kept);
+		}
+
+		/* Moves the global epoch forward if every thread inside a guard has seen it
+		* @return the global epoch afterwards
+		*/
+		inline uint64_t tryAdvance(Domain& d) {
+			uint64_t epoch = d.epoch.load();
+			for (ThreadRecord* r = d.records.load(); r != nullptr; r = r->next) {
+				uint64_t state = r->state.load();
+				if ((state & 1) != 0 && (state >> 1) != epoch) return epoch;
+			}
+
+			if (d.epoch.compare_exchange_strong(epoch, epoch + 1)) epoch++;
+			return epoch;
+		}
+
+		/* Hands the record of the current thread back when it exits
+		*/
+		struct RecordOwner {
+			ThreadRecord* record;
+
+			RecordOwner() : record(nullptr) {}
+
+			~RecordOwner() {
+				if (record == nullptr) return;
+
+				// whatever is still waiting is handed to the domain, tagged with the current
+				// epoch, which is at least as late as the epoch it was retired in
+				Domain& d = domain();
+				uint64_t epoch = d.epoch.load();
+				{
+					std::lock_guard<std::mutex> lock(d.orphanMutex);
+					for (int i = 0; i < 3; i++) {
+						for (const Retired& r : record->limbo[i]) d.orphans.push_back(std::make_pair(epoch, r));
+						record->limbo[i].clear();
+					}
+				}
+				record->inUse.store(false);
+			}
+		};
+
+		inline ThreadRecord& threadRecord() {
+			thread_local RecordOwner owner;
+			if (owner.record != nullptr) return *owner.record;
+
+			Domain& d = domain();
+			// reuse the record of an exited thread if there is one
+			for (ThreadRecord* r = d.records.load(); r != nullptr; r = r->next) {
+				bool expected = false;
+				if (!r->inUse.load() && r->inUse.compare_exchange_strong(expected, true)) {
+					owner.record = r;
+					return *r;
+				}
+			}
+
+			ThreadRecord* record = new ThreadRecord;
+			record->state.store(0);
+			record->inUse.store(true);
+			record->nesting = 0;
+			record->retiredSinceAdvance = 0;
+			for (int i = 0; i < 3; i++) record->limboEpoch[i] = 0;
+
+			ThreadRecord* head = d.records.load();
+			do {
+				record->next = head;
+			} while (!d.records.compare_exchange_weak(head, record));
+
+			owner.record = record;
+			return *record;
+		}
+
+		inline void enter() {
+			ThreadRecord& record = threadRecord();
+			if (record.nesting++ > 0) return;
+
+			// announce the epoch; the seq_cst store orders it before every load in the guard
+			record.state.store((domain().epoch.load() << 1) | 1);
+		}
+
+		inline void exit() {
+			ThreadRecord& record = threadRecord();
+			if (--record.nesting > 0) return;
+
+			record.state.store(0, std::memory_order_release);
+		}
+
+		inline void retire(void* pointer, void (*deleter)(void*)) {
+			Domain& d = domain();
+			ThreadRecord& record = threadRecord();
+
+			uint64_t epoch = d.epoch.load();
+			int bucket = (int)(epoch % 3);
+			if (record.limboEpoch[bucket] != epoch) {
+				// the bucket holds memory from epoch - 3 or earlier, which is safe to free
+				freeAll(record.limbo[bucket]);
+				record.limboEpoch[bucket] = epoch;
+			}
+			Retired retired = { pointer, deleter };
+			record.limbo[bucket].push_back(retired);
+
+			if (++record.retiredSinceAdvance >= ADVANCE_INTERVAL) {
+				record.retiredSinceAdvance = 0;
+				epoch = tryAdvance(d);
+				freeExpired(record, epoch);
+				freeOrphans(d, epoch);
+			}
+		}
+	}
+
+	/* Marks the current thread as reading shared memory for its lifetime; pointers loaded from
+	* a lock-free structure inside the guard stay valid until it is destroyed
+	* Note: guards nest
+	*/
+	class EpochGuard {
+	public:
+		EpochGuard() {
+			epoch_detail::enter();
+		}
+
+		~EpochGuard() {
+			epoch_detail::exit();
+		}
+
+		EpochGuard(const EpochGuard&) = delete;
+		EpochGuard& operator=(const EpochGuard&) = delete;
+	};
+
+	/* Free <pointer> with <deleter> once no thread inside an EpochGuard can still reach it
+	* Note: <pointer> has to be unlinked already, so that threads entering a guard later can not
+	* find it
+	*/
+	static void EpochRetire(void* pointer, void (*deleter)(void*)) {
+		epoch_detail::retire(pointer, deleter);
+	}
+
+	template <typename T>
+	static void EpochRetire(T* pointer) {
+		epoch_detail::retire(pointer, [](void* p) { delete static_cast<T*>(p); });
+	}
+
+	/* Free everything retired so far by the calling thread and by exited threads, provided no
+	* thread is inside a guard; for tests and shutdown
+	*/
+	static void EpochCollect() {
+		using namespace epoch_detail;
+		Domain& d = domain();
+		ThreadRecord& record = threadRecord();
+
+		uint64_t epoch = d.epoch.load();
+		for (int i = 0; i < 3; i++) epoch = tryAdvance(d);
+		freeExpired(record, epoch);
+		freeOrphans(d, epoch);
+	}
+}
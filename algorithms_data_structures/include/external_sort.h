@@ -0,0 +1,347 @@
+#pragma once
+#include "sort.h"
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// external merge sort for files of fixed size binary records that do not fit in memory
+// 1. read memory sized runs, sort them in memory and spill them one after another to a
+//    temporary file
+// 2. k-way merge the runs with a loser tree, in several passes (ping-ponging between two
+//    temporary files) if there are too many runs to give each one a reasonably large buffer
+// all I/O is done in large sequential blocks (stdio buffering is turned off)
+// https://en.wikipedia.org/wiki/External_sorting
+// https://en.wikipedia.org/wiki/K-way_merge_algorithm#Tournament_Tree
+
+namespace alg {
+	class ExternalSortException : public std::exception {
+	private:
+		const char* m_message;
+	public:
+		ExternalSortException(const char* message) : m_message(message) {}
+
+		virtual const char* what() const throw() {
+			return m_message;
+		}
+	};
+
+	namespace external_sort_detail {
+		// every run being merged gets at least this much read buffer
+		const size_t MIN_MERGE_BUFFER_BYTES = 1 << 20;
+
+		inline std::FILE* openFile(const std::string& path, const char* mode) {
+			std::FILE* file = nullptr;
+#if defined(_MSC_VER)
+			if (fopen_s(&file, path.c_str(), mode) != 0) file = nullptr;
+#else
+			file = std::fopen(path.c_str(), mode);
+#endif
+			if (file != nullptr) std::setvbuf(file, nullptr, _IONBF, 0);
+			return file;
+		}
+
+		inline std::FILE* openTemporaryFile() {
+			std::FILE* file = nullptr;
+#if defined(_MSC_VER)
+			if (tmpfile_s(&file) != 0) file = nullptr;
+#else
+			file = std::tmpfile();
+#endif
+			if (file == nullptr) throw ExternalSortException("could not create a temporary run file");
+			std::setvbuf(file, nullptr, _IONBF, 0);
+			return file;
+		}
+
+		/* Closes the file when it goes out of scope
+		*/
+		struct FileCloser {
+			std::FILE* file;
+			FileCloser(std::FILE* f) : file(f) {}
+			~FileCloser() { if (file != nullptr) std::fclose(file); }
+		};
+
+		inline void seek(std::FILE* file, unsigned long long offset) {
+#if defined(_MSC_VER)
+			int result = _fseeki64(file, (long long)offset, SEEK_SET);
+#else
+			int result = fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+			if (result != 0) throw ExternalSortException("failed to seek in a run file");
+		}
+
+		template <typename T>
+		inline void writeRecords(std::FILE* file, const T* records, size_t count) {
+			if (count > 0 && std::fwrite(records, sizeof(T), count, file) != count) {
+				throw ExternalSortException("failed to write records");
+			}
+		}
+
+		/* Reads up to <capacity> records
+		* @return the number of records read; less than capacity only at the end of the file
+		*/
+		template <typename T>
+		inline size_t readRecords(std::FILE* file, T* records, size_t capacity) {
+			// read bytes rather than records so a partial record at the end can be detected
+			size_t bytes = std::fread(records, 1, capacity * sizeof(T), file);
+			if (bytes < capacity * sizeof(T) && std::ferror(file)) {
+				throw ExternalSortException("failed to read records");
+			}
+			if (bytes % sizeof(T) != 0) {
+				throw ExternalSortException("file size is not a multiple of the record size");
+			}
+			return bytes / sizeof(T);
+		}
+
+		/* A sorted run: <count> records starting at byte <offset> of a temporary file
+		*/
+		struct Run {
+			unsigned long long offset;
+			size_t count;
+		};
+
+		/* Sequential reader over a run with its own block buffer
+		* Note: all runs of a pass share one file, so every refill seeks first
+		*/
+		template <typename T>
+		class RunReader {
+		private:
+			std::FILE* m_file;
+			unsigned long long m_offset; // where the records not read yet start
+			size_t m_remaining; // records not read from the file yet
+			std::vector<T> m_buffer;
+			size_t m_position;
+			size_t m_size;
+
+			void refill() {
+				size_t count = m_remaining < m_buffer.size() ? m_remaining : m_buffer.size();
+				seek(m_file, m_offset);
+				if (std::fread(m_buffer.data(), sizeof(T), count, m_file) != count) {
+					throw ExternalSortException("failed to read a run file");
+				}
+				m_offset += count * sizeof(T);
+				m_remaining -= count;
+				m_position = 0;
+				m_size = count;
+			}
+
+		public:
+			RunReader(std::FILE* file, const Run& run, size_t bufferRecords) : m_file(file),
+				m_offset(run.offset), m_remaining(run.count), m_buffer(bufferRecords), m_position(0), m_size(0) {
+				refill();
+			}
+
+			inline bool isEmpty() const {
+				return m_position == m_size;
+			}
+
+			inline const T& current() const {
+				return m_buffer[m_position];
+			}
+
+			inline void advance() {
+				if (++m_position == m_size && m_remaining > 0) refill();
+			}
+		};
+
+		/* Loser tree over k sorted runs: m_tree[0] holds the index of the smallest current
+		* element, every internal node the loser of the match played there. Replacing the
+		* winner only replays the matches on its path to the root, so each output record costs
+		* log2(k) comparisons.
+		*/
+		template <typename T, typename Compare>
+		class LoserTree {
+		private:
+			std::vector<RunReader<T>>& m_runs;
+			std::vector<int> m_tree;
+			Compare m_comp;
+			int m_size;
+
+			// exhausted runs lose every match; ties go to the earlier run to keep the merge stable
+			inline bool beats(int a, int b) const {
+				if (m_runs[a].isEmpty()) return false;
+				if (m_runs[b].isEmpty()) return true;
+				if (m_comp(m_runs[a].current(), m_runs[b].current())) return true;
+				if (m_comp(m_runs[b].current(), m_runs[a].current())) return false;
+				return a < b;
+			}
+
+		public:
+			LoserTree(std::vector<RunReader<T>>& runs, Compare comp) : m_runs(runs), m_comp(comp) {
+				m_size = (int)runs.size();
+				m_tree.assign(m_size, 0);
+
+				// play the initial tournament bottom up; leaves are nodes size .. 2 * size - 1
+				std::vector<int> winners(2 * m_size);
+				for (int i = 0; i < m_size; i++) winners[m_size + i] = i;
+				for (int node = m_size - 1; node > 0; node--) {
+					int a = winners[2 * node];
+					int b = winners[2 * node + 1];
+					bool aWins = beats(a, b);
+					winners[node] = aWins ? a : b;
+					m_tree[node] = aWins ? b : a;
+				}
+				m_tree[0] = winners[1];
+			}
+
+			inline bool isEmpty() const {
+				return m_runs[m_tree[0]].isEmpty();
+			}
+
+			inline const T& top() const {
+				return m_runs[m_tree[0]].current();
+			}
+
+			/* Advance the winning run and replay its path to the root
+			*/
+			void pop() {
+				int winner = m_tree[0];
+				m_runs[winner].advance();
+
+				for (int node = (winner + m_size) / 2; node > 0; node /= 2) {
+					if (beats(m_tree[node], winner)) {
+						int temp = m_tree[node];
+						m_tree[node] = winner;
+						winner = temp;
+					}
+				}
+				m_tree[0] = winner;
+			}
+		};
+
+		/* Merges runs[first, last) of <input> into <output> at its current position
+		* @return the number of records written
+		*/
+		template <typename T, typename Compare>
+		size_t mergeRuns(std::FILE* input, const std::vector<Run>& runs, size_t first, size_t last,
+			std::FILE* output, size_t memoryBudget, Compare comp) {
+			size_t fanIn = last - first;
+			// one buffer per input run plus one for the output
+			size_t bufferRecords = memoryBudget / (fanIn + 1) / sizeof(T);
+			if (bufferRecords == 0) bufferRecords = 1;
+
+			std::vector<RunReader<T>> readers;
+			readers.reserve(fanIn);
+			for (size_t i = first; i < last; i++) {
+				readers.push_back(RunReader<T>(input, runs[i], bufferRecords));
+			}
+
+			LoserTree<T, Compare> tree(readers, comp);
+			std::vector<T> outputBuffer;
+			outputBuffer.reserve(bufferRecords);
+			size_t written = 0;
+
+			while (!tree.isEmpty()) {
+				outputBuffer.push_back(tree.top());
+				tree.pop();
+
+				if (outputBuffer.size() == bufferRecords) {
+					writeRecords(output, outputBuffer.data(), outputBuffer.size());
+					written += outputBuffer.size();
+					outputBuffer.clear();
+				}
+			}
+			writeRecords(output, outputBuffer.data(), outputBuffer.size());
+			written += outputBuffer.size();
+
+			return written;
+		}
+
+	}
+
+	/* Sort a file of fixed size binary records of type T into another file
+	@param inputPath the file to sort; its size has to be a multiple of sizeof(T)
+	@param outputPath the file to write the sorted records to (overwritten)
+	@param memoryBudget the number of bytes of records to hold in memory at once
+	@param comp the comparator; comp(a, b) returns true if a should come before b
+
+	Notes: T has to be trivially copyable since records are read and written as raw bytes;
+	runs are spilled to (at most two) temporary files that are deleted when the sort finishes.
+	Throws ExternalSortException on I/O errors.
+	*/
+	template <typename T, typename Compare>
+	static void ExternalSort(const std::string& inputPath, const std::string& outputPath,
+		size_t memoryBudget, Compare comp) {
+		static_assert(std::is_trivially_copyable<T>::value, "ExternalSort needs trivially copyable records");
+		using namespace external_sort_detail;
+
+		size_t runCapacity = memoryBudget / sizeof(T);
+		if (runCapacity == 0) runCapacity = 1;
+
+		std::FILE* input = openFile(inputPath, "rb");
+		if (input == nullptr) throw ExternalSortException("could not open the input file");
+		FileCloser inputCloser(input);
+
+		// phase 1: sorted runs
+		std::FILE* runFile = nullptr;
+		std::vector<Run> runs;
+		unsigned long long offset = 0;
+		{
+			std::vector<T> records(runCapacity);
+			while (true) {
+				size_t count = readRecords(input, records.data(), runCapacity);
+				if (count == 0) break;
+				Sort(records.begin(), records.begin() + count, comp);
+
+				if (runs.empty() && count < runCapacity) {
+					// everything fit in memory, so there is nothing to merge
+					std::FILE* output = openFile(outputPath, "wb");
+					if (output == nullptr) throw ExternalSortException("could not open the output file");
+					FileCloser outputCloser(output);
+					writeRecords(output, records.data(), count);
+					return;
+				}
+
+				if (runFile == nullptr) runFile = openTemporaryFile();
+				writeRecords(runFile, records.data(), count);
+				Run run = { offset, count };
+				runs.push_back(run);
+				offset += count * sizeof(T);
+				if (count < runCapacity) break;
+			}
+		}
+		FileCloser runCloser(runFile);
+
+		// phase 2: merge passes until few enough runs remain for the final merge
+		size_t maxFanIn = memoryBudget / MIN_MERGE_BUFFER_BYTES;
+		if (maxFanIn > 1) maxFanIn--; // leave room for the output buffer
+		if (maxFanIn < 2) maxFanIn = 2;
+
+		std::FILE* mergeFile = nullptr;
+		if (runs.size() > maxFanIn) mergeFile = openTemporaryFile();
+		FileCloser mergeCloser(mergeFile);
+
+		std::FILE* source = runFile;
+		std::FILE* target = mergeFile;
+		while (runs.size() > maxFanIn) {
+			std::vector<Run> merged;
+			offset = 0;
+			seek(target, 0);
+			for (size_t first = 0; first < runs.size(); first += maxFanIn) {
+				size_t last = first + maxFanIn < runs.size() ? first + maxFanIn : runs.size();
+				Run run = { offset, mergeRuns<T>(source, runs, first, last, target, memoryBudget, comp) };
+				merged.push_back(run);
+				offset += run.count * sizeof(T);
+			}
+
+			runs.swap(merged);
+			std::FILE* temp = source;
+			source = target;
+			target = temp;
+		}
+
+		std::FILE* output = openFile(outputPath, "wb");
+		if (output == nullptr) throw ExternalSortException("could not open the output file");
+		FileCloser outputCloser(output);
+		if (!runs.empty()) {
+			mergeRuns<T>(source, runs, 0, runs.size(), output, memoryBudget, comp);
+		}
+	}
+
+	template <typename T>
+	static void ExternalSort(const std::string& inputPath, const std::string& outputPath, size_t memoryBudget) {
+		ExternalSort<T>(inputPath, outputPath, memoryBudget, std::less<T>());
+	}
+}
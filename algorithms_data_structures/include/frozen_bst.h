@@ -0,0 +1,328 @@
+#pragma once
+#include "cpu_features.h"
+#include "memory_usage.h"
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <utility>
+
+// immutable search index in Eytzinger (breadth first) layout, made by BST::freeze() or
+// directly from sorted keys
+// The keys are stored the way a binary heap is: the root at index 1 and the children of k at
+// 2k and 2k + 1. A lookup then walks down with k = 2k + (keys[k] < key), which compiles to
+// a compare and an add instead of an unpredictable branch, and the nodes near the root share
+// a handful of cache lines. The 16 (for 4 byte keys) descendants four levels below a node are
+// next to each other in one cache line, so each step prefetches that line and by the time the
+// walk gets there it is (mostly) loaded: the memory latency of the levels overlaps instead of
+// adding up like it does when chasing node pointers.
+// Values are kept in a separate array with the same layout and read once at the end.
+// https://algorithmica.org/en/eytzinger
+// RE: Khuong & Morin, Array Layouts for Comparison-Based Searching (2017)
+
+namespace alg {
+	namespace frozen_bst_detail {
+		const size_t CACHE_LINE = 64;
+
+		/* Number of trailing one bits of <value>
+		*/
+		inline int trailingOnes(uint64_t value) {
+			value = ~value;
+			if (value == 0) return 64;
+#if defined(_MSC_VER) && defined(_M_X64)
+			unsigned long index;
+			_BitScanForward64(&index, value);
+			return (int)index;
+#elif defined(_MSC_VER)
+			unsigned long index;
+			if (_BitScanForward(&index, (unsigned long)value)) return (int)index;
+			_BitScanForward(&index, (unsigned long)(value >> 32));
+			return (int)index + 32;
+#else
+			return __builtin_ctzll(value);
+#endif
+		}
+
+		inline void prefetch(const void* address) {
+#if ALG_X86
+			_mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#elif defined(__GNUC__)
+			__builtin_prefetch(address);
+#else
+			(void)address;
+#endif
+		}
+
+		template <typename T>
+		inline T* allocateAligned(size_t count) {
+			return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(CACHE_LINE)));
+		}
+
+		template <typename T>
+		inline void freeAligned(T* pointer) {
+			::operator delete(pointer, std::align_val_t(CACHE_LINE));
+		}
+
+		// lookups walked down together by findMany
+		const int BATCH = 16;
+
+		/* How far apart (in nodes) a node's descendants in one cache line are; the line
+		* prefetchStride * k holds the descendants of k as many levels down as fit in a line
+		*/
+		template <typename KeyT>
+		constexpr size_t prefetchStride() {
+			return sizeof(KeyT) >= CACHE_LINE ? 1 : CACHE_LINE / sizeof(KeyT);
+		}
+
+		/* The node holding the smallest key of a layout with <size> nodes
+		*/
+		inline size_t first(size_t size) {
+			size_t k = 1;
+			while (2 * k <= size) k = 2 * k;
+			return k;
+		}
+
+		/* The node holding the next larger key after node <k>, 0 after the last one
+		*/
+		inline size_t next(size_t k, size_t size) {
+			if (2 * k + 1 <= size) {
+				// the leftmost node of the right subtree
+				k = 2 * k + 1;
+				while (2 * k <= size) k = 2 * k;
+				return k;
+			}
+			// climb while k is a right child, then once more
+			return k >> (trailingOnes(k) + 1);
+		}
+
+		/* Index of the first of the <size> <keys> not less than <key>, 0 if there is none
+		*/
+		template <typename KeyT>
+		inline size_t lowerBound(const KeyT* keys, size_t size, const KeyT& key) {
+			size_t k = 1;
+			while (k <= size) {
+				prefetch(reinterpret_cast<const char*>(
+					reinterpret_cast<uintptr_t>(keys) + k * prefetchStride<KeyT>() * sizeof(KeyT)));
+				k = 2 * k + (keys[k] < key);
+			}
+			// k went right (appended a 1) after every node smaller than <key>, and left (a 0) at
+			// the last node that was not; drop the trailing ones and that zero to get back to it
+			return k >> (trailingOnes(k) + 1);
+		}
+
+		/* FrozenBST::findMany over the <size> <nodes> and their <nodeValues>
+		*/
+		template <typename KeyT, typename ValueT>
+		size_t findMany(const KeyT* nodes, const ValueT* nodeValues, size_t size,
+			const KeyT keys[], size_t count, ValueT values[], bool found[]) {
+			if (size == 0) {
+				for (size_t i = 0; i < count; i++) found[i] = false;
+				return 0;
+			}
+
+			// every walk takes at most this many steps
+			int levels = 0;
+			while (((size_t)1 << levels) <= size) levels++;
+
+			size_t hits = 0;
+			for (size_t start = 0; start < count; start += BATCH) {
+				int batch = count - start < (size_t)BATCH ? (int)(count - start) : BATCH;
+				size_t k[BATCH];
+				for (int i = 0; i < batch; i++) k[i] = 1;
+
+				for (int level = 0; level < levels; level++) {
+					for (int i = 0; i < batch; i++) {
+						// a walk that already fell off the bottom stays where it is
+						size_t node = k[i] <= size ? k[i] : size;
+						prefetch(reinterpret_cast<const char*>(
+							reinterpret_cast<uintptr_t>(nodes) + node * prefetchStride<KeyT>() * sizeof(KeyT)));
+						size_t child = 2 * node + (nodes[node] < keys[start + i]);
+						k[i] = k[i] <= size ? child : k[i];
+					}
+				}
+
+				for (int i = 0; i < batch; i++) {
+					size_t node = k[i] >> (trailingOnes(k[i]) + 1);
+					bool hit = node != 0 && !(keys[start + i] < nodes[node]);
+					if (hit) values[start + i] = nodeValues[node];
+					found[start + i] = hit;
+					hits += hit;
+				}
+			}
+			return hits;
+		}
+	}
+
+	template <typename KeyT, typename ValueT>
+	class FrozenBST {
+	private:
+		class KeyNotFoundException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "key not found";
+			}
+		} exception_key_not_found;
+
+		KeyT* m_keys; // [1, m_size] in Eytzinger order, slot 0 unused
+		ValueT* m_values;
+		size_t m_size;
+
+		inline size_t first() const {
+			return frozen_bst_detail::first(m_size);
+		}
+
+		inline size_t next(size_t k) const {
+			return frozen_bst_detail::next(k, m_size);
+		}
+
+		/* Destroys the first <count> keys and values in key order and frees the arrays
+		*/
+		void release(size_t count) {
+			for (size_t k = first(); count > 0; k = next(k), count--) {
+				m_keys[k].~KeyT();
+				m_values[k].~ValueT();
+			}
+			frozen_bst_detail::freeAligned(m_keys);
+			frozen_bst_detail::freeAligned(m_values);
+			m_keys = nullptr;
+			m_values = nullptr;
+			m_size = 0;
+		}
+
+		inline size_t lowerBound(const KeyT& key) const {
+			return frozen_bst_detail::lowerBound(m_keys, m_size, key);
+		}
+
+	public:
+		FrozenBST() : m_keys(nullptr), m_values(nullptr), m_size(0) {}
+
+		/* Builds the index from <size> keys in ascending order and their values
+		* Note: with duplicate keys, lookups return the value of the first one
+		*/
+		FrozenBST(const KeyT sortedKeys[], const ValueT sortedValues[], size_t size)
+			: m_keys(nullptr), m_values(nullptr), m_size(0) {
+			if (size == 0) return;
+			// slot 0 is never used, it only puts the children of k at 2k
+			m_keys = frozen_bst_detail::allocateAligned<KeyT>(size + 1);
+			m_values = frozen_bst_detail::allocateAligned<ValueT>(size + 1);
+			m_size = size;
+
+			// visiting the nodes in key order hands them the sorted elements one by one
+			size_t built = 0;
+			try {
+				for (size_t k = first(); built < size; k = next(k), built++) {
+					new (&m_keys[k]) KeyT(sortedKeys[built]);
+					try {
+						new (&m_values[k]) ValueT(sortedValues[built]);
+					}
+					catch (...) {
+						m_keys[k].~KeyT();
+						throw;
+					}
+				}
+			}
+			catch (...) {
+				release(built);
+				throw;
+			}
+		}
+
+		~FrozenBST() {
+			release(m_size);
+		}
+
+		FrozenBST(const FrozenBST&) = delete;
+		FrozenBST& operator=(const FrozenBST&) = delete;
+
+		FrozenBST(FrozenBST&& other) noexcept : m_keys(other.m_keys), m_values(other.m_values), m_size(other.m_size) {
+			other.m_keys = nullptr;
+			other.m_values = nullptr;
+			other.m_size = 0;
+		}
+
+		FrozenBST& operator=(FrozenBST&& other) noexcept {
+			if (this != &other) {
+				release(m_size);
+				std::swap(m_keys, other.m_keys);
+				std::swap(m_values, other.m_values);
+				std::swap(m_size, other.m_size);
+			}
+			return *this;
+		}
+
+		/* Looks up <key>
+		* @return true and sets <value> if the key is in the index
+		*/
+		inline bool find(const KeyT& key, ValueT& value) const {
+			size_t k = lowerBound(key);
+			if (k == 0 || key < m_keys[k]) return false;
+			value = m_values[k];
+			return true;
+		}
+
+		/* Looks up <count> keys at once; for throughput when many keys are known up front
+		* @param values set to the value of each key that is found, untouched otherwise
+		* @param found whether each key is in the index
+		* @return the number of keys found
+		* Note: walks BATCH lookups down the tree level by level together, so their cache
+		* misses overlap instead of each lookup waiting for its own
+		*/
+		size_t findMany(const KeyT keys[], size_t count, ValueT values[], bool found[]) const {
+			return frozen_bst_detail::findMany(m_keys, m_values, m_size, keys, count, values, found);
+		}
+
+		inline bool contains(const KeyT& key) const {
+			size_t k = lowerBound(key);
+			return k != 0 && !(key < m_keys[k]);
+		}
+
+		/* Return the value corresponding to a given key
+		* Note: throws an error if the key is not found
+		*/
+		ValueT getValue(const KeyT& key) const {
+			size_t k = lowerBound(key);
+			if (k == 0 || key < m_keys[k]) throw exception_key_not_found;
+			return m_values[k];
+		}
+
+		/* Calls callback(key, value) for every key in ascending order
+		*/
+		template <typename F>
+		void forEach(F callback) const {
+			for (size_t k = first(), left = m_size; left > 0; k = next(k), left--) {
+				callback(m_keys[k], m_values[k]);
+			}
+		}
+
+		inline size_t getSize() const {
+			return m_size;
+		}
+
+		inline bool isEmpty() const {
+			return m_size == 0;
+		}
+
+		/* The keys in Eytzinger order at [1, getSize()]; slot 0 is unused
+		*/
+		inline const KeyT* getKeys() const {
+			return m_keys;
+		}
+
+		/* The values at the same indices as their keys
+		*/
+		inline const ValueT* getValues() const {
+			return m_values;
+		}
+
+		MemoryUsage memoryUsage() const {
+			MemoryUsage usage;
+			usage.objectBytes = sizeof(*this);
+			usage.allocatedBytes = m_size == 0 ? 0 : (m_size + 1) * (sizeof(KeyT) + sizeof(ValueT));
+			usage.liveBytes = m_size * (sizeof(KeyT) + sizeof(ValueT));
+			usage.payloadBytes = usage.liveBytes;
+			usage.elementCount = m_size;
+			usage.nodeCount = m_size == 0 ? 0 : 2;
+			return usage;
+		}
+	};
+}
@@ -0,0 +1,252 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <utility>
+
+// hot path instrumentation: counters and histograms of what the containers and sorts do inside
+// Compiled in only when ALG_INSTRUMENTATION is defined to 1 before the first alg header is
+// included (define it for the whole project, every translation unit has to agree); otherwise
+// the hooks expand to nothing and the containers compile to exactly what they were.
+// Counters are process wide totals, histograms record one value per operation (e.g. the nodes
+// a single BST lookup visited) in power of two buckets. Both are relaxed atomics so they can
+// be read from another thread at any time; TakeInstrumentationSnapshot copies them out for
+// export, ResetInstrumentation zeroes them.
+// Sorts count into locals and add them once per call, so the atomics stay out of the inner
+// loops.
+// https://prometheus.io/docs/concepts/metric_types/
+
+#ifndef ALG_INSTRUMENTATION
+#define ALG_INSTRUMENTATION 0
+#endif
+
+namespace alg {
+	enum class Counter {
+		SortComparisons,     // Sort, StableSort (comparison path) and BubbleSort
+		SortSwaps,           // elements exchanged by Sort and BubbleSort
+		BSTNodesVisited,     // by lookups, deletes and inserts
+		StackFullRejections, // push on a full fixed capacity Stack
+		StackEmptyRejections,
+		QueueFullRejections, // enqueue on a full Queue
+		QueueEmptyRejections,
+		StackAllocations,    // arrays allocated by a growing Stack
+		QueueAllocations,
+		BSTAllocations,      // nodes requested from the node allocator
+		LinkedListAllocations,
+		Count
+	};
+
+	enum class Histogram {
+		BubbleSortPasses, // passes per BubbleSort call
+		BSTFindVisits,    // nodes visited per lookup (getValue, deleteKey)
+		BSTInsertVisits,  // nodes visited per insert, i.e. the depth the new node lands at
+		Count
+	};
+
+	const int COUNTER_COUNT = (int)Counter::Count;
+	const int HISTOGRAM_COUNT = (int)Histogram::Count;
+	// bucket 0 holds 0, bucket i holds [2^(i - 1), 2^i)
+	const int HISTOGRAM_BUCKETS = 33;
+
+	inline const char* CounterName(Counter counter) {
+		static const char* const names[COUNTER_COUNT] = {
+			"sort_comparisons", "sort_swaps", "bst_nodes_visited",
+			"stack_full_rejections", "stack_empty_rejections",
+			"queue_full_rejections", "queue_empty_rejections",
+			"stack_allocations", "queue_allocations", "bst_allocations", "linked_list_allocations"
+		};
+		return names[(int)counter];
+	}
+
+	inline const char* HistogramName(Histogram histogram) {
+		static const char* const names[HISTOGRAM_COUNT] = {
+			"bubble_sort_passes", "bst_find_visits", "bst_insert_visits"
+		};
+		return names[(int)histogram];
+	}
+
+	struct HistogramSnapshot {
+		unsigned long long count;
+		unsigned long long sum;
+		unsigned long long max;
+		unsigned long long buckets[HISTOGRAM_BUCKETS];
+
+		inline double mean() const {
+			return count == 0 ? 0.0 : (double)sum / count;
+		}
+
+		/* Upper bound of the bucket holding the <fraction> quantile, e.g. 0.99
+		*/
+		unsigned long long percentile(double fraction) const {
+			unsigned long long target = (unsigned long long)(fraction * count);
+			unsigned long long seen = 0;
+			for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+				seen += buckets[i];
+				if (seen > target || seen == count) return i == 0 ? 0 : (1ULL << i) - 1;
+			}
+			return max;
+		}
+	};
+
+	struct InstrumentationSnapshot {
+		unsigned long long counters[COUNTER_COUNT];
+		HistogramSnapshot histograms[HISTOGRAM_COUNT];
+
+		inline unsigned long long get(Counter counter) const {
+			return counters[(int)counter];
+		}
+
+		inline const HistogramSnapshot& get(Histogram histogram) const {
+			return histograms[(int)histogram];
+		}
+
+		/* One "name value" line per counter and per histogram statistic, histogram buckets
+		* cumulative with their upper bound in the label (the Prometheus text format)
+		*/
+		std::string toString() const {
+			std::string str;
+			for (int i = 0; i < COUNTER_COUNT; i++) {
+				str += std::string("alg_") + CounterName((Counter)i) + " " + std::to_string(counters[i]) + "\n";
+			}
+			for (int i = 0; i < HISTOGRAM_COUNT; i++) {
+				const HistogramSnapshot& h = histograms[i];
+				std::string name = std::string("alg_") + HistogramName((Histogram)i);
+				unsigned long long cumulative = 0;
+				for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+					if (h.buckets[b] == 0) continue;
+					cumulative += h.buckets[b];
+					std::string le = b == 0 ? "0" : std::to_string((1ULL << b) - 1);
+					str += name + "_bucket{le=\"" + le + "\"} " + std::to_string(cumulative) + "\n";
+				}
+				str += name + "_bucket{le=\"+Inf\"} " + std::to_string(h.count) + "\n";
+				str += name + "_count " + std::to_string(h.count) + "\n";
+				str += name + "_sum " + std::to_string(h.sum) + "\n";
+				str += name + "_max " + std::to_string(h.max) + "\n";
+			}
+			return str;
+		}
+	};
+
+	namespace instrumentation_detail {
+		struct HistogramCells {
+			std::atomic<unsigned long long> count;
+			std::atomic<unsigned long long> sum;
+			std::atomic<unsigned long long> max;
+			std::atomic<unsigned long long> buckets[HISTOGRAM_BUCKETS];
+		};
+
+		// zero initialized before any dynamic initialization, so usable from static constructors
+		inline std::atomic<unsigned long long> counters[COUNTER_COUNT];
+		inline HistogramCells histograms[HISTOGRAM_COUNT];
+
+		inline int bucketOf(unsigned long long value) {
+			int bucket = 0;
+			while (value != 0 && bucket < HISTOGRAM_BUCKETS - 1) {
+				value >>= 1;
+				bucket++;
+			}
+			return bucket;
+		}
+
+		inline void add(Counter counter, unsigned long long amount) {
+			counters[(int)counter].fetch_add(amount, std::memory_order_relaxed);
+		}
+
+		inline void record(Histogram histogram, unsigned long long value) {
+			HistogramCells& cells = histograms[(int)histogram];
+			cells.buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+			cells.count.fetch_add(1, std::memory_order_relaxed);
+			cells.sum.fetch_add(value, std::memory_order_relaxed);
+			unsigned long long max = cells.max.load(std::memory_order_relaxed);
+			while (value > max && !cells.max.compare_exchange_weak(max, value, std::memory_order_relaxed));
+		}
+
+		/* Comparator wrapper the sorts use while instrumented; counts into the SortCounts of
+		* the sort call, and sort_detail::swapElements counts its swaps through it
+		*/
+		template <typename Compare>
+		struct CountingCompare {
+			Compare comp;
+			unsigned long long* comparisons;
+			unsigned long long* swaps;
+
+			template <typename A, typename B>
+			inline bool operator()(A&& a, B&& b) {
+				++*comparisons;
+				return comp(std::forward<A>(a), std::forward<B>(b));
+			}
+		};
+
+		/* Counts comparisons and swaps of one sort call and adds them to the totals on exit
+		*/
+		class SortCounts {
+		private:
+			unsigned long long m_comparisons;
+			unsigned long long m_swaps;
+		public:
+			SortCounts() : m_comparisons(0), m_swaps(0) {}
+
+			~SortCounts() {
+				if (m_comparisons != 0) add(Counter::SortComparisons, m_comparisons);
+				if (m_swaps != 0) add(Counter::SortSwaps, m_swaps);
+			}
+
+			SortCounts(const SortCounts&) = delete;
+			SortCounts& operator=(const SortCounts&) = delete;
+
+			template <typename Compare>
+			inline CountingCompare<Compare> wrap(Compare comp) {
+				return CountingCompare<Compare>{ comp, &m_comparisons, &m_swaps };
+			}
+		};
+	}
+
+	/* Whether the hooks are compiled in
+	*/
+	constexpr bool INSTRUMENTATION_ENABLED = ALG_INSTRUMENTATION != 0;
+
+	/* Copies out every counter and histogram
+	* Note: each value is read atomically, but not all of them at the same instant
+	*/
+	inline InstrumentationSnapshot TakeInstrumentationSnapshot() {
+		InstrumentationSnapshot snapshot;
+		for (int i = 0; i < COUNTER_COUNT; i++) {
+			snapshot.counters[i] = instrumentation_detail::counters[i].load(std::memory_order_relaxed);
+		}
+		for (int i = 0; i < HISTOGRAM_COUNT; i++) {
+			instrumentation_detail::HistogramCells& cells = instrumentation_detail::histograms[i];
+			HistogramSnapshot& h = snapshot.histograms[i];
+			h.count = cells.count.load(std::memory_order_relaxed);
+			h.sum = cells.sum.load(std::memory_order_relaxed);
+			h.max = cells.max.load(std::memory_order_relaxed);
+			for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+				h.buckets[b] = cells.buckets[b].load(std::memory_order_relaxed);
+			}
+		}
+		return snapshot;
+	}
+
+	inline void ResetInstrumentation() {
+		for (int i = 0; i < COUNTER_COUNT; i++) {
+			instrumentation_detail::counters[i].store(0, std::memory_order_relaxed);
+		}
+		for (int i = 0; i < HISTOGRAM_COUNT; i++) {
+			instrumentation_detail::HistogramCells& cells = instrumentation_detail::histograms[i];
+			cells.count.store(0, std::memory_order_relaxed);
+			cells.sum.store(0, std::memory_order_relaxed);
+			cells.max.store(0, std::memory_order_relaxed);
+			for (int b = 0; b < HISTOGRAM_BUCKETS; b++) cells.buckets[b].store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+// hooks used by the containers; <value> is not evaluated when instrumentation is off, so it
+// can name a local that only exists to be recorded
+#if ALG_INSTRUMENTATION
+#define ALG_COUNT(counter) ::alg::instrumentation_detail::add(::alg::Counter::counter, 1)
+#define ALG_COUNT_N(counter, amount) ::alg::instrumentation_detail::add(::alg::Counter::counter, (amount))
+#define ALG_RECORD(histogram, value) ::alg::instrumentation_detail::record(::alg::Histogram::histogram, (value))
+#else
+#define ALG_COUNT(counter) ((void)0)
+#define ALG_COUNT_N(counter, amount) ((void)sizeof(amount))
+#define ALG_RECORD(histogram, value) ((void)sizeof(value))
+#endif
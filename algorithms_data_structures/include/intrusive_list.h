@@ -0,0 +1,277 @@
+#pragma once
+#include <cstddef>
+#include <exception>
+#include <iterator>
+
+// intrusive doubly linked list
+// the links live inside the elements: a type that wants to be on a list derives from
+// IntrusiveListHook, and the list only ever points at the caller's objects. Linking and unlinking
+// never allocate, an element can unlink itself in O(1) without searching for it, and whole lists
+// are spliced in O(1). The list does not own its elements: it never creates, copies or destroys
+// them, and the caller has to keep them alive while they are linked.
+// An object can be on several lists at once by deriving from one hook per list, told apart by
+// the <Tag> type:
+//   struct Entry : alg::IntrusiveListHook<LruTag>, alg::IntrusiveListHook<TimerTag> { ... };
+//   alg::IntrusiveList<Entry, LruTag> lru;
+// https://www.boost.org/doc/libs/release/doc/html/intrusive/intrusive_vs_nontrusive.html
+
+namespace alg {
+	template <typename T, typename Tag>
+	class IntrusiveList;
+
+	/* Base class holding the links of one list
+	* Note: copying an element does not copy its links; the copy starts out unlinked
+	*/
+	template <typename Tag = void>
+	class IntrusiveListHook {
+	private:
+		template <typename, typename>
+		friend class IntrusiveList;
+
+		IntrusiveListHook* m_next;
+		IntrusiveListHook* m_previous;
+
+	public:
+		IntrusiveListHook() : m_next(nullptr), m_previous(nullptr) {}
+
+		IntrusiveListHook(const IntrusiveListHook&) : IntrusiveListHook() {}
+
+		IntrusiveListHook& operator=(const IntrusiveListHook&) {
+			return *this;
+		}
+
+		/* @return true if the element is on a list
+		*/
+		inline bool isLinked() const {
+			return m_next != nullptr;
+		}
+	};
+
+	template <typename T, typename Tag = void>
+	class IntrusiveList {
+	private:
+		class StackEmptyException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "popping from an empty linked list";
+			}
+		} exception_empty;
+
+		typedef IntrusiveListHook<Tag> Hook;
+
+		// circular: the sentinel comes before the first and after the last element, so linking
+		// and unlinking never have to check for the ends
+		Hook m_root;
+		size_t m_size;
+
+		static inline Hook* hook(T& element) {
+			return static_cast<Hook*>(&element);
+		}
+
+		static inline T& element(Hook* hook) {
+			return static_cast<T&>(*hook);
+		}
+
+		static inline void link(Hook* node, Hook* next) {
+			node->m_next = next;
+			node->m_previous = next->m_previous;
+			next->m_previous->m_next = node;
+			next->m_previous = node;
+		}
+
+		static inline void unlink(Hook* node) {
+			node->m_previous->m_next = node->m_next;
+			node->m_next->m_previous = node->m_previous;
+			node->m_next = nullptr;
+			node->m_previous = nullptr;
+		}
+
+	public:
+		/* Bidirectional iterator over the elements
+		*/
+		class iterator {
+		private:
+			friend class IntrusiveList;
+			Hook* m_node;
+
+			explicit iterator(Hook* node) : m_node(node) {}
+
+		public:
+			typedef std::bidirectional_iterator_tag iterator_category;
+			typedef T value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef T* pointer;
+			typedef T& reference;
+
+			iterator() : m_node(nullptr) {}
+
+			inline T& operator*() const {
+				return element(m_node);
+			}
+
+			inline T* operator->() const {
+				return &element(m_node);
+			}
+
+			iterator& operator++() {
+				m_node = m_node->m_next;
+				return *this;
+			}
+
+			iterator& operator--() {
+				m_node = m_node->m_previous;
+				return *this;
+			}
+
+			inline bool operator==(const iterator& other) const {
+				return m_node == other.m_node;
+			}
+
+			inline bool operator!=(const iterator& other) const {
+				return m_node != other.m_node;
+			}
+		};
+
+		IntrusiveList() : m_size(0) {
+			m_root.m_next = &m_root;
+			m_root.m_previous = &m_root;
+		}
+
+		/* Note: the elements are unlinked, not destroyed
+		*/
+		~IntrusiveList() {
+			clear();
+		}
+
+		// the sentinel is pointed to by the elements, so the list can not be copied or moved
+		IntrusiveList(const IntrusiveList&) = delete;
+		IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+		/* Unlinks every element; O(n) since every hook is reset
+		*/
+		void clear() {
+			Hook* node = m_root.m_next;
+			while (node != &m_root) {
+				Hook* next = node->m_next;
+				node->m_next = nullptr;
+				node->m_previous = nullptr;
+				node = next;
+			}
+			m_root.m_next = &m_root;
+			m_root.m_previous = &m_root;
+			m_size = 0;
+		}
+
+		/* Links <element> at the front of the list
+		* Note: <element> must not be on a list with the same Tag already
+		*/
+		inline void push(T& element) {
+			link(hook(element), m_root.m_next);
+			m_size++;
+		}
+
+		/* Links <element> at the back of the list
+		* Note: <element> must not be on a list with the same Tag already
+		*/
+		inline void pushLast(T& element) {
+			link(hook(element), &m_root);
+			m_size++;
+		}
+
+		/* Links <element> right before <position>, which has to be on this list
+		*/
+		inline void insertBefore(T& position, T& element) {
+			link(hook(element), hook(position));
+			m_size++;
+		}
+
+		/* Unlinks the first element
+		* @return the element that was at the front
+		*/
+		T& pop() {
+			if (m_size == 0) throw exception_empty;
+			Hook* node = m_root.m_next;
+			unlink(node);
+			m_size--;
+			return element(node);
+		}
+
+		/* Unlinks the last element
+		* @return the element that was at the back
+		*/
+		T& popLast() {
+			if (m_size == 0) throw exception_empty;
+			Hook* node = m_root.m_previous;
+			unlink(node);
+			m_size--;
+			return element(node);
+		}
+
+		/* Unlinks <element>, which has to be on this list; O(1)
+		*/
+		inline void remove(T& element) {
+			unlink(hook(element));
+			m_size--;
+		}
+
+		/* Moves <element>, which has to be on this list, to the front (e.g. on a cache hit)
+		*/
+		inline void moveToFront(T& element) {
+			Hook* node = hook(element);
+			unlink(node);
+			link(node, m_root.m_next);
+		}
+
+		/* Moves <element>, which has to be on this list, to the back
+		*/
+		inline void moveToBack(T& element) {
+			Hook* node = hook(element);
+			unlink(node);
+			link(node, &m_root);
+		}
+
+		/* Moves every element of <other> to the back of this list in O(1), leaving <other> empty
+		*/
+		void splice(IntrusiveList& other) {
+			if (&other == this || other.m_size == 0) return;
+
+			Hook* first = other.m_root.m_next;
+			Hook* last = other.m_root.m_previous;
+			first->m_previous = m_root.m_previous;
+			m_root.m_previous->m_next = first;
+			last->m_next = &m_root;
+			m_root.m_previous = last;
+			m_size += other.m_size;
+
+			other.m_root.m_next = &other.m_root;
+			other.m_root.m_previous = &other.m_root;
+			other.m_size = 0;
+		}
+
+		inline T& peek() {
+			if (m_size == 0) throw exception_empty;
+			return element(m_root.m_next);
+		}
+
+		inline T& peekLast() {
+			if (m_size == 0) throw exception_empty;
+			return element(m_root.m_previous);
+		}
+
+		inline bool isEmpty() const {
+			return m_size == 0;
+		}
+
+		inline size_t getSize() const {
+			return m_size;
+		}
+
+		iterator begin() {
+			return iterator(m_root.m_next);
+		}
+
+		iterator end() {
+			return iterator(&m_root);
+		}
+	};
+}
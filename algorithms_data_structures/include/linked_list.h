@@ -1,9 +1,20 @@
 #pragma once
+#include "instrumentation.h"
+#include "memory_usage.h"
+#include "node_pool.h"
+#include <memory>
+#include <new>
 #include <string>
+#include <type_traits>
 
 // doubly linked list implementation
+// nodes come from <Allocator> rebound to the node type; the default NodePool hands them out
+// of slabs, pass std::allocator<T> to use the global heap instead
+// the list keeps a pointer to its last node, so both ends are O(1)
+// see intrusive_list.h for a list that links the caller's objects without allocating, and
+// unrolled_list.h for one that stores many elements per node
 namespace alg {
-	template <typename T>
+	template <typename T, typename Allocator = NodePool<T>>
 	class LinkedList {
 	private:
 		class IndexOutOfBoundsException : public std::exception {
@@ -26,45 +37,99 @@ namespace alg {
 			Node* previous;
 		};
 
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Node> NodeAllocator;
+
 		Node* m_head;
+		Node* m_tail;
 		unsigned int m_size;
+		NodeAllocator m_allocator;
 
-		void destruct(Node* node) {
-			if (node == nullptr) return;
+		Node* createNode(const T& data, Node* next, Node* previous) {
+			ALG_COUNT(LinkedListAllocations);
+			Node* node = m_allocator.allocate(1);
+			try {
+				new (node) Node{ data, next, previous };
+			}
+			catch (...) {
+				m_allocator.deallocate(node, 1);
+				throw;
+			}
+			return node;
+		}
 
-			destruct(node->next);
-			delete node;
+		void destroyNode(Node* node) {
+			node->~Node();
+			m_allocator.deallocate(node, 1);
 		}
 
-		/* Return the node at the end of the list
-		*/
-		Node* getLast() {
-			Node* current = m_head;
-			Node* previous = nullptr;
-			while (current != nullptr) {
-				previous = current;
-				current = current->next;
+		void destruct(Node* node, std::false_type) {
+			while (node != nullptr) {
+				Node* next = node->next;
+				destroyNode(node);
+				node = next;
 			}
-			return previous;
+		}
+
+		// nothing to destroy, so drop the whole pool at once
+		void destruct(Node*, std::true_type) {
+			m_allocator.release();
+		}
+
+		/* Makes <mine> responsible for freeing the nodes allocated by <other>
+		*/
+		template <typename U>
+		static void adoptNodes(NodePool<U>& mine, NodePool<U>& other) {
+			mine.adopt(other);
+		}
+
+		template <typename A>
+		static void adoptNodes(A&, A&) {
+			static_assert(std::allocator_traits<A>::is_always_equal::value,
+				"splice needs an allocator that can free the nodes of the other list");
 		}
 
 	public:
 		LinkedList() {
 			m_head = nullptr;
+			m_tail = nullptr;
 			m_size = 0;
 		}
 
+		/* Allocates the nodes through a copy of <allocator>, e.g. a TrackingAllocator with its
+		* own MemoryStats
+		*/
+		explicit LinkedList(const Allocator& allocator) : m_head(nullptr), m_tail(nullptr), m_size(0),
+			m_allocator(allocator) {}
+
 		~LinkedList() {
-			destruct(m_head);
+			clear();
+		}
+
+		LinkedList(const LinkedList&) = delete;
+		LinkedList& operator=(const LinkedList&) = delete;
+
+		/* Removes every element
+		* Note: O(slabs) rather than O(n) with a NodePool and a trivially destructible T
+		*/
+		void clear() {
+			typedef std::integral_constant<bool, node_pool_detail::ReleasesInBulk<NodeAllocator>::value &&
+				std::is_trivially_destructible<Node>::value> ReleaseAll;
+			destruct(m_head, ReleaseAll());
+			m_head = nullptr;
+			m_tail = nullptr;
+			m_size = 0;
 		}
 
 		/* Pushes an element to the front of the linked list
 		*/
 		void push(T data) {
-			Node* newNode = new Node;
-			newNode->data = data;
-			newNode->next = m_head;
-			newNode->previous = nullptr;
+			Node* newNode = createNode(data, m_head, nullptr);
+			if (m_head == nullptr) {
+				m_tail = newNode;
+			}
+			else {
+				m_head->previous = newNode;
+			}
 			m_head = newNode;
 			m_size++;
 		}
@@ -79,16 +144,15 @@ namespace alg {
 
 			T tempData = m_head->data;
 
-			if (m_head->next == nullptr) {
+			Node* newHead = m_head->next;
+			if (newHead == nullptr) {
 				// linked list has only one node
-				delete m_head;
-				m_head = nullptr;
-				return tempData;
+				m_tail = nullptr;
 			}
-
-			Node* newHead = m_head->next;
-			newHead->previous = nullptr;
-			delete m_head;
+			else {
+				newHead->previous = nullptr;
+			}
+			destroyNode(m_head);
 			m_head = newHead;
 			m_size--;
 			return tempData;
@@ -97,50 +161,103 @@ namespace alg {
 		/* Pushes an element to the back of the linked list
 		*/
 		void pushLast(T data) {
-			Node* newNode = new Node;
-			newNode->data = data;
-			newNode->next = nullptr;
+			Node* newNode = createNode(data, nullptr, m_tail);
 
-			if (m_head == nullptr) {
-				newNode->previous = nullptr;
+			if (m_tail == nullptr) {
 				m_head = newNode;
 			}
 			else {
-				newNode->previous = getLast();
-				newNode->previous->next = newNode;
+				m_tail->next = newNode;
 			}
+			m_tail = newNode;
+			m_size++;
 		}
 
 		/* Removes the last element in the linked list
 		* Make sure that the linked list is not empty before calling pop.
 		* (Check with isEmpty())
-		* @return the first element in the linked list
+		* @return the last element in the linked list
 		*/
 		T popLast() {
-			if (m_head == nullptr) throw exception_empty;
+			if (m_tail == nullptr) throw exception_empty;
 
-			Node* last = getLast();
-			T tempData = last->data;
+			T tempData = m_tail->data;
 
-			if (last == m_head) {
+			Node* newTail = m_tail->previous;
+			if (newTail == nullptr) {
 				m_head = nullptr;
-				return tempData;
 			}
-
-			last->previous->next = nullptr;
-			delete last;
+			else {
+				newTail->next = nullptr;
+			}
+			destroyNode(m_tail);
+			m_tail = newTail;
+			m_size--;
 			return tempData;
 		}
+
+		/* Moves every element of <other> to the back of this list, leaving <other> empty
+		* Note: O(1); with a NodePool this pool takes over the slabs of the other list's pool
+		*/
+		void splice(LinkedList& other) {
+			if (&other == this || other.m_head == nullptr) return;
+
+			adoptNodes(m_allocator, other.m_allocator);
+			if (m_tail == nullptr) {
+				m_head = other.m_head;
+			}
+			else {
+				m_tail->next = other.m_head;
+				other.m_head->previous = m_tail;
+			}
+			m_tail = other.m_tail;
+			m_size += other.m_size;
+
+			other.m_head = nullptr;
+			other.m_tail = nullptr;
+			other.m_size = 0;
+		}
 		
 		inline T peek() {
 			if (m_size == 0) throw exception_empty;
 			return m_head->data;
 		}
 
+		inline T peekLast() {
+			if (m_size == 0) throw exception_empty;
+			return m_tail->data;
+		}
+
 		bool isEmpty() {
 			return m_head == nullptr;
 		}
 
+		inline unsigned int getSize() const {
+			return m_size;
+		}
+
+		/* Calls callback(element) for every element from the head to the tail
+		*/
+		template <typename F>
+		void forEach(F callback) const {
+			for (const Node* node = m_head; node != nullptr; node = node->next) {
+				callback(node->data);
+			}
+		}
+
+		/* Bytes held by the list; with a NodePool the allocated bytes are whole slabs
+		*/
+		MemoryUsage memoryUsage() const {
+			MemoryUsage usage;
+			usage.objectBytes = sizeof(*this);
+			usage.allocatedBytes = node_pool_detail::heldBytes(m_allocator, m_size, sizeof(Node));
+			usage.liveBytes = (size_t)m_size * sizeof(Node);
+			usage.payloadBytes = (size_t)m_size * sizeof(T);
+			usage.elementCount = m_size;
+			usage.nodeCount = m_size;
+			return usage;
+		}
+
 		std::string toString() {
 			std::string str;
 			if (m_head == nullptr) {
@@ -0,0 +1,172 @@
+#pragma once
+#include "instrumentation.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// memory footprint accounting
+// Every container reports what it holds through memoryUsage(): the bytes of the object itself,
+// the heap bytes it has allocated (for pooled nodes the whole slabs, partly empty or not), how
+// many of those hold live elements, and the bytes of the elements themselves, from which the
+// overhead per element follows.
+// MemoryStats tracks allocations as they happen, including the peak. TrackingAllocator records
+// every allocation of a node based container into one; with ALG_INSTRUMENTATION on, the heap
+// arrays of Stack and Queue and the slabs of NodePool are recorded in GlobalMemoryStats() as well.
+
+namespace alg {
+	struct MemoryUsage {
+		size_t objectBytes;    // sizeof the container (inline storage included)
+		size_t allocatedBytes; // heap bytes held, used or not
+		size_t liveBytes;      // of those, bytes taken by elements and their nodes
+		size_t payloadBytes;   // bytes of the elements alone (keys and values)
+		size_t elementCount;
+		size_t nodeCount;      // heap blocks the elements live in: nodes, or 1 for an array
+
+		inline size_t totalBytes() const {
+			return objectBytes + allocatedBytes;
+		}
+
+		inline double bytesPerElement() const {
+			return elementCount == 0 ? 0.0 : (double)totalBytes() / elementCount;
+		}
+
+		/* Bytes per element that are not the element itself: links, padding, unused capacity
+		*/
+		inline double overheadPerElement() const {
+			return elementCount == 0 ? 0.0 : (double)(totalBytes() - payloadBytes) / elementCount;
+		}
+
+		std::string toString() const {
+			return std::to_string(elementCount) + " elements in " + std::to_string(nodeCount) + " blocks, "
+				+ std::to_string(totalBytes()) + " bytes (" + std::to_string(allocatedBytes) + " allocated, "
+				+ std::to_string(liveBytes) + " live), " + std::to_string(bytesPerElement()) + " bytes/element, "
+				+ std::to_string(overheadPerElement()) + " overhead/element";
+		}
+	};
+
+	/* Running totals of allocations: bytes currently allocated, the peak, and the call counts
+	* Note: thread safe; relaxed atomics
+	*/
+	class MemoryStats {
+	private:
+		std::atomic<size_t> m_currentBytes;
+		std::atomic<size_t> m_peakBytes;
+		std::atomic<size_t> m_allocations;
+		std::atomic<size_t> m_deallocations;
+
+	public:
+		MemoryStats() : m_currentBytes(0), m_peakBytes(0), m_allocations(0), m_deallocations(0) {}
+
+		MemoryStats(const MemoryStats&) = delete;
+		MemoryStats& operator=(const MemoryStats&) = delete;
+
+		void recordAllocation(size_t bytes) {
+			size_t current = m_currentBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+			size_t peak = m_peakBytes.load(std::memory_order_relaxed);
+			while (current > peak && !m_peakBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed));
+			m_allocations.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void recordDeallocation(size_t bytes) {
+			m_currentBytes.fetch_sub(bytes, std::memory_order_relaxed);
+			m_deallocations.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		/* Start measuring a new peak from the current usage
+		*/
+		void resetPeak() {
+			m_peakBytes.store(m_currentBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+		inline size_t getCurrentBytes() const {
+			return m_currentBytes.load(std::memory_order_relaxed);
+		}
+
+		inline size_t getPeakBytes() const {
+			return m_peakBytes.load(std::memory_order_relaxed);
+		}
+
+		inline size_t getAllocationCount() const {
+			return m_allocations.load(std::memory_order_relaxed);
+		}
+
+		inline size_t getDeallocationCount() const {
+			return m_deallocations.load(std::memory_order_relaxed);
+		}
+	};
+
+	/* Stats every container reports its heap arrays and slabs to when instrumented, and the
+	* default of TrackingAllocator
+	*/
+	inline MemoryStats& GlobalMemoryStats() {
+		static MemoryStats stats;
+		return stats;
+	}
+
+	/* Allocator that records every allocation of <Base> in a MemoryStats
+	* e.g. BST<int, int, TrackingAllocator<int>> puts each node on the heap and tracks it
+	* Note: copies and rebinds share the stats; Base has to be copyable (so not a NodePool,
+	* whose slabs are tracked through GlobalMemoryStats instead)
+	*/
+	template <typename T, typename Base = std::allocator<T>>
+	class TrackingAllocator {
+	private:
+		template <typename U, typename B>
+		friend class TrackingAllocator;
+
+		typedef std::allocator_traits<Base> BaseTraits;
+
+		Base m_base;
+		MemoryStats* m_stats;
+
+	public:
+		typedef T value_type;
+
+		template <typename U>
+		struct rebind {
+			typedef TrackingAllocator<U, typename BaseTraits::template rebind_alloc<U>> other;
+		};
+
+		TrackingAllocator() : m_stats(&GlobalMemoryStats()) {}
+
+		explicit TrackingAllocator(MemoryStats& stats, const Base& base = Base()) : m_base(base), m_stats(&stats) {}
+
+		template <typename U, typename B>
+		TrackingAllocator(const TrackingAllocator<U, B>& other) : m_base(other.m_base), m_stats(other.m_stats) {}
+
+		T* allocate(size_t n) {
+			T* pointer = BaseTraits::allocate(m_base, n);
+			m_stats->recordAllocation(n * sizeof(T));
+			return pointer;
+		}
+
+		void deallocate(T* pointer, size_t n) {
+			m_stats->recordDeallocation(n * sizeof(T));
+			BaseTraits::deallocate(m_base, pointer, n);
+		}
+
+		inline MemoryStats& getStats() const {
+			return *m_stats;
+		}
+
+		template <typename U, typename B>
+		inline bool operator==(const TrackingAllocator<U, B>& other) const {
+			return m_stats == other.m_stats && m_base == other.m_base;
+		}
+
+		template <typename U, typename B>
+		inline bool operator!=(const TrackingAllocator<U, B>& other) const {
+			return !(*this == other);
+		}
+	};
+}
+
+// hooks for the containers that allocate without an allocator
+#if ALG_INSTRUMENTATION
+#define ALG_TRACK_ALLOCATION(bytes) ::alg::GlobalMemoryStats().recordAllocation(bytes)
+#define ALG_TRACK_DEALLOCATION(bytes) ::alg::GlobalMemoryStats().recordDeallocation(bytes)
+#else
+#define ALG_TRACK_ALLOCATION(bytes) ((void)sizeof(bytes))
+#define ALG_TRACK_DEALLOCATION(bytes) ((void)sizeof(bytes))
+#endif
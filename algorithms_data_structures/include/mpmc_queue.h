@@ -0,0 +1,273 @@
+#pragma once
+#include "cpu_features.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// bounded multi producer, multi consumer circular queue without a global lock
+// every slot carries a sequence number that says whose turn it is: a producer may fill the slot
+// for position pos when sequence == pos, a consumer may empty it when sequence == pos + 1.
+// Producers and consumers only contend on their own position counter (one CAS per operation)
+// and hand slots to each other through the sequence numbers.
+// RE: Dmitry Vyukov, Bounded MPMC queue
+// https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+
+namespace alg {
+	namespace mpmc_detail {
+		// pause-spin this many times before yielding the thread
+		const int SPIN_LIMIT = 64;
+		// blocking calls try this many times before they go to sleep
+		const int BLOCK_AFTER = 256;
+
+		/* Exponential backoff: a growing number of pause instructions, then yields
+		*/
+		class Backoff {
+		private:
+			int m_spins;
+
+		public:
+			Backoff() : m_spins(1) {}
+
+			void wait() {
+				if (m_spins <= SPIN_LIMIT) {
+					for (int i = 0; i < m_spins; i++) CpuRelax();
+					m_spins *= 2;
+				}
+				else {
+					std::this_thread::yield();
+				}
+			}
+		};
+	}
+
+	template<typename T>
+	class MPMCQueue {
+	private:
+		enum { CACHE_LINE = 64 };
+
+		struct Slot {
+			std::atomic<size_t> sequence;
+			alignas(T) unsigned char storage[sizeof(T)];
+
+			inline T* element() {
+				return reinterpret_cast<T*>(storage);
+			}
+		};
+
+		static_assert(std::is_nothrow_move_constructible<T>::value,
+			"MPMCQueue moves elements into claimed slots, which can not be given back if that throws");
+
+		Slot* m_slots;
+		size_t m_mask; // capacity - 1, the capacity being a power of two
+
+		alignas(CACHE_LINE) std::atomic<size_t> m_enqueuePosition;
+		alignas(CACHE_LINE) std::atomic<size_t> m_dequeuePosition;
+
+		// only used by the blocking calls once the queue has been full (or empty) for a while
+		alignas(CACHE_LINE) std::atomic<int> m_sleepingProducers;
+		std::atomic<int> m_sleepingConsumers;
+		std::mutex m_sleepMutex;
+		std::condition_variable m_notFull;
+		std::condition_variable m_notEmpty;
+
+		/* Wake a thread sleeping in a blocking call, if there is one
+		*/
+		inline void wake(std::atomic<int>& sleeping, std::condition_variable& condition) {
+			// pairs with the increment in sleepUntil: either the sleeper sees this operation or
+			// this load sees the sleeper
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (sleeping.load(std::memory_order_relaxed) > 0) {
+				std::lock_guard<std::mutex> lock(m_sleepMutex);
+				condition.notify_all();
+			}
+		}
+
+		/* Retry <attempt> until it succeeds, first with backoff and then sleeping on <condition>
+		* Note: <attempt> runs under the sleep mutex, so it must not call wake
+		*/
+		template <typename F>
+		void sleepUntil(F attempt, std::atomic<int>& sleeping, std::condition_variable& condition) {
+			mpmc_detail::Backoff backoff;
+			for (int i = 0; i < mpmc_detail::BLOCK_AFTER; i++) {
+				if (attempt()) return;
+				backoff.wait();
+			}
+
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			sleeping.fetch_add(1);
+			while (!attempt()) condition.wait(lock);
+			sleeping.fetch_sub(1);
+		}
+
+		/* Moves <value> into the queue if there is room; <value> is left alone otherwise
+		* @param notify wake up a sleeping consumer; the blocking calls do that themselves
+		* once they released the sleep mutex
+		*/
+		bool tryPush(T& value, bool notify) {
+			size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+			Slot* slot;
+			while (true) {
+				slot = &m_slots[position & m_mask];
+				size_t sequence = slot->sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t difference = (std::ptrdiff_t)sequence - (std::ptrdiff_t)position;
+
+				if (difference == 0) {
+					// the slot is free: claim the position
+					if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+				}
+				else if (difference < 0) {
+					// the slot still holds the element from one lap ago
+					return false;
+				}
+				else {
+					// another producer got this position first
+					position = m_enqueuePosition.load(std::memory_order_relaxed);
+				}
+			}
+
+			new (slot->element()) T(std::move(value));
+			slot->sequence.store(position + 1, std::memory_order_release);
+			if (notify) wake(m_sleepingConsumers, m_notEmpty);
+			return true;
+		}
+
+		/* Moves the element at the front of the queue into <value> if there is one
+		* @param notify wake up a sleeping producer
+		*/
+		bool tryPop(T& value, bool notify) {
+			size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+			Slot* slot;
+			while (true) {
+				slot = &m_slots[position & m_mask];
+				size_t sequence = slot->sequence.load(std::memory_order_acquire);
+				std::ptrdiff_t difference = (std::ptrdiff_t)sequence - (std::ptrdiff_t)(position + 1);
+
+				if (difference == 0) {
+					if (m_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+				}
+				else if (difference < 0) {
+					// nothing has been enqueued at this position yet
+					return false;
+				}
+				else {
+					position = m_dequeuePosition.load(std::memory_order_relaxed);
+				}
+			}
+
+			value = std::move(*slot->element());
+			slot->element()->~T();
+			// free the slot for the producer one lap ahead
+			slot->sequence.store(position + m_mask + 1, std::memory_order_release);
+			if (notify) wake(m_sleepingProducers, m_notFull);
+			return true;
+		}
+
+	public:
+		/* Note: the capacity is rounded up to a power of two (at least 2)
+		*/
+		MPMCQueue(int capacity) : m_enqueuePosition(0), m_dequeuePosition(0), m_sleepingProducers(0),
+			m_sleepingConsumers(0) {
+			size_t size = 2;
+			while (size < (size_t)capacity) size *= 2;
+			m_mask = size - 1;
+
+			m_slots = static_cast<Slot*>(::operator new(sizeof(Slot) * size));
+			for (size_t i = 0; i < size; i++) {
+				new (&m_slots[i].sequence) std::atomic<size_t>(i);
+			}
+		}
+
+		/* Note: no thread may use the queue while it is destroyed
+		*/
+		~MPMCQueue() {
+			size_t tail = m_enqueuePosition.load();
+			for (size_t i = m_dequeuePosition.load(); i != tail; i++) {
+				m_slots[i & m_mask].element()->~T();
+			}
+			::operator delete(m_slots);
+		}
+
+		MPMCQueue(const MPMCQueue&) = delete;
+		MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+		/* Enqueue an element to the end of the queue
+		@return true if queue is not full, false if the queue is full
+		*/
+		inline bool try_enqueue(const T& value) {
+			T copy(value);
+			return tryPush(copy, true);
+		}
+
+		/* Note: <value> is only moved from if it was enqueued
+		*/
+		inline bool try_enqueue(T&& value) {
+			return tryPush(value, true);
+		}
+
+		template <typename... Args>
+		inline bool try_emplace(Args&&... args) {
+			T value(std::forward<Args>(args)...);
+			return tryPush(value, true);
+		}
+
+		/* Move the element at the front of the queue into <value>
+		@return false if the queue is empty
+		*/
+		inline bool try_dequeue(T& value) {
+			return tryPop(value, true);
+		}
+
+		/* Enqueue, busy waiting with backoff while the queue is full
+		*/
+		void spin_enqueue(T value) {
+			mpmc_detail::Backoff backoff;
+			while (!tryPush(value, true)) backoff.wait();
+		}
+
+		/* Dequeue, busy waiting with backoff while the queue is empty
+		*/
+		void spin_dequeue(T& value) {
+			mpmc_detail::Backoff backoff;
+			while (!try_dequeue(value)) backoff.wait();
+		}
+
+		/* Enqueue, sleeping while the queue stays full
+		*/
+		void enqueue(T value) {
+			sleepUntil([&]() { return tryPush(value, false); }, m_sleepingProducers, m_notFull);
+			wake(m_sleepingConsumers, m_notEmpty);
+		}
+
+		/* Remove the element at the front of the queue and return it, sleeping while the
+		* queue stays empty
+		* Note: T has to be default constructible
+		*/
+		T dequeue() {
+			T value;
+			sleepUntil([&]() { return tryPop(value, false); }, m_sleepingConsumers, m_notEmpty);
+			wake(m_sleepingProducers, m_notFull);
+			return value;
+		}
+
+		/* Note: only a snapshot while other threads are running
+		*/
+		inline int getSize() const {
+			size_t head = m_dequeuePosition.load(std::memory_order_acquire);
+			size_t tail = m_enqueuePosition.load(std::memory_order_acquire);
+			return tail > head ? (int)(tail - head) : 0;
+		}
+
+		inline bool is_empty() const {
+			return getSize() == 0;
+		}
+
+		inline int getCapacity() const {
+			return (int)(m_mask + 1);
+		}
+	};
+}
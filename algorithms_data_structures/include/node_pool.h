@@ -0,0 +1,249 @@
+#pragma once
+#include "memory_usage.h"
+#include <cstddef>
+#include <new>
+
+// slab allocator for fixed size nodes (the default allocator of the node based containers)
+// nodes are carved out of large slabs and freed nodes go on an intrusive free list, so
+// steady state insert/erase churn never reaches the global allocator. All slabs of a pool can
+// be dropped at once with release(), which makes clearing a container O(slabs) instead of
+// O(nodes). Released slabs are kept in a small per thread cache and reused by the next pool
+// that grows on the same thread.
+// https://en.wikipedia.org/wiki/Slab_allocation
+
+namespace alg {
+	namespace node_pool_detail {
+		// every slab has the same size so that pools of any node type can share the cache
+		const size_t SLAB_BYTES = 64 * 1024;
+		// slabs beyond this are handed back to the global allocator (4MB per thread)
+		const size_t MAX_CACHED_SLABS = 64;
+
+		struct SlabHeader {
+			SlabHeader* next;
+		};
+
+		// trivially destructible, so it stays usable while other thread_local and static
+		// objects (that may own pools) are destroyed
+		struct SlabCache {
+			SlabHeader* head;
+			size_t count;
+			bool closed;
+		};
+
+		inline SlabCache& threadSlabCache() {
+			thread_local SlabCache cache = { nullptr, 0, false };
+			return cache;
+		}
+
+		/* Frees the cached slabs when the thread exits; slabs released after that are freed
+		* immediately
+		*/
+		struct SlabCacheCleanup {
+			~SlabCacheCleanup() {
+				SlabCache& cache = threadSlabCache();
+				while (cache.head != nullptr) {
+					SlabHeader* next = cache.head->next;
+					ALG_TRACK_DEALLOCATION(SLAB_BYTES);
+					::operator delete(cache.head);
+					cache.head = next;
+				}
+				cache.count = 0;
+				cache.closed = true;
+			}
+		};
+
+		inline SlabHeader* acquireSlab() {
+			SlabCache& cache = threadSlabCache();
+			if (cache.head != nullptr) {
+				SlabHeader* slab = cache.head;
+				cache.head = slab->next;
+				cache.count--;
+				return slab;
+			}
+			ALG_TRACK_ALLOCATION(SLAB_BYTES);
+			return static_cast<SlabHeader*>(::operator new(SLAB_BYTES));
+		}
+
+		inline void releaseSlab(SlabHeader* slab) {
+			thread_local SlabCacheCleanup cleanup;
+			(void)cleanup;
+
+			SlabCache& cache = threadSlabCache();
+			if (cache.closed || cache.count >= MAX_CACHED_SLABS) {
+				ALG_TRACK_DEALLOCATION(SLAB_BYTES);
+				::operator delete(slab);
+				return;
+			}
+			slab->next = cache.head;
+			cache.head = slab;
+			cache.count++;
+		}
+
+		/* Whether Allocator can drop every allocation at once through release()
+		*/
+		template <typename Allocator>
+		struct ReleasesInBulk {
+			enum { value = false };
+		};
+	}
+
+	/* Pool of fixed size objects of type T, usable as the Allocator of the node based
+	* containers (which rebind it to their node type); it can only allocate one object at a time
+	* Note: a pool belongs to one container and can not be copied
+	*/
+	template <typename T>
+	class NodePool {
+	public:
+		typedef T value_type;
+
+		template <typename U>
+		struct rebind {
+			typedef NodePool<U> other;
+		};
+
+	private:
+		typedef node_pool_detail::SlabHeader SlabHeader;
+
+		union Slot {
+			Slot* next;
+			alignas(T) unsigned char storage[sizeof(T)];
+		};
+
+		enum {
+			// the slots start right after the header, aligned for T
+			FIRST_SLOT = (sizeof(SlabHeader) + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot),
+			SLOTS_PER_SLAB = (node_pool_detail::SLAB_BYTES - FIRST_SLOT) / sizeof(Slot)
+		};
+
+		static_assert(SLOTS_PER_SLAB > 0, "node type too large for NodePool");
+		static_assert(alignof(Slot) <= alignof(std::max_align_t), "node type over-aligned for NodePool");
+
+		SlabHeader* m_slabs; // every slab owned by the pool
+		SlabHeader* m_lastSlab; // end of the m_slabs chain, for adopt()
+		Slot* m_freeList;
+		Slot* m_freeTail; // last slot on the free list (stale while the list is empty)
+		Slot* m_next; // first slot of the newest slab that was never handed out
+		Slot* m_end;
+		size_t m_slabCount;
+
+	public:
+		NodePool() : m_slabs(nullptr), m_lastSlab(nullptr), m_freeList(nullptr), m_freeTail(nullptr),
+			m_next(nullptr), m_end(nullptr), m_slabCount(0) {}
+
+		template <typename U>
+		NodePool(const NodePool<U>&) : NodePool() {}
+
+		~NodePool() {
+			release();
+		}
+
+		NodePool(const NodePool&) = delete;
+		NodePool& operator=(const NodePool&) = delete;
+
+		/* Allocate storage for one T (not constructed)
+		*/
+		T* allocate(size_t n = 1) {
+			if (n != 1) throw std::bad_alloc();
+
+			Slot* slot = m_freeList;
+			if (slot != nullptr) {
+				m_freeList = slot->next;
+			}
+			else {
+				if (m_next == m_end) {
+					SlabHeader* slab = node_pool_detail::acquireSlab();
+					slab->next = m_slabs;
+					if (m_slabs == nullptr) m_lastSlab = slab;
+					m_slabs = slab;
+					m_slabCount++;
+					m_next = reinterpret_cast<Slot*>(reinterpret_cast<unsigned char*>(slab) + FIRST_SLOT);
+					m_end = m_next + SLOTS_PER_SLAB;
+				}
+				slot = m_next++;
+			}
+			return reinterpret_cast<T*>(slot->storage);
+		}
+
+		/* Return storage from allocate() to the pool; the object has to be destroyed already
+		*/
+		void deallocate(T* pointer, size_t = 1) {
+			Slot* slot = reinterpret_cast<Slot*>(pointer);
+			slot->next = m_freeList;
+			if (m_freeList == nullptr) m_freeTail = slot;
+			m_freeList = slot;
+		}
+
+		/* Take over every slab of <other>, so that objects allocated from it may be deallocated
+		* through (and are released with) this pool; <other> is left empty
+		* Note: O(1); of the two partly used slabs only the one with more room left keeps
+		* handing out fresh slots, the rest of the other stays unused until release()
+		*/
+		void adopt(NodePool& other) {
+			if (&other == this || other.m_slabs == nullptr) return;
+
+			other.m_lastSlab->next = m_slabs;
+			if (m_slabs == nullptr) m_lastSlab = other.m_lastSlab;
+			m_slabs = other.m_slabs;
+			m_slabCount += other.m_slabCount;
+
+			if (other.m_freeList != nullptr) {
+				other.m_freeTail->next = m_freeList;
+				if (m_freeList == nullptr) m_freeTail = other.m_freeTail;
+				m_freeList = other.m_freeList;
+			}
+
+			if (other.m_end - other.m_next > m_end - m_next) {
+				m_next = other.m_next;
+				m_end = other.m_end;
+			}
+
+			other.m_slabs = nullptr;
+			other.m_lastSlab = nullptr;
+			other.m_freeList = nullptr;
+			other.m_next = nullptr;
+			other.m_end = nullptr;
+			other.m_slabCount = 0;
+		}
+
+		/* Drop every allocation at once and hand the slabs back to the thread's cache
+		* Note: does not run destructors; every pointer from allocate() becomes invalid
+		*/
+		void release() {
+			while (m_slabs != nullptr) {
+				SlabHeader* next = m_slabs->next;
+				node_pool_detail::releaseSlab(m_slabs);
+				m_slabs = next;
+			}
+			m_lastSlab = nullptr;
+			m_freeList = nullptr;
+			m_next = nullptr;
+			m_end = nullptr;
+			m_slabCount = 0;
+		}
+
+		inline size_t getSlabCount() const {
+			return m_slabCount;
+		}
+	};
+
+	namespace node_pool_detail {
+		template <typename T>
+		struct ReleasesInBulk<NodePool<T>> {
+			enum { value = true };
+		};
+
+		/* Heap bytes <allocator> holds for <nodes> live nodes of <nodeSize> bytes each
+		*/
+		template <typename Allocator>
+		inline size_t heldBytes(const Allocator&, size_t nodes, size_t nodeSize) {
+			return nodes * nodeSize;
+		}
+
+		/* A pool holds its whole slabs, including the free and never used slots
+		*/
+		template <typename T>
+		inline size_t heldBytes(const NodePool<T>& pool, size_t, size_t) {
+			return pool.getSlabCount() * SLAB_BYTES;
+		}
+	}
+}
@@ -0,0 +1,298 @@
+#pragma once
+#include "node_pool.h"
+#include "red_black_tree.h"
+#include <exception>
+#include <memory>
+#include <new>
+#include <string>
+
+// red-black tree augmented with subtree sizes (an order statistic tree)
+// every node counts the nodes below it, itself included, so besides the usual O(log n) insert,
+// getValue and deleteKey it answers "how many keys are smaller than this one" (rankOf) and
+// "which key is the k-th smallest" (selectKth) in O(log n) by summing and following the left
+// subtree sizes along a single descent. The balancing is RBTree's (rb_detail::RBTreeCore); the
+// sizes are its augmentation. Rotations only change the sizes of the two nodes they move, so
+// keeping them up to date does not change the cost of rebalancing.
+// RE: Introduction to Algorithms (CLRS), chapter 14.1
+// https://en.wikipedia.org/wiki/Order_statistic_tree
+
+namespace alg {
+	namespace ost_detail {
+		template <typename KeyT, typename ValueT>
+		struct Node {
+			KeyT key;
+			ValueT value;
+			Node* left;
+			Node* right;
+			Node* parent;
+			int size; // nodes in the subtree rooted here; 0 for the sentinel
+			rb_detail::Color color;
+		};
+
+		/* RBTreeCore augmentation keeping Node::size up to date
+		*/
+		struct SubtreeSize {
+			static const bool ENABLED = true;
+
+			template <typename NodeT>
+			static inline void update(NodeT* node) {
+				node->size = node->left->size + node->right->size + 1;
+			}
+		};
+	}
+
+	/* Note: nodes come from <Allocator> rebound to the node type, like BST
+	*/
+	template <typename KeyT, typename ValueT, typename Allocator = NodePool<KeyT>>
+	class OrderStatisticTree : private rb_detail::RBTreeCore<ost_detail::Node<KeyT, ValueT>, ost_detail::SubtreeSize> {
+	private:
+		class KeyNotFoundException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "key not found";
+			}
+		} exception_key_not_found;
+
+		class IndexOutOfBoundsException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "order statistic tree index out of bounds";
+			}
+		} exception_ioob;
+
+		typedef ost_detail::Node<KeyT, ValueT> TreeNode;
+		typedef rb_detail::RBTreeCore<TreeNode, ost_detail::SubtreeSize> Core;
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<TreeNode> NodeAllocator;
+		using Core::m_root;
+		using Core::m_nil;
+		using Core::minimum;
+
+	// member variables
+	private:
+		NodeAllocator m_allocator;
+
+	// methods
+	private:
+		TreeNode* createNode(const KeyT& key, const ValueT& value) {
+			TreeNode* node = m_allocator.allocate(1);
+			try {
+				new (node) TreeNode{ key, value, m_nil, m_nil, m_nil, 1, rb_detail::RED };
+			}
+			catch (...) {
+				m_allocator.deallocate(node, 1);
+				throw;
+			}
+			return node;
+		}
+
+		void destroyNode(TreeNode* node) {
+			node->~TreeNode();
+			m_allocator.deallocate(node, 1);
+		}
+
+		/* Destroys every node; iterative, so the depth of the tree does not matter
+		*/
+		void destruct(TreeNode* node) {
+			while (node != m_nil) {
+				if (node->left != m_nil) {
+					TreeNode* left = node->left;
+					node->left = left->right;
+					left->right = node;
+					node = left;
+				}
+				else {
+					TreeNode* right = node->right;
+					destroyNode(node);
+					node = right;
+				}
+			}
+		}
+
+		std::string toString(const TreeNode* node, const int indent) {
+			if (node == m_nil) return "";
+
+			std::string str;
+			for (int i = 0; i < indent; i++) str += " ";
+			str += std::to_string(node->key) + ", " + std::to_string(node->value);
+			str += " [" + std::to_string(node->size) + "]";
+			str += node->color == rb_detail::RED ? " (red)\n" : " (black)\n";
+			if (node->left != m_nil) {
+				for (int i = 0; i <= indent; i++) str += " ";
+				str += toString(node->left, indent + 1);
+			}
+			if (node->right != m_nil) {
+				for (int i = 0; i <= indent; i++) str += " ";
+				str += toString(node->right, indent + 1);
+			}
+			return str;
+		}
+
+		/* The next node in key order, m_nil after the last one
+		*/
+		inline TreeNode* successor(TreeNode* node) const {
+			if (node->right != m_nil) return minimum(node->right);
+
+			TreeNode* parent = node->parent;
+			while (parent != m_nil && node == parent->right) {
+				node = parent;
+				parent = parent->parent;
+			}
+			return parent;
+		}
+
+		/* The node holding the <index>-th smallest key (0 based), which has to exist
+		*/
+		TreeNode* select(int index) const {
+			TreeNode* node = m_root;
+			while (true) {
+				int leftSize = node->left->size;
+				if (index < leftSize) {
+					node = node->left;
+				}
+				else if (index == leftSize) {
+					return node;
+				}
+				else {
+					index -= leftSize + 1;
+					node = node->right;
+				}
+			}
+		}
+
+		/* Builds a balanced tree out of the sorted arrays keys[first, last) and values[first, last)
+		* into <slot>; the nodes on the lowest level, which is the only one that may be incomplete,
+		* are red and all others black, so every path has the same number of black nodes
+		*/
+		int build(TreeNode*& slot, TreeNode* parent, const KeyT keys[], const ValueT values[], int first, int last,
+			int depth, int redDepth) {
+			if (first >= last) return 0;
+
+			int middle = first + (last - first) / 2;
+			TreeNode* node = createNode(keys[middle], values[middle]);
+			node->parent = parent;
+			node->color = depth == redDepth ? rb_detail::RED : rb_detail::BLACK;
+			slot = node;
+			node->size = build(node->left, node, keys, values, first, middle, depth + 1, redDepth) +
+				build(node->right, node, keys, values, middle + 1, last, depth + 1, redDepth) + 1;
+			return node->size;
+		}
+
+	public:
+		// the core's sentinel is value initialized, so its size is 0
+		OrderStatisticTree() {}
+
+		~OrderStatisticTree() {
+			destruct(m_root);
+		}
+
+		OrderStatisticTree(const OrderStatisticTree&) = delete;
+		OrderStatisticTree& operator=(const OrderStatisticTree&) = delete;
+
+		/* Remove every key
+		*/
+		void clear() {
+			destruct(m_root);
+			m_root = m_nil;
+		}
+
+		/* Insert a key, value pair; a duplicate key is inserted to the right of the existing one
+		*/
+		void insert(const KeyT& key, const ValueT& value) {
+			this->link(createNode(key, value));
+		}
+
+		/* Return the value corresponding to a given key
+		* Note: throws an error if the key is not found
+		*/
+		ValueT getValue(const KeyT& key) {
+			TreeNode* node = this->find(key);
+
+			if (node == m_nil) {
+				throw exception_key_not_found;
+			}
+
+			return node->value;
+		}
+
+		bool deleteKey(const KeyT& key) {
+			TreeNode* node = this->find(key);
+
+			if (node == m_nil) return false;
+
+			this->unlink(node);
+			destroyNode(node);
+			return true;
+		}
+
+		/* Replace the contents of the tree with a balanced tree built in O(n)
+		* @param keys the keys in ascending order
+		* @param values the value of each key
+		* @param size the number of keys
+		*/
+		void bulkLoad(const KeyT keys[], const ValueT values[], int size) {
+			clear();
+			// a perfect tree of 2^levels - 1 nodes is all black; the nodes beyond that hang one
+			// level deeper
+			int levels = 0;
+			while ((2 << levels) - 1 <= size) levels++;
+			build(m_root, m_nil, keys, values, 0, size, 0, levels);
+			m_root->color = rb_detail::BLACK;
+		}
+
+		/* Number of keys less than <key>, which is the index <key> has (or would get) in key
+		* order; O(log n)
+		*/
+		int rankOf(const KeyT& key) const {
+			int rank = 0;
+			TreeNode* node = m_root;
+			while (node != m_nil) {
+				if (node->key < key) {
+					rank += node->left->size + 1;
+					node = node->right;
+				}
+				else {
+					node = node->left;
+				}
+			}
+			return rank;
+		}
+
+		/* The <index>-th smallest key (0 based); O(log n)
+		* Note: throws an error if <index> is out of bounds
+		*/
+		const KeyT& selectKth(int index) const {
+			if (index < 0 || index >= m_root->size) throw exception_ioob;
+			return select(index)->key;
+		}
+
+		/* Calls callback(key, value) for the keys with index [first, first + count) in key order
+		* (clipped to the tree); O(log n + count)
+		*/
+		template <typename F>
+		void visit(int first, int count, F callback) const {
+			if (first < 0) {
+				count += first;
+				first = 0;
+			}
+			if (count <= 0 || first >= m_root->size) return;
+
+			TreeNode* node = select(first);
+			for (int i = 0; i < count && node != m_nil; i++) {
+				callback(node->key, node->value);
+				node = successor(node);
+			}
+		}
+
+		inline int getSize() const {
+			return m_root->size;
+		}
+
+		inline bool isEmpty() const {
+			return m_root == m_nil;
+		}
+
+		std::string toString() {
+			return toString(m_root, 0);
+		}
+	};
+}
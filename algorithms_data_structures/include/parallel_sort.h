@@ -0,0 +1,172 @@
+#pragma once
+#include "sort.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// parallel merge sort
+// the range is split recursively until the pieces are small enough for the serial kernel,
+// then merged back up; large merges are split in two by binary search so they run in
+// parallel as well. Results ping-pong between the array and one buffer of the same size.
+// https://en.wikipedia.org/wiki/Merge_sort#Parallel_merge_sort
+
+namespace alg {
+	namespace parallel_sort_detail {
+		// ranges smaller than this are sorted serially
+		const std::ptrdiff_t PARALLEL_THRESHOLD = 1 << 15;
+		// merges smaller than this are not split further
+		const std::ptrdiff_t MERGE_GRAIN = 1 << 14;
+
+		/* Merges the sorted ranges a and b into out, taking from a on ties
+		*/
+		template <typename T, typename Compare>
+		void mergeSerial(T* a, std::ptrdiff_t sizeA, T* b, std::ptrdiff_t sizeB, T* out, Compare comp) {
+			T* endA = a + sizeA;
+			T* endB = b + sizeB;
+			while (a != endA && b != endB) {
+				if (comp(*b, *a)) {
+					*out++ = std::move(*b++);
+				}
+				else {
+					*out++ = std::move(*a++);
+				}
+			}
+			out = std::move(a, endA, out);
+			std::move(b, endB, out);
+		}
+
+		template <typename T, typename Compare>
+		void mergeParallel(ThreadPool& pool, T* a, std::ptrdiff_t sizeA, T* b, std::ptrdiff_t sizeB,
+			T* out, Compare comp) {
+			if (sizeA + sizeB <= MERGE_GRAIN) {
+				mergeSerial(a, sizeA, b, sizeB, out, comp);
+				return;
+			}
+
+			// split the larger side in half and find where its middle element lands in the other;
+			// elements of a go before equal elements of b to keep the merge stable
+			std::ptrdiff_t splitA, splitB;
+			if (sizeA >= sizeB) {
+				splitA = sizeA / 2;
+				splitB = std::lower_bound(b, b + sizeB, a[splitA], comp) - b;
+			}
+			else {
+				splitB = sizeB / 2;
+				splitA = std::upper_bound(a, a + sizeA, b[splitB], comp) - a;
+			}
+
+			TaskGroup group(pool);
+			group.run([&pool, a, b, out, splitA, splitB, comp]() {
+				mergeParallel(pool, a, splitA, b, splitB, out, comp);
+			});
+			mergeParallel(pool, a + splitA, sizeA - splitA, b + splitB, sizeB - splitB,
+				out + splitA + splitB, comp);
+			group.wait();
+		}
+
+		/* Sorts data[0, size); the result ends up in buffer if toBuffer is set, in data otherwise
+		*/
+		template <typename T, typename Compare, typename Leaf>
+		void sortRange(ThreadPool& pool, T* data, T* buffer, std::ptrdiff_t size, bool toBuffer,
+			std::ptrdiff_t grain, Compare comp, Leaf leaf) {
+			if (size <= grain) {
+				leaf(data, data + size);
+				if (toBuffer) std::move(data, data + size, buffer);
+				return;
+			}
+
+			// sort both halves into the other array, then merge them into the target
+			std::ptrdiff_t half = size / 2;
+			TaskGroup group(pool);
+			group.run([&pool, data, buffer, half, toBuffer, grain, comp, leaf]() {
+				sortRange(pool, data, buffer, half, !toBuffer, grain, comp, leaf);
+			});
+			sortRange(pool, data + half, buffer + half, size - half, !toBuffer, grain, comp, leaf);
+			group.wait();
+
+			T* source = toBuffer ? data : buffer;
+			T* target = toBuffer ? buffer : data;
+			mergeParallel(pool, source, half, source + half, size - half, target, comp);
+		}
+
+		template <typename T, typename Compare, typename Leaf>
+		void parallelSort(ThreadPool& pool, T* first, T* last, Compare comp, Leaf leaf) {
+			std::ptrdiff_t size = last - first;
+			int threads = pool.getThreadCount() + 1;
+			if (size < PARALLEL_THRESHOLD || threads <= 1) {
+				leaf(first, last);
+				return;
+			}
+
+			// a few pieces per thread so that stealing can even out the load
+			std::ptrdiff_t grain = std::max(PARALLEL_THRESHOLD / 2, size / (threads * 4));
+			std::vector<T> buffer(size);
+			sortRange(pool, first, buffer.data(), size, false, grain, comp, leaf);
+		}
+
+		template <typename T>
+		struct DefaultLeaf {
+			void operator()(T* first, T* last) const { Sort(first, last); }
+		};
+
+		template <typename Compare>
+		struct StableLeaf {
+			Compare comp;
+			template <typename T>
+			void operator()(T* first, T* last) const { StableSort(first, last, comp); }
+		};
+	}
+
+	/* Sort array <arr> starting from <start> until <end> using the threads of <pool>
+	@param pool the pool to run on; the calling thread helps as well
+	@param arr the array to be sorted
+	@param start the starting index of the subarray to be sorted
+	@param end the ending index of the subarray to be sorted (inclusive, same as BubbleSort)
+	@param comp the comparator; comp(a, b) returns true if a should come before b
+
+	Notes: mutates arr; stable, the result is identical to StableSort(arr, start, end, comp)
+	*/
+	template <typename T, typename Compare>
+	static void ParallelSort(ThreadPool& pool, T arr[], int start, int end, Compare comp) {
+		if (end <= start) return;
+		parallel_sort_detail::StableLeaf<Compare> leaf = { comp };
+		parallel_sort_detail::parallelSort(pool, arr + start, arr + end + 1, comp, leaf);
+	}
+
+	/* Sort array <arr> starting from <start> until <end> in ascending order using the
+	threads of <pool>
+
+	Notes: mutates arr; uses Sort (so radix sort for arithmetic types) on each piece.
+	The result is identical to Sort(arr, start, end) for any type with a total order
+	(floats only differ in where -0.0 and 0.0 end up relative to each other).
+	*/
+	template <typename T>
+	static void ParallelSort(ThreadPool& pool, T arr[], int start, int end) {
+		if (end <= start) return;
+		parallel_sort_detail::parallelSort(pool, arr + start, arr + end + 1, std::less<T>(),
+			parallel_sort_detail::DefaultLeaf<T>());
+	}
+
+	/* Sort array <arr> starting from <start> until <end> on <threads> threads
+	@param threads the number of threads to use including the calling one;
+	0 uses every hardware thread
+
+	Notes: starts a pool for the call; pass a ThreadPool to reuse one across calls
+	*/
+	template <typename T, typename Compare>
+	static void ParallelSort(T arr[], int start, int end, int threads, Compare comp) {
+		if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+		ThreadPool pool(threads - 1);
+		ParallelSort(pool, arr, start, end, comp);
+	}
+
+	template <typename T>
+	static void ParallelSort(T arr[], int start, int end, int threads) {
+		if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+		ThreadPool pool(threads - 1);
+		ParallelSort(pool, arr, start, end);
+	}
+}
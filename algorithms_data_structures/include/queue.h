@@ -1,12 +1,19 @@
 #pragma once
+#include "instrumentation.h"
+#include "memory_usage.h"
+#include <cstring>
 #include <string>
+#include <type_traits>
 
 // circular queue implementation
+// Queue<T, true> rounds the capacity up to a power of two so that indices wrap with a mask;
+// the default mode wraps with a compare instead of %, since an index never gets past twice
+// the capacity
 // https://en.wikipedia.org/wiki/Queue_(abstract_data_type)%20
 // https://en.wikipedia.org/wiki/Circular_buffer
 
 namespace alg {
-	template<typename T>
+	template<typename T, bool PowerOfTwo = false>
 	class Queue {
 	private:
 		class QueueEmptyException : public std::exception {
@@ -24,20 +31,80 @@ namespace alg {
 		} exception_ioob;
 		
 		int m_capacity;
+		int m_mask; // m_capacity - 1 in power of two mode
 		int m_size;	// number of items in the queue
 		int m_front; // index of the front of the queue
 		int m_rear;	// index of the end of the queue
 		T* m_elements;
+
+		/* Maps an index in [0, 2 * capacity) back into the array
+		*/
+		inline int wrap(int index, std::true_type) const {
+			return index & m_mask;
+		}
+
+		inline int wrap(int index, std::false_type) const {
+			return index >= m_capacity ? index - m_capacity : index;
+		}
+
+		inline int wrap(int index) const {
+			return wrap(index, std::integral_constant<bool, PowerOfTwo>());
+		}
+
+		// trivially copyable elements are copied as raw memory
+		static inline void copyElements(T* destination, const T* source, int count, std::true_type) {
+			if (count > 0) std::memcpy(destination, source, sizeof(T) * count);
+		}
+
+		static inline void copyElements(T* destination, const T* source, int count, std::false_type) {
+			for (int i = 0; i < count; i++) destination[i] = source[i];
+		}
+
+		static inline void copyElements(T* destination, const T* source, int count) {
+			copyElements(destination, source, count, std::is_trivially_copyable<T>());
+		}
+
 	public:
+		/* A contiguous run of elements inside the queue
+		*/
+		struct Span {
+			T* data;
+			int size;
+
+			T* begin() const { return data; }
+			T* end() const { return data + size; }
+		};
+
+		/* The part of the queue that can be read (or written) in place; it wraps around the end
+		* of the array at most once, so it is made of at most two spans
+		*/
+		struct Regions {
+			Span first;
+			Span second;
+
+			int size() const { return first.size + second.size; }
+		};
+
+		/* Note: in power of two mode the capacity is rounded up to the next power of two
+		*/
 		Queue(int capacity) {
+			if (PowerOfTwo) {
+				int size = 1;
+				while (size < capacity) size *= 2;
+				capacity = size;
+			}
 			m_capacity = capacity;
+			m_mask = capacity - 1;
 			m_size = 0;
 			m_front = 0;
 			m_rear = -1; // set to -1 since enqueueing first item will set it to zero
+			ALG_COUNT(QueueAllocations);
 			m_elements = new T[capacity];
+			ALG_TRACK_ALLOCATION(sizeof(T) * capacity);
 		}
 
 		~Queue() {
+			ALG_TRACK_DEALLOCATION(sizeof(T) * m_capacity);
 			delete[] m_elements;
 		}
 
@@ -50,12 +117,13 @@ namespace alg {
 		*/
 		inline bool enqueue(T value) {
 			if (m_size < m_capacity) {
-					m_rear = (m_rear + 1) % m_capacity;
-					m_elements[m_rear] = value;
+				m_rear = wrap(m_rear + 1);
+				m_elements[m_rear] = value;
 				m_size++;
 				return true;
 			}
 
+			ALG_COUNT(QueueFullRejections);
 			return false;
 		}
 
@@ -64,6 +132,7 @@ namespace alg {
 		*/
 		inline T dequeue() {
 			if (m_size == 0) {
+				ALG_COUNT(QueueEmptyRejections);
 				throw exception_empty;
 			}
 			// else:
@@ -71,7 +140,7 @@ namespace alg {
 			T& temp = m_elements[m_front]; // store the element for later
 
 			m_size--;
-			m_front = (m_front + 1) % m_capacity; // this ensures circularity
+			m_front = wrap(m_front + 1); // this ensures circularity
 
 			// Note: we technically don't have to remove the object from the array just change the index
 			return temp;
@@ -84,7 +153,84 @@ namespace alg {
 			if (index < 0 || index >= m_size) {
 				throw exception_ioob;
 			}
-			return m_elements[(m_front + index) % m_capacity];
+			return m_elements[wrap(m_front + index)];
+		}
+
+		/* Enqueue up to <count> elements from <values>, copied in at most two contiguous runs
+		@return the number of elements enqueued, less than <count> if the queue got full
+		*/
+		int enqueue_bulk(const T* values, int count) {
+			int free = m_capacity - m_size;
+			if (count > free) {
+				ALG_COUNT_N(QueueFullRejections, count - free);
+				count = free;
+			}
+			if (count <= 0) return 0;
+
+			int start = wrap(m_rear + 1);
+			int first = m_capacity - start < count ? m_capacity - start : count;
+			copyElements(m_elements + start, values, first);
+			copyElements(m_elements, values + first, count - first);
+
+			m_rear = wrap(m_rear + count);
+			m_size += count;
+			return count;
+		}
+
+		/* Dequeue up to <count> elements into <values>, copied out in at most two contiguous runs
+		@return the number of elements dequeued, less than <count> if the queue got empty
+		*/
+		int dequeue_bulk(T* values, int count) {
+			if (count > m_size) count = m_size;
+			if (count <= 0) return 0;
+
+			int first = m_capacity - m_front < count ? m_capacity - m_front : count;
+			copyElements(values, m_elements + m_front, first);
+			copyElements(values + first, m_elements, count - first);
+
+			m_front = wrap(m_front + count);
+			m_size -= count;
+			return count;
+		}
+
+		/* The enqueued elements, front first, to be read in place; call commit_read with the
+		* number of elements consumed from the front
+		*/
+		Regions readable_regions() {
+			int first = m_capacity - m_front < m_size ? m_capacity - m_front : m_size;
+			Regions regions = { { m_elements + m_front, first }, { m_elements, m_size - first } };
+			return regions;
+		}
+
+		/* Dequeue <count> elements that were read through readable_regions
+		*/
+		void commit_read(int count) {
+			if (count < 0 || count > m_size) {
+				throw exception_ioob;
+			}
+			m_front = wrap(m_front + count);
+			m_size -= count;
+		}
+
+		/* The free slots behind the end of the queue, to be filled in place; call commit_write
+		* with the number of elements written from the start of the regions
+		*/
+		Regions writable_regions() {
+			int start = wrap(m_rear + 1);
+			int free = m_capacity - m_size;
+			int first = m_capacity - start < free ? m_capacity - start : free;
+			Regions regions = { { m_elements + start, first }, { m_elements, free - first } };
+			return regions;
+		}
+
+		/* Enqueue <count> elements that were written through writable_regions
+		*/
+		void commit_write(int count) {
+			if (count < 0 || count > m_capacity - m_size) {
+				throw exception_ioob;
+			}
+			m_rear = wrap(m_rear + count);
+			m_size += count;
 		}
 
 		inline int getSize() const {
@@ -95,6 +241,19 @@ namespace alg {
 			return m_capacity;
 		}
 
+		/* Bytes held by the queue; the whole ring is allocated up front
+		*/
+		MemoryUsage memoryUsage() const {
+			MemoryUsage usage;
+			usage.objectBytes = sizeof(*this);
+			usage.allocatedBytes = (size_t)m_capacity * sizeof(T);
+			usage.liveBytes = (size_t)m_size * sizeof(T);
+			usage.payloadBytes = usage.liveBytes;
+			usage.elementCount = m_size;
+			usage.nodeCount = 1;
+			return usage;
+		}
+
 		// WARNING: make sure std::to_string works on type T
 		std::string toString() {
 			int i = m_front;
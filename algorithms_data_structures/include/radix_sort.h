@@ -0,0 +1,138 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// least significant digit radix sort for arithmetic types
+// https://en.wikipedia.org/wiki/Radix_sort#Least_significant_digit
+// http://stereopsis.com/radix.html (sorting floats by their bits)
+
+namespace alg {
+	namespace radix_detail {
+		// one byte per digit
+		const int RADIX_BITS = 8;
+		const int RADIX = 1 << RADIX_BITS;
+
+		/* Maps a value to an unsigned key with the same ordering
+		*/
+		template <typename T, bool IsIntegral = std::is_integral<T>::value>
+		struct RadixKey;
+
+		template <typename T>
+		struct RadixKey<T, true> {
+			typedef typename std::make_unsigned<T>::type Key;
+
+			static inline Key get(T value) {
+				// flipping the sign bit puts negative numbers before positive ones
+				const Key signBit = std::is_signed<T>::value ? (Key)((Key)1 << (sizeof(Key) * 8 - 1)) : 0;
+				return (Key)((Key)value ^ signBit);
+			}
+		};
+
+		template <>
+		struct RadixKey<float, false> {
+			typedef uint32_t Key;
+
+			static inline Key get(float value) {
+				Key bits;
+				std::memcpy(&bits, &value, sizeof(bits));
+				// negative floats: flip all bits so larger magnitudes sort first;
+				// positive floats: flip the sign bit so they sort after the negatives
+				return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+			}
+		};
+
+		template <>
+		struct RadixKey<double, false> {
+			typedef uint64_t Key;
+
+			static inline Key get(double value) {
+				Key bits;
+				std::memcpy(&bits, &value, sizeof(bits));
+				return (bits & 0x8000000000000000ull) ? ~bits : (bits | 0x8000000000000000ull);
+			}
+		};
+
+		template <typename T>
+		struct IsRadixSortable : std::integral_constant<bool,
+			(std::is_integral<T>::value && !std::is_same<T, bool>::value)
+			|| std::is_same<T, float>::value || std::is_same<T, double>::value> {};
+	}
+
+	/* Sort the range [first, last) of integers, floats or doubles with LSD radix sort
+	@param first pointer to the first element to be sorted
+	@param last pointer past the last element to be sorted
+
+	Notes: stable; O(n) time with one pass per byte of T, O(n) extra memory;
+	bytes in which every element is the same are skipped.
+	Floats sort by value with -0.0 before 0.0 and NaNs at the ends depending on their sign bit.
+	*/
+	template <typename T>
+	static void RadixSort(T* first, T* last) {
+		static_assert(radix_detail::IsRadixSortable<T>::value, "RadixSort needs an integer, float or double type");
+		typedef radix_detail::RadixKey<T> KeyOf;
+		typedef typename KeyOf::Key Key;
+		const int DIGITS = sizeof(Key);
+		const int RADIX = radix_detail::RADIX;
+
+		size_t size = last - first;
+		if (size < 2) return;
+
+		// build the histograms of every digit in a single pass
+		std::vector<size_t> counts(DIGITS * RADIX, 0);
+		for (size_t i = 0; i < size; i++) {
+			Key key = KeyOf::get(first[i]);
+			for (int d = 0; d < DIGITS; d++) {
+				counts[d * RADIX + ((key >> (d * radix_detail::RADIX_BITS)) & (RADIX - 1))]++;
+			}
+		}
+
+		std::vector<T> buffer(size);
+		T* source = first;
+		T* destination = buffer.data();
+
+		for (int d = 0; d < DIGITS; d++) {
+			size_t* count = &counts[d * RADIX];
+			int shift = d * radix_detail::RADIX_BITS;
+
+			// every element has the same digit so this pass would not move anything
+			if (count[(KeyOf::get(source[0]) >> shift) & (RADIX - 1)] == size) continue;
+
+			// turn the counts into starting offsets
+			size_t offset = 0;
+			for (int i = 0; i < RADIX; i++) {
+				size_t temp = count[i];
+				count[i] = offset;
+				offset += temp;
+			}
+
+			for (size_t i = 0; i < size; i++) {
+				T value = source[i];
+				destination[count[(KeyOf::get(value) >> shift) & (RADIX - 1)]++] = value;
+			}
+
+			T* temp = source;
+			source = destination;
+			destination = temp;
+		}
+
+		// an odd number of passes leaves the result in the buffer
+		if (source != first) {
+			std::memcpy(first, source, size * sizeof(T));
+		}
+	}
+
+	/* Sort array <arr> starting from <start> until <end> with LSD radix sort
+	@param arr the array to be sorted
+	@param start the starting index of the subarray to be sorted
+	@param end the ending index of the subarray to be sorted (inclusive, same as BubbleSort)
+
+	Notes: mutates arr
+	*/
+	template <typename T>
+	static void RadixSort(T arr[], int start, int end) {
+		if (end <= start) return;
+		RadixSort(arr + start, arr + end + 1);
+	}
+}
@@ -0,0 +1,229 @@
+#pragma once
+#include "elo.h"
+#include "order_statistic_tree.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+// matchmaking and leaderboard queries over a table of Elo ratings
+// every player is kept in an order statistic tree under the key (rating, player ID), ordered from
+// the highest rating down (the ID breaks ties, so keys are unique and the order is total). A
+// player's rank is then the number of keys in front of its key, the k-th best player a select,
+// a leaderboard page a select followed by an in-order walk, and the k players closest to a rating
+// are found among the k keys on either side of where that rating would go; all in
+// O(log n + k). Applying a game moves both players: their old keys are deleted and the new ones
+// inserted.
+// Queries take a shared lock and updates an exclusive one, so any number of queries run at once
+// while updates are applied one at a time; a waiting update keeps new queries out.
+// https://en.wikipedia.org/wiki/Order_statistic_tree
+// https://en.wikipedia.org/wiki/Readers%E2%80%93writer_lock
+
+namespace alg {
+	/* A player and its rating, as returned by RatingIndex queries
+	*/
+	struct RatedPlayer {
+		int player;
+		double rating;
+	};
+
+	class RatingIndex {
+	private:
+		class IndexOutOfBoundsException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "player index out of bounds";
+			}
+		} exception_ioob;
+
+		/* Orders players from the highest rating down
+		*/
+		struct RankKey {
+			double rating;
+			int player;
+
+			inline bool operator<(const RankKey& other) const {
+				return rating > other.rating || (rating == other.rating && player < other.player);
+			}
+
+			inline bool operator!=(const RankKey& other) const {
+				return rating != other.rating || player != other.player;
+			}
+		};
+
+		// the value is unused, the key already names the player
+		OrderStatisticTree<RankKey, char> m_tree;
+		std::vector<double> m_ratings;
+		mutable std::shared_mutex m_mutex;
+		// shared_mutex does not promise that a waiting writer gets in (glibc lets new readers pass
+		// it), so a steady stream of queries could starve the updates; queries hold back while
+		// an update is waiting
+		mutable std::atomic<int> m_waitingWriters;
+
+		/* Shared lock for a query, taken once no update is waiting
+		*/
+		class ReadLock {
+		private:
+			const RatingIndex& m_index;
+		public:
+			ReadLock(const RatingIndex& index) : m_index(index) {
+				while (m_index.m_waitingWriters.load(std::memory_order_acquire) > 0) std::this_thread::yield();
+				m_index.m_mutex.lock_shared();
+			}
+
+			~ReadLock() {
+				m_index.m_mutex.unlock_shared();
+			}
+		};
+
+		/* Exclusive lock for an update
+		*/
+		class WriteLock {
+		private:
+			RatingIndex& m_index;
+		public:
+			WriteLock(RatingIndex& index) : m_index(index) {
+				m_index.m_waitingWriters.fetch_add(1, std::memory_order_acq_rel);
+				m_index.m_mutex.lock();
+				m_index.m_waitingWriters.fetch_sub(1, std::memory_order_release);
+			}
+
+			~WriteLock() {
+				m_index.m_mutex.unlock();
+			}
+		};
+
+		inline void checkPlayer(int player) const {
+			if (player < 0 || player >= (int)m_ratings.size()) throw exception_ioob;
+		}
+
+		/* Moves <player> to <rating>; the caller holds the exclusive lock
+		*/
+		void move(int player, double rating) {
+			m_tree.deleteKey(RankKey{ m_ratings[player], player });
+			m_ratings[player] = rating;
+			m_tree.insert(RankKey{ rating, player }, 0);
+		}
+
+	public:
+		/* Indexes <playerCount> players with IDs 0 .. playerCount - 1, all rated <initialRating>
+		*/
+		RatingIndex(int playerCount, double initialRating = 1500.0) : m_ratings(playerCount, initialRating),
+			m_waitingWriters(0) {
+			// the IDs are already in key order
+			std::vector<RankKey> keys(playerCount);
+			for (int i = 0; i < playerCount; i++) keys[i] = RankKey{ initialRating, i };
+			std::vector<char> values(playerCount, 0);
+			m_tree.bulkLoad(keys.data(), values.data(), playerCount);
+		}
+
+		/* Indexes <playerCount> players with the ratings in <ratings>
+		*/
+		RatingIndex(const double* ratings, int playerCount) : m_ratings(ratings, ratings + playerCount),
+			m_waitingWriters(0) {
+			// sorting and building the tree in one go is O(n) after the sort, and lays the nodes
+			// out in key order instead of one scattered insert at a time
+			std::vector<RankKey> keys(playerCount);
+			for (int i = 0; i < playerCount; i++) keys[i] = RankKey{ ratings[i], i };
+			std::sort(keys.begin(), keys.end());
+			std::vector<char> values(playerCount, 0);
+			m_tree.bulkLoad(keys.data(), values.data(), playerCount);
+		}
+
+		RatingIndex(const RatingIndex&) = delete;
+		RatingIndex& operator=(const RatingIndex&) = delete;
+
+		/* Sets the rating of <player>
+		*/
+		void setRating(int player, double rating) {
+			checkPlayer(player);
+			WriteLock lock(*this);
+			move(player, rating);
+		}
+
+		/* Plays one game and moves both players to their new ratings
+		* @param resultA: the result according to player A; 1 A wins, 0 B wins, 0.5 tie
+		* Note: same formula (and results) as EloEvaluateBatch
+		*/
+		void applyGame(int playerA, int playerB, double resultA, double k = KVALUE) {
+			checkPlayer(playerA);
+			checkPlayer(playerB);
+			WriteLock lock(*this);
+			double ratings[2] = { m_ratings[playerA], m_ratings[playerB] };
+			elo_detail::playGame(ratings, 0, 1, resultA, k);
+			move(playerA, ratings[0]);
+			move(playerB, ratings[1]);
+		}
+
+		double getRating(int player) const {
+			checkPlayer(player);
+			ReadLock lock(*this);
+			return m_ratings[player];
+		}
+
+		/* @return the rank of <player>, 1 being the highest rated; ties go to the lower ID
+		*/
+		int rankOf(int player) const {
+			checkPlayer(player);
+			ReadLock lock(*this);
+			return m_tree.rankOf(RankKey{ m_ratings[player], player }) + 1;
+		}
+
+		/* @return the player with rank <rank> (1 based)
+		* Note: throws an error if <rank> is out of bounds
+		*/
+		RatedPlayer selectKth(int rank) const {
+			ReadLock lock(*this);
+			const RankKey& key = m_tree.selectKth(rank - 1);
+			return RatedPlayer{ key.player, key.rating };
+		}
+
+		/* @return the players ranked [page * pageSize + 1, (page + 1) * pageSize], best first
+		*/
+		std::vector<RatedPlayer> leaderboard(int page, int pageSize) const {
+			std::vector<RatedPlayer> result;
+			ReadLock lock(*this);
+			m_tree.visit(page * pageSize, pageSize, [&](const RankKey& key, char) {
+				result.push_back(RatedPlayer{ key.player, key.rating });
+			});
+			return result;
+		}
+
+		/* @return the <count> players whose ratings are closest to <rating>, closest first
+		* Note: O(log n + count); the players with a higher rating win ties
+		*/
+		std::vector<RatedPlayer> nearest(double rating, int count) const {
+			std::vector<RatedPlayer> above, below, result;
+			{
+				ReadLock lock(*this);
+				// everyone rated above <rating> comes before <position>
+				int position = m_tree.rankOf(RankKey{ rating, -1 });
+				m_tree.visit(position - count, count, [&](const RankKey& key, char) {
+					above.push_back(RatedPlayer{ key.player, key.rating });
+				});
+				m_tree.visit(position, count, [&](const RankKey& key, char) {
+					below.push_back(RatedPlayer{ key.player, key.rating });
+				});
+			}
+
+			// merge outwards from <position>: <above> ends next to it, <below> starts there
+			int up = (int)above.size() - 1;
+			size_t down = 0;
+			while ((int)result.size() < count && (up >= 0 || down < below.size())) {
+				if (down == below.size() || (up >= 0 && above[up].rating - rating <= rating - below[down].rating)) {
+					result.push_back(above[up--]);
+				}
+				else {
+					result.push_back(below[down++]);
+				}
+			}
+			return result;
+		}
+
+		inline int getPlayerCount() const {
+			return (int)m_ratings.size();
+		}
+	};
+}
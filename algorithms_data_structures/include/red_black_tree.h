@@ -0,0 +1,474 @@
+#pragma once
+#include <string>
+
+// self-balancing binary search tree with the same interface as alg::BST
+// the red-black invariants keep the height below 2 log2(n + 1), so insert, getValue and
+// deleteKey are O(log n) even for sorted input. Nodes keep a parent pointer so deletion never
+// has to walk down from the root again to find a parent.
+// The balancing itself lives in rb_detail::RBTreeCore, which other trees build on: a node can
+// carry extra data computed from its children (like OrderStatisticTree's subtree sizes), which
+// the core recomputes through an update hook after every change to the shape of the tree.
+// RE: Introduction to Algorithms (CLRS), chapter 13
+// https://en.wikipedia.org/wiki/Red%E2%80%93black_tree
+
+namespace alg {
+	namespace rb_detail {
+		enum Color { RED, BLACK };
+
+		template <typename KeyT, typename ValueT>
+		struct Node {
+			KeyT key;
+			ValueT value;
+			Node* left;
+			Node* right;
+			Node* parent;
+			Color color;
+		};
+
+		/* Augmentation for nodes that carry nothing derived from their children
+		*/
+		struct NoAugmentation {
+			static const bool ENABLED = false;
+
+			template <typename NodeT>
+			static inline void update(NodeT*) {}
+		};
+
+		/* The red-black tree algorithms, shared by the trees built on them
+		* <NodeT> needs key, left, right, parent and color members. Augmentation::update(node)
+		* recomputes the extra data of <node> from its children, which are already up to date;
+		* it is never called on the sentinel. Allocating and freeing nodes is up to the tree.
+		*/
+		template <typename NodeT, typename Augmentation = NoAugmentation>
+		class RBTreeCore {
+		protected:
+			NodeT* m_root;
+			// shared black sentinel used instead of nullptr for leaves and the root's parent,
+			// which removes most of the special cases from the fixups
+			NodeT* m_nil;
+
+			RBTreeCore() {
+				m_nil = new NodeT();
+				m_nil->color = BLACK;
+				m_nil->left = m_nil;
+				m_nil->right = m_nil;
+				m_nil->parent = m_nil;
+				m_root = m_nil;
+			}
+
+			~RBTreeCore() {
+				delete m_nil;
+			}
+
+			RBTreeCore(const RBTreeCore&) = delete;
+			RBTreeCore& operator=(const RBTreeCore&) = delete;
+
+			/* Returns the node with the given key
+			* @return the node, m_nil if the key is not in the tree
+			*/
+			template <typename KeyT>
+			inline NodeT* find(const KeyT& key) const {
+				NodeT* node = m_root;
+				while (node != m_nil && key != node->key) {
+					if (key < node->key) {
+						node = node->left;
+					}
+					else {
+						node = node->right;
+					}
+				}
+
+				return node;
+			}
+
+			/* Finds the minimum node belonging to the tree starting at <node>
+			*/
+			inline NodeT* minimum(NodeT* node) const {
+				while (node->left != m_nil) {
+					node = node->left;
+				}
+
+				return node;
+			}
+
+			/* Recomputes the augmented data of <node> and every node above it
+			*/
+			inline void updateToRoot(NodeT* node) {
+				if (!Augmentation::ENABLED) return;
+				for (; node != m_nil; node = node->parent) {
+					Augmentation::update(node);
+				}
+			}
+
+			/* Rotates <node> down to the left; its right child takes its place
+			*/
+			void rotateLeft(NodeT* node) {
+				NodeT* child = node->right;
+				node->right = child->left;
+				if (child->left != m_nil) child->left->parent = node;
+
+				child->parent = node->parent;
+				if (node->parent == m_nil) {
+					m_root = child;
+				}
+				else if (node == node->parent->left) {
+					node->parent->left = child;
+				}
+				else {
+					node->parent->right = child;
+				}
+
+				child->left = node;
+				node->parent = child;
+
+				// only the two rotated nodes have new children; <node> is below <child> now
+				Augmentation::update(node);
+				Augmentation::update(child);
+			}
+
+			/* Rotates <node> down to the right; its left child takes its place
+			*/
+			void rotateRight(NodeT* node) {
+				NodeT* child = node->left;
+				node->left = child->right;
+				if (child->right != m_nil) child->right->parent = node;
+
+				child->parent = node->parent;
+				if (node->parent == m_nil) {
+					m_root = child;
+				}
+				else if (node == node->parent->right) {
+					node->parent->right = child;
+				}
+				else {
+					node->parent->left = child;
+				}
+
+				child->right = node;
+				node->parent = child;
+
+				Augmentation::update(node);
+				Augmentation::update(child);
+			}
+
+			/* Restores the red-black properties after inserting the red node <node>
+			*/
+			void insertFixup(NodeT* node) {
+				// the only possible violation is a red node with a red parent
+				while (node->parent->color == RED) {
+					NodeT* grandparent = node->parent->parent;
+
+					if (node->parent == grandparent->left) {
+						NodeT* uncle = grandparent->right;
+						if (uncle->color == RED) {
+							// case 1: recolor and move the violation two levels up
+							node->parent->color = BLACK;
+							uncle->color = BLACK;
+							grandparent->color = RED;
+							node = grandparent;
+						}
+						else {
+							if (node == node->parent->right) {
+								// case 2: rotate into case 3
+								node = node->parent;
+								rotateLeft(node);
+							}
+							// case 3: recolor and rotate the grandparent
+							node->parent->color = BLACK;
+							grandparent->color = RED;
+							rotateRight(grandparent);
+						}
+					}
+					else {
+						// mirror image of the above
+						NodeT* uncle = grandparent->left;
+						if (uncle->color == RED) {
+							node->parent->color = BLACK;
+							uncle->color = BLACK;
+							grandparent->color = RED;
+							node = grandparent;
+						}
+						else {
+							if (node == node->parent->left) {
+								node = node->parent;
+								rotateRight(node);
+							}
+							node->parent->color = BLACK;
+							grandparent->color = RED;
+							rotateLeft(grandparent);
+						}
+					}
+				}
+
+				m_root->color = BLACK;
+			}
+
+			/* Replaces the subtree rooted at <node> with the subtree rooted at <replacement>
+			*/
+			void transplant(NodeT* node, NodeT* replacement) {
+				if (node->parent == m_nil) {
+					m_root = replacement;
+				}
+				else if (node == node->parent->left) {
+					node->parent->left = replacement;
+				}
+				else {
+					node->parent->right = replacement;
+				}
+
+				// may set the sentinel's parent, which deleteFixup relies on
+				replacement->parent = node->parent;
+			}
+
+			/* Restores the red-black properties after removing a black node; <node> carries the
+			* missing "extra black"
+			*/
+			void deleteFixup(NodeT* node) {
+				while (node != m_root && node->color == BLACK) {
+					if (node == node->parent->left) {
+						NodeT* sibling = node->parent->right;
+						if (sibling->color == RED) {
+							// case 1: make the sibling black
+							sibling->color = BLACK;
+							node->parent->color = RED;
+							rotateLeft(node->parent);
+							sibling = node->parent->right;
+						}
+
+						if (sibling->left->color == BLACK && sibling->right->color == BLACK) {
+							// case 2: push the extra black up
+							sibling->color = RED;
+							node = node->parent;
+						}
+						else {
+							if (sibling->right->color == BLACK) {
+								// case 3: rotate into case 4
+								sibling->left->color = BLACK;
+								sibling->color = RED;
+								rotateRight(sibling);
+								sibling = node->parent->right;
+							}
+							// case 4: rotate the extra black away
+							sibling->color = node->parent->color;
+							node->parent->color = BLACK;
+							sibling->right->color = BLACK;
+							rotateLeft(node->parent);
+							node = m_root;
+						}
+					}
+					else {
+						// mirror image of the above
+						NodeT* sibling = node->parent->left;
+						if (sibling->color == RED) {
+							sibling->color = BLACK;
+							node->parent->color = RED;
+							rotateRight(node->parent);
+							sibling = node->parent->left;
+						}
+
+						if (sibling->right->color == BLACK && sibling->left->color == BLACK) {
+							sibling->color = RED;
+							node = node->parent;
+						}
+						else {
+							if (sibling->left->color == BLACK) {
+								sibling->right->color = BLACK;
+								sibling->color = RED;
+								rotateLeft(sibling);
+								sibling = node->parent->left;
+							}
+							sibling->color = node->parent->color;
+							node->parent->color = BLACK;
+							sibling->left->color = BLACK;
+							rotateRight(node->parent);
+							node = m_root;
+						}
+					}
+				}
+
+				node->color = BLACK;
+			}
+
+			/* Links the red leaf <newNode> into the tree by its key and rebalances; a duplicate
+			* key goes to the right of the existing one
+			*/
+			void link(NodeT* newNode) {
+				// traverse through the tree keeping track of the current and previous nodes
+				NodeT* current = m_root;
+				NodeT* previous = m_nil;
+				while (current != m_nil) {
+					previous = current;
+					if (newNode->key < current->key) {
+						current = current->left;
+					}
+					else {
+						current = current->right;
+					}
+				}
+
+				// insert the new node
+				newNode->parent = previous;
+				if (previous == m_nil) {
+					// tree is empty so make a new root
+					m_root = newNode;
+				}
+				else if (newNode->key < previous->key) {
+					previous->left = newNode;
+				}
+				else {
+					previous->right = newNode;
+				}
+
+				updateToRoot(previous);
+				insertFixup(newNode);
+			}
+
+			/* Takes <node> out of the tree and rebalances; freeing it is up to the caller
+			*/
+			void unlink(NodeT* node) {
+				// <removed> is the node that actually leaves its position in the tree and <child> the
+				// node that moves into that position
+				NodeT* removed = node;
+				Color removedColor = removed->color;
+				NodeT* child;
+
+				if (node->left == m_nil) {
+					// case: there are no children or there is only a right child
+					child = node->right;
+					transplant(node, node->right);
+				}
+				else if (node->right == m_nil) {
+					// case: there is only a left child
+					child = node->left;
+					transplant(node, node->left);
+				}
+				else {
+					// case: there are two children
+					// the successor (minimum of the right subtree) takes the node's place and color
+					removed = minimum(node->right);
+					removedColor = removed->color;
+					child = removed->right;
+
+					if (removed->parent == node) {
+						child->parent = removed;
+					}
+					else {
+						transplant(removed, removed->right);
+						removed->right = node->right;
+						removed->right->parent = removed;
+					}
+
+					transplant(node, removed);
+					removed->left = node->left;
+					removed->left->parent = removed;
+					removed->color = node->color;
+				}
+
+				// the subtrees changed from where <child> moved in up to the root (child->parent is
+				// set even when <child> is the sentinel)
+				updateToRoot(child->parent);
+
+				if (removedColor == BLACK) {
+					deleteFixup(child);
+				}
+			}
+		};
+	}
+
+	template <typename KeyT, typename ValueT>
+	class RBTree : private rb_detail::RBTreeCore<rb_detail::Node<KeyT, ValueT>> {
+	private:
+		class RBTreeKeyNotFoundException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "key not found";
+			}
+		} exception_key_not_found;
+
+		typedef rb_detail::Node<KeyT, ValueT> TreeNode;
+		typedef rb_detail::RBTreeCore<TreeNode> Core;
+		using Core::m_root;
+		using Core::m_nil;
+
+	// methods
+	private:
+		void destruct(TreeNode* node) {
+			if (node == m_nil) return;
+
+			// post order traversal
+			destruct(node->left);
+			destruct(node->right);
+			delete node;
+		}
+
+		std::string toString(const TreeNode* node, const int indent) {
+			if (node == m_nil) return "";
+
+			std::string str;
+			for (int i = 0; i < indent; i++) str += " ";
+			str += std::to_string(node->key) + ", " + std::to_string(node->value);
+			str += node->color == rb_detail::RED ? " (red)\n" : " (black)\n";
+			if (node->left != m_nil) {
+				for (int i = 0; i <= indent; i++) str += " ";
+				str += toString(node->left, indent + 1);
+			}
+			if (node->right != m_nil) {
+				for (int i = 0; i <= indent; i++) str += " ";
+				str += toString(node->right, indent + 1);
+			}
+			return str;
+		}
+
+	public:
+		RBTree() {}
+
+		~RBTree() {
+			destruct(m_root);
+		}
+
+		RBTree(const RBTree&) = delete;
+		RBTree& operator=(const RBTree&) = delete;
+
+		/* Insert a key, value pair; like BST, a duplicate key is inserted to the right of the
+		* existing one
+		*/
+		void insert(const KeyT& key, const ValueT& value) {
+			// make a new node
+			TreeNode* newNode = new TreeNode;
+			newNode->key = key;
+			newNode->value = value;
+			newNode->left = m_nil;
+			newNode->right = m_nil;
+			newNode->color = rb_detail::RED;
+
+			this->link(newNode);
+		}
+
+		/* Return the value corresponding to a given key
+		* Note: throws an error if the key is not found
+		*/
+		ValueT getValue(const KeyT& key) {
+			TreeNode* node = this->find(key);
+
+			if (node == m_nil) {
+				throw exception_key_not_found;
+			}
+
+			return node->value;
+		}
+
+		bool deleteKey(const KeyT& key) {
+			TreeNode* node = this->find(key);
+
+			if (node == m_nil) return false;
+
+			this->unlink(node);
+			delete node;
+			return true;
+		}
+
+		std::string toString() {
+			return toString(m_root, 0);
+		}
+	};
+}
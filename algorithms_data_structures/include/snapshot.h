@@ -0,0 +1,710 @@
+#pragma once
+#include "binary_search_tree.h"
+#include "frozen_bst.h"
+#include "linked_list.h"
+#include "queue.h"
+#include "stack.h"
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// binary snapshots of containers holding trivially copyable elements
+// A snapshot is a 64 byte header followed by the elements as they are in memory: a Stack from
+// the bottom up, a Queue from the front, a LinkedList from the head. A BST is written as its
+// FrozenBST, the keys in Eytzinger order and then the values, each array starting on a cache
+// line, so a read only MappedBST serves lookups straight from the mapped file with the same
+// branchless walk, nothing to parse or rebuild: opening a snapshot of any size is one map
+// call, and only the pages the lookups touch are ever read from disk.
+// SaveSnapshot streams the elements to a temporary file next to the target and renames it
+// over the target once complete, so a crash while saving leaves the previous snapshot intact.
+// The header (magic, format version, byte order, element sizes, count and a checksum of the
+// payload) is written last and carries its own checksum, so truncated, foreign, half written
+// or differently compiled files are refused when opened; verify() also checks the payload.
+// LoadSnapshot copies a snapshot back into a regular container.
+// https://en.wikipedia.org/wiki/Memory-mapped_file
+// https://algorithmica.org/en/eytzinger
+
+namespace alg {
+	class SnapshotException : public std::exception {
+	private:
+		const char* m_message;
+	public:
+		SnapshotException(const char* message) : m_message(message) {}
+
+		virtual const char* what() const throw() {
+			return m_message;
+		}
+	};
+
+	/* The container a snapshot was taken of
+	*/
+	enum class SnapshotKind : uint32_t { Stack = 1, Queue = 2, LinkedList = 3, BST = 4 };
+
+	namespace snapshot_detail {
+		const char MAGIC[8] = { 'A', 'L', 'G', 'S', 'N', 'A', 'P', 0 };
+		const uint32_t VERSION = 1;
+		// reads back as something else on a machine of the other endianness
+		const uint32_t ENDIANNESS_MARK = 0x01020304;
+		const size_t ALIGNMENT = frozen_bst_detail::CACHE_LINE;
+		// elements buffered by SnapshotWriter between writes
+		const size_t WRITE_BUFFER_BYTES = 1 << 16;
+
+		struct Header {
+			char magic[8];
+			uint32_t version;
+			uint32_t kind;
+			uint32_t byteOrder;
+			uint32_t keySize;   // sizeof the elements, or of the keys of a BST
+			uint32_t valueSize; // sizeof the values of a BST, 0 otherwise
+			uint32_t reserved;
+			uint64_t count;
+			uint64_t valuesOffset; // where the values of a BST start, 0 otherwise
+			uint64_t payloadChecksum; // of every byte after the header
+			uint64_t checksum; // of every field above
+		};
+
+		static_assert(sizeof(Header) == 64, "the header is one cache line");
+
+		/* FNV-1a over <size> bytes, continuing from <hash>
+		*/
+		inline uint64_t checksum(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < size; i++) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+
+		inline uint64_t headerChecksum(const Header& header) {
+			return checksum(&header, offsetof(Header, checksum));
+		}
+
+		inline uint64_t alignUp(uint64_t offset) {
+			return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+		}
+
+		/* Bytes of a BST snapshot up to the values: header, then slot 0 and the keys
+		*/
+		inline uint64_t bstValuesOffset(uint64_t count, size_t keySize) {
+			return alignUp(sizeof(Header) + (count + 1) * keySize);
+		}
+
+		/* Bytes a valid snapshot with this header has
+		*/
+		inline uint64_t fileSize(const Header& header) {
+			if (header.kind == (uint32_t)SnapshotKind::BST) {
+				return header.valuesOffset + (header.count + 1) * header.valueSize;
+			}
+			return sizeof(Header) + header.count * header.keySize;
+		}
+
+		/* Whether T can be written as its bytes and used in place from a mapped file
+		*/
+		template <typename T>
+		constexpr bool isSnapshotType() {
+			return std::is_trivially_copyable<T>::value && alignof(T) <= ALIGNMENT;
+		}
+
+		/* Writes a snapshot file: a placeholder header, the payload as it is streamed in, then
+		* the real header; finish() makes it durable and renames it over <path>
+		* Note: a writer destroyed before finish() removes its temporary file
+		*/
+		class FileWriter {
+		private:
+			std::string m_path;
+			std::string m_temporaryPath;
+			std::FILE* m_file;
+			uint64_t m_offset;
+			uint64_t m_checksum;
+
+			void close() {
+				if (m_file == nullptr) return;
+				std::fclose(m_file);
+				m_file = nullptr;
+			}
+
+			void fail(const char* message) {
+				close();
+				std::remove(m_temporaryPath.c_str());
+				throw SnapshotException(message);
+			}
+
+		public:
+			FileWriter(const std::string& path) : m_path(path), m_temporaryPath(path + ".tmp"), m_file(nullptr),
+				m_offset(0), m_checksum(checksum(nullptr, 0)) {
+#if defined(_MSC_VER)
+				if (fopen_s(&m_file, m_temporaryPath.c_str(), "wb") != 0) m_file = nullptr;
+#else
+				m_file = std::fopen(m_temporaryPath.c_str(), "wb");
+#endif
+				if (m_file == nullptr) throw SnapshotException("could not create the snapshot file");
+				std::setvbuf(m_file, nullptr, _IOFBF, 1 << 20);
+
+				Header placeholder;
+				std::memset(&placeholder, 0, sizeof(placeholder));
+				if (std::fwrite(&placeholder, sizeof(placeholder), 1, m_file) != 1) {
+					fail("failed to write the snapshot file");
+				}
+				m_offset = sizeof(Header);
+			}
+
+			~FileWriter() {
+				if (m_file != nullptr) {
+					close();
+					std::remove(m_temporaryPath.c_str());
+				}
+			}
+
+			FileWriter(const FileWriter&) = delete;
+			FileWriter& operator=(const FileWriter&) = delete;
+
+			void write(const void* data, size_t size) {
+				if (size == 0) return;
+				if (std::fwrite(data, 1, size, m_file) != size) fail("failed to write the snapshot file");
+				m_checksum = checksum(data, size, m_checksum);
+				m_offset += size;
+			}
+
+			void writeZeros(size_t size) {
+				static const unsigned char zeros[ALIGNMENT] = {};
+				for (; size > ALIGNMENT; size -= ALIGNMENT) write(zeros, ALIGNMENT);
+				write(zeros, size);
+			}
+
+			/* Zero bytes up to the next cache line
+			*/
+			void pad() {
+				writeZeros((size_t)(alignUp(m_offset) - m_offset));
+			}
+
+			inline uint64_t getOffset() const {
+				return m_offset;
+			}
+
+			/* Writes the header over the placeholder and moves the file to its path
+			*/
+			void finish(SnapshotKind kind, size_t keySize, size_t valueSize, uint64_t count, uint64_t valuesOffset) {
+				Header header;
+				std::memset(&header, 0, sizeof(header));
+				std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+				header.version = VERSION;
+				header.kind = (uint32_t)kind;
+				header.byteOrder = ENDIANNESS_MARK;
+				header.keySize = (uint32_t)keySize;
+				header.valueSize = (uint32_t)valueSize;
+				header.count = count;
+				header.valuesOffset = valuesOffset;
+				header.payloadChecksum = m_checksum;
+				header.checksum = headerChecksum(header);
+
+				if (std::fflush(m_file) != 0 || std::fseek(m_file, 0, SEEK_SET) != 0 ||
+					std::fwrite(&header, sizeof(header), 1, m_file) != 1 || std::fflush(m_file) != 0) {
+					fail("failed to write the snapshot file");
+				}
+				// the data has to be on disk before the rename makes it the snapshot
+#if defined(_WIN32)
+				if (_commit(_fileno(m_file)) != 0) fail("failed to write the snapshot file");
+#else
+				if (fsync(fileno(m_file)) != 0) fail("failed to write the snapshot file");
+#endif
+				if (std::fclose(m_file) != 0) {
+					m_file = nullptr;
+					std::remove(m_temporaryPath.c_str());
+					throw SnapshotException("failed to write the snapshot file");
+				}
+				m_file = nullptr;
+
+#if defined(_WIN32)
+				bool renamed = MoveFileExA(m_temporaryPath.c_str(), m_path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+				bool renamed = std::rename(m_temporaryPath.c_str(), m_path.c_str()) == 0;
+#endif
+				if (!renamed) {
+					std::remove(m_temporaryPath.c_str());
+					throw SnapshotException("could not replace the snapshot file");
+				}
+			}
+		};
+
+		/* A whole file mapped read only
+		*/
+		class MappedFile {
+		private:
+			const unsigned char* m_data;
+			size_t m_size;
+#if defined(_WIN32)
+			HANDLE m_file;
+			HANDLE m_fileMapping;
+#else
+			int m_file;
+#endif
+
+			void unmap() {
+#if defined(_WIN32)
+				if (m_data != nullptr) UnmapViewOfFile(m_data);
+				if (m_fileMapping != nullptr) CloseHandle(m_fileMapping);
+				if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+				m_fileMapping = nullptr;
+				m_file = INVALID_HANDLE_VALUE;
+#else
+				if (m_data != nullptr) munmap(const_cast<unsigned char*>(m_data), m_size);
+				if (m_file >= 0) close(m_file);
+				m_file = -1;
+#endif
+				m_data = nullptr;
+				m_size = 0;
+			}
+
+			void map(const std::string& path) {
+#if defined(_WIN32)
+				m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+					FILE_ATTRIBUTE_NORMAL, nullptr);
+				if (m_file == INVALID_HANDLE_VALUE) throw SnapshotException("could not open the snapshot");
+				LARGE_INTEGER size;
+				if (!GetFileSizeEx(m_file, &size)) throw SnapshotException("could not read the snapshot size");
+				if ((size_t)size.QuadPart < sizeof(Header)) throw SnapshotException("snapshot is truncated");
+				m_fileMapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (m_fileMapping == nullptr) throw SnapshotException("could not map the snapshot");
+				m_data = static_cast<const unsigned char*>(MapViewOfFile(m_fileMapping, FILE_MAP_READ, 0, 0, 0));
+				if (m_data == nullptr) throw SnapshotException("could not map the snapshot");
+				m_size = (size_t)size.QuadPart;
+#else
+				m_file = open(path.c_str(), O_RDONLY);
+				if (m_file < 0) throw SnapshotException("could not open the snapshot");
+				struct stat status;
+				if (fstat(m_file, &status) != 0) throw SnapshotException("could not read the snapshot size");
+				if ((size_t)status.st_size < sizeof(Header)) throw SnapshotException("snapshot is truncated");
+				void* mapping = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_SHARED, m_file, 0);
+				if (mapping == MAP_FAILED) throw SnapshotException("could not map the snapshot");
+				m_data = static_cast<const unsigned char*>(mapping);
+				m_size = (size_t)status.st_size;
+#endif
+			}
+
+		public:
+			MappedFile(const std::string& path) : m_data(nullptr), m_size(0) {
+#if defined(_WIN32)
+				m_file = INVALID_HANDLE_VALUE;
+				m_fileMapping = nullptr;
+#else
+				m_file = -1;
+#endif
+				try {
+					map(path);
+				}
+				catch (...) {
+					unmap();
+					throw;
+				}
+			}
+
+			~MappedFile() {
+				unmap();
+			}
+
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator=(const MappedFile&) = delete;
+
+			MappedFile(MappedFile&& other) noexcept : m_data(other.m_data), m_size(other.m_size), m_file(other.m_file) {
+#if defined(_WIN32)
+				m_fileMapping = other.m_fileMapping;
+				other.m_fileMapping = nullptr;
+				other.m_file = INVALID_HANDLE_VALUE;
+#else
+				other.m_file = -1;
+#endif
+				other.m_data = nullptr;
+				other.m_size = 0;
+			}
+
+			inline const unsigned char* data() const {
+				return m_data;
+			}
+
+			inline size_t size() const {
+				return m_size;
+			}
+
+			/* The header, checked against what the caller expects to find
+			* Note: <kind> 0 accepts any of the sequence kinds
+			*/
+			Header validate(uint32_t kind, size_t keySize, size_t valueSize) const {
+				Header header;
+				std::memcpy(&header, m_data, sizeof(header));
+				if (std::memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0) {
+					throw SnapshotException("not a snapshot");
+				}
+				if (header.checksum != headerChecksum(header)) {
+					throw SnapshotException("snapshot header is corrupt");
+				}
+				if (header.version != VERSION) throw SnapshotException("unsupported snapshot version");
+				if (header.byteOrder != ENDIANNESS_MARK) throw SnapshotException("snapshot has a different byte order");
+				bool isBST = header.kind == (uint32_t)SnapshotKind::BST;
+				bool isSequence = header.kind >= (uint32_t)SnapshotKind::Stack && header.kind <= (uint32_t)SnapshotKind::LinkedList;
+				if (kind == 0 ? !isSequence : header.kind != kind) {
+					throw SnapshotException("snapshot holds a different container");
+				}
+				if (header.keySize != keySize || header.valueSize != valueSize) {
+					throw SnapshotException("snapshot holds a different element type");
+				}
+				if (isBST && header.valuesOffset != bstValuesOffset(header.count, keySize)) {
+					throw SnapshotException("snapshot header is corrupt");
+				}
+				if (header.count > (m_size - sizeof(Header)) / (keySize + valueSize) || m_size < fileSize(header)) {
+					throw SnapshotException("snapshot is truncated");
+				}
+				return header;
+			}
+
+			/* Reads the whole payload and checks it against the checksum in <header>
+			*/
+			bool verify(const Header& header) const {
+				size_t size = (size_t)fileSize(header);
+				return checksum(m_data + sizeof(Header), size - sizeof(Header)) == header.payloadChecksum;
+			}
+		};
+	}
+
+	/* Streams elements into a Stack, Queue or LinkedList snapshot without the container,
+	* e.g. to write one from another source
+	* Note: the snapshot only replaces <path> on finish(); one destroyed before leaves the
+	* previous file as it was
+	*/
+	template <typename T>
+	class SnapshotWriter {
+	private:
+		static_assert(snapshot_detail::isSnapshotType<T>(), "snapshots hold trivially copyable types only");
+
+		snapshot_detail::FileWriter m_file;
+		SnapshotKind m_kind;
+		std::vector<T> m_buffer;
+		uint64_t m_count;
+		bool m_finished;
+
+		void flushBuffer() {
+			m_file.write(m_buffer.data(), m_buffer.size() * sizeof(T));
+			m_buffer.clear();
+		}
+
+	public:
+		SnapshotWriter(const std::string& path, SnapshotKind kind) : m_file(path), m_kind(kind), m_count(0),
+			m_finished(false) {
+			if (kind == SnapshotKind::BST) throw SnapshotException("a BST snapshot is written by SaveSnapshot");
+			m_buffer.reserve(snapshot_detail::WRITE_BUFFER_BYTES / sizeof(T) + 1);
+		}
+
+		inline void append(const T& element) {
+			m_buffer.push_back(element);
+			m_count++;
+			if (m_buffer.size() == m_buffer.capacity()) flushBuffer();
+		}
+
+		void append(const T elements[], size_t count) {
+			flushBuffer();
+			m_file.write(elements, count * sizeof(T));
+			m_count += count;
+		}
+
+		inline uint64_t getCount() const {
+			return m_count;
+		}
+
+		/* Completes the snapshot and moves it to its path
+		*/
+		void finish() {
+			if (m_finished) return;
+			flushBuffer();
+			m_file.finish(m_kind, sizeof(T), 0, m_count, 0);
+			m_finished = true;
+		}
+	};
+
+	/* A Stack, Queue or LinkedList snapshot mapped read only; the elements are read straight
+	* from the mapped pages
+	*/
+	template <typename T>
+	class MappedSnapshot {
+	private:
+		class IndexOutOfBoundsException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "index out of bounds";
+			}
+		} exception_ioob;
+
+		static_assert(snapshot_detail::isSnapshotType<T>(), "snapshots hold trivially copyable types only");
+
+		snapshot_detail::MappedFile m_file;
+		snapshot_detail::Header m_header;
+		const T* m_elements;
+
+	public:
+		/* Maps the snapshot at <path> and checks its header
+		* Note: throws a SnapshotException if the file is not a snapshot of T elements
+		*/
+		explicit MappedSnapshot(const std::string& path) : m_file(path),
+			m_header(m_file.validate(0, sizeof(T), 0)),
+			m_elements(reinterpret_cast<const T*>(m_file.data() + sizeof(snapshot_detail::Header))) {}
+
+		inline SnapshotKind getKind() const {
+			return (SnapshotKind)m_header.kind;
+		}
+
+		inline size_t getSize() const {
+			return (size_t)m_header.count;
+		}
+
+		/* Return the element at <index>: from the bottom of a Stack, the front of a Queue or
+		* the head of a LinkedList
+		*/
+		inline const T& operator [] (size_t index) const {
+			if (index >= getSize()) throw exception_ioob;
+			return m_elements[index];
+		}
+
+		inline const T* begin() const {
+			return m_elements;
+		}
+
+		inline const T* end() const {
+			return m_elements + getSize();
+		}
+
+		/* Reads every element and checks them against the checksum in the header
+		*/
+		bool verify() const {
+			return m_file.verify(m_header);
+		}
+	};
+
+	/* A BST snapshot mapped read only: a FrozenBST whose arrays are the mapped file
+	* Note: opening is O(1) regardless of size; each lookup reads only the pages on its path,
+	* so the first lookups wait for the disk and later ones run at FrozenBST speed
+	*/
+	template <typename KeyT, typename ValueT>
+	class MappedBST {
+	private:
+		class KeyNotFoundException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "key not found";
+			}
+		} exception_key_not_found;
+
+		static_assert(snapshot_detail::isSnapshotType<KeyT>() && snapshot_detail::isSnapshotType<ValueT>(),
+			"snapshots hold trivially copyable types only");
+
+		snapshot_detail::MappedFile m_file;
+		snapshot_detail::Header m_header;
+		const KeyT* m_keys; // [1, m_size] in Eytzinger order, slot 0 unused
+		const ValueT* m_values;
+		size_t m_size;
+
+	public:
+		/* Maps the snapshot at <path> and checks its header
+		* Note: throws a SnapshotException if the file is not a BST snapshot of these types
+		*/
+		explicit MappedBST(const std::string& path) : m_file(path),
+			m_header(m_file.validate((uint32_t)SnapshotKind::BST, sizeof(KeyT), sizeof(ValueT))),
+			m_keys(reinterpret_cast<const KeyT*>(m_file.data() + sizeof(snapshot_detail::Header))),
+			m_values(reinterpret_cast<const ValueT*>(m_file.data() + m_header.valuesOffset)),
+			m_size((size_t)m_header.count) {}
+
+		/* Looks up <key>
+		* @return true and sets <value> if the key is in the snapshot
+		*/
+		inline bool find(const KeyT& key, ValueT& value) const {
+			size_t k = frozen_bst_detail::lowerBound(m_keys, m_size, key);
+			if (k == 0 || key < m_keys[k]) return false;
+			value = m_values[k];
+			return true;
+		}
+
+		/* Looks up <count> keys at once, see FrozenBST::findMany
+		*/
+		size_t findMany(const KeyT keys[], size_t count, ValueT values[], bool found[]) const {
+			return frozen_bst_detail::findMany(m_keys, m_values, m_size, keys, count, values, found);
+		}
+
+		inline bool contains(const KeyT& key) const {
+			size_t k = frozen_bst_detail::lowerBound(m_keys, m_size, key);
+			return k != 0 && !(key < m_keys[k]);
+		}
+
+		/* Return the value corresponding to a given key
+		* Note: throws an error if the key is not found
+		*/
+		ValueT getValue(const KeyT& key) const {
+			size_t k = frozen_bst_detail::lowerBound(m_keys, m_size, key);
+			if (k == 0 || key < m_keys[k]) throw exception_key_not_found;
+			return m_values[k];
+		}
+
+		/* Calls callback(key, value) for every key in ascending order
+		*/
+		template <typename F>
+		void forEach(F callback) const {
+			for (size_t k = frozen_bst_detail::first(m_size), left = m_size; left > 0;
+				k = frozen_bst_detail::next(k, m_size), left--) {
+				callback(m_keys[k], m_values[k]);
+			}
+		}
+
+		inline size_t getSize() const {
+			return m_size;
+		}
+
+		inline bool isEmpty() const {
+			return m_size == 0;
+		}
+
+		/* Reads the whole file and checks it against the checksum in the header
+		*/
+		bool verify() const {
+			return m_file.verify(m_header);
+		}
+	};
+
+	/* Writes <stack> to <path>, bottom element first
+	*/
+	template <typename T, int N>
+	void SaveSnapshot(const Stack<T, N>& stack, const std::string& path) {
+		SnapshotWriter<T> writer(path, SnapshotKind::Stack);
+		for (int i = stack.getSize() - 1; i >= 0; i--) writer.append(stack[i]);
+		writer.finish();
+	}
+
+	/* Writes <queue> to <path>, front element first
+	*/
+	template <typename T, bool PowerOfTwo>
+	void SaveSnapshot(const Queue<T, PowerOfTwo>& queue, const std::string& path) {
+		SnapshotWriter<T> writer(path, SnapshotKind::Queue);
+		for (int i = 0; i < queue.getSize(); i++) writer.append(queue[i]);
+		writer.finish();
+	}
+
+	/* Writes <list> to <path>, head first
+	*/
+	template <typename T, typename Allocator>
+	void SaveSnapshot(const LinkedList<T, Allocator>& list, const std::string& path) {
+		SnapshotWriter<T> writer(path, SnapshotKind::LinkedList);
+		list.forEach([&writer](const T& element) { writer.append(element); });
+		writer.finish();
+	}
+
+	/* Writes <index> to <path> in its Eytzinger layout, to be opened with MappedBST
+	*/
+	template <typename KeyT, typename ValueT>
+	void SaveSnapshot(const FrozenBST<KeyT, ValueT>& index, const std::string& path) {
+		static_assert(snapshot_detail::isSnapshotType<KeyT>() && snapshot_detail::isSnapshotType<ValueT>(),
+			"snapshots hold trivially copyable types only");
+
+		size_t size = index.getSize();
+		snapshot_detail::FileWriter file(path);
+		// slot 0 is written as zeros, so the arrays keep the layout of the FrozenBST
+		file.writeZeros(sizeof(KeyT));
+		if (size > 0) file.write(index.getKeys() + 1, size * sizeof(KeyT));
+		file.pad();
+		uint64_t valuesOffset = file.getOffset();
+		file.writeZeros(sizeof(ValueT));
+		if (size > 0) file.write(index.getValues() + 1, size * sizeof(ValueT));
+		file.finish(SnapshotKind::BST, sizeof(KeyT), sizeof(ValueT), size, valuesOffset);
+	}
+
+	/* Writes <tree> to <path>, to be opened with MappedBST or loaded back with LoadSnapshot
+	* Note: goes through freeze(), so it needs the memory of a FrozenBST while writing
+	*/
+	template <typename KeyT, typename ValueT, typename Allocator>
+	void SaveSnapshot(const BST<KeyT, ValueT, Allocator>& tree, const std::string& path) {
+		SaveSnapshot(tree.freeze(), path);
+	}
+
+	/* Pushes the elements of the Stack snapshot at <path> onto <stack>, bottom first, so an
+	* empty stack ends up as the one that was saved
+	* Note: throws a SnapshotException before pushing anything if a fixed capacity stack is
+	* too small
+	*/
+	template <typename T, int N>
+	void LoadSnapshot(const std::string& path, Stack<T, N>& stack) {
+		MappedSnapshot<T> snapshot(path);
+		if (snapshot.getKind() != SnapshotKind::Stack) throw SnapshotException("snapshot holds a different container");
+		if (snapshot.getSize() > (size_t)(INT_MAX - stack.getSize())) throw SnapshotException("snapshot is too large");
+		if ((int)snapshot.getSize() > stack.getCapacity() - stack.getSize()) {
+			throw SnapshotException("stack is too small for the snapshot");
+		}
+		for (const T& element : snapshot) stack.push(element);
+	}
+
+	template <typename T>
+	void LoadSnapshot(const std::string& path, Stack<T>& stack) {
+		MappedSnapshot<T> snapshot(path);
+		if (snapshot.getKind() != SnapshotKind::Stack) throw SnapshotException("snapshot holds a different container");
+		if (snapshot.getSize() > (size_t)(INT_MAX - stack.getSize())) throw SnapshotException("snapshot is too large");
+		stack.reserve(stack.getSize() + (int)snapshot.getSize());
+		for (const T& element : snapshot) stack.push(element);
+	}
+
+	/* Enqueues the elements of the Queue snapshot at <path> into <queue>, front first
+	* Note: throws a SnapshotException before enqueueing anything if the queue is too small
+	*/
+	template <typename T, bool PowerOfTwo>
+	void LoadSnapshot(const std::string& path, Queue<T, PowerOfTwo>& queue) {
+		MappedSnapshot<T> snapshot(path);
+		if (snapshot.getKind() != SnapshotKind::Queue) throw SnapshotException("snapshot holds a different container");
+		if (snapshot.getSize() > (size_t)(queue.getCapacity() - queue.getSize())) {
+			throw SnapshotException("queue is too small for the snapshot");
+		}
+		queue.enqueue_bulk(snapshot.begin(), (int)snapshot.getSize());
+	}
+
+	/* Appends the elements of the LinkedList snapshot at <path> to <list>, head first
+	*/
+	template <typename T, typename Allocator>
+	void LoadSnapshot(const std::string& path, LinkedList<T, Allocator>& list) {
+		MappedSnapshot<T> snapshot(path);
+		if (snapshot.getKind() != SnapshotKind::LinkedList) throw SnapshotException("snapshot holds a different container");
+		for (const T& element : snapshot) list.pushLast(element);
+	}
+
+	/* Replaces the contents of <tree> with the BST snapshot at <path>, perfectly balanced
+	* Note: O(n) through bulkLoad; to only look keys up, MappedBST needs no loading at all
+	*/
+	template <typename KeyT, typename ValueT, typename Allocator>
+	void LoadSnapshot(const std::string& path, BST<KeyT, ValueT, Allocator>& tree) {
+		MappedBST<KeyT, ValueT> snapshot(path);
+		if (snapshot.getSize() > (size_t)INT_MAX) throw SnapshotException("snapshot is too large");
+		std::vector<KeyT> keys;
+		std::vector<ValueT> values;
+		keys.reserve(snapshot.getSize());
+		values.reserve(snapshot.getSize());
+		snapshot.forEach([&keys, &values](const KeyT& key, const ValueT& value) {
+			keys.push_back(key);
+			values.push_back(value);
+		});
+		tree.bulkLoad(keys.data(), values.data(), (int)keys.size());
+	}
+}
@@ -0,0 +1,520 @@
+#pragma once
+#include "instrumentation.h"
+#include "radix_sort.h"
+#include "sorting_network.h"
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+// general purpose sorting engine
+// Sort is a pattern-defeating quicksort (pdqsort): quicksort with an insertion sort cutoff
+// for small partitions and a heapsort fallback once too many bad pivots have been chosen,
+// so the worst case stays O(n log n)
+// https://arxiv.org/abs/2106.05123
+// https://github.com/orlp/pdqsort
+// StableSort is a top-down merge sort with an insertion sort cutoff
+// Sorting plain integer/float/double arrays without a comparator skips comparisons entirely:
+// small blocks go through a sorting network and large arrays through LSD radix sort
+
+namespace alg {
+	namespace sort_detail {
+		// partitions smaller than this are insertion sorted
+		const int INSERTION_SORT_THRESHOLD = 24;
+		// partitions larger than this use Tukey's ninther as the pivot
+		const int NINTHER_THRESHOLD = 128;
+		// number of moves partialInsertionSort may do before giving up
+		const int PARTIAL_INSERTION_SORT_LIMIT = 8;
+		// runs smaller than this are insertion sorted by StableSort
+		const int MERGE_SORT_THRESHOLD = 32;
+		// arithmetic arrays at least this large are radix sorted
+		const int RADIX_SORT_THRESHOLD = 128;
+
+		/* Sorts [begin, end) with insertion sort
+		* Note: stable as long as comp is a strict weak ordering
+		*/
+		template <typename Iter, typename Compare>
+		inline void insertionSort(Iter begin, Iter end, Compare comp) {
+			typedef typename std::iterator_traits<Iter>::value_type T;
+			if (begin == end) return;
+
+			for (Iter current = begin + 1; current != end; ++current) {
+				Iter sift = current;
+				Iter siftPrevious = current - 1;
+
+				// only move the element if it is out of place
+				if (comp(*sift, *siftPrevious)) {
+					T temp = std::move(*sift);
+					do {
+						*sift-- = std::move(*siftPrevious);
+					} while (sift != begin && comp(temp, *--siftPrevious));
+					*sift = std::move(temp);
+				}
+			}
+		}
+
+		/* Sorts [begin, end) with insertion sort
+		* Note: assumes *(begin - 1) is not greater than any element of the range so that
+		* the inner loop does not have to check for the start of the range
+		*/
+		template <typename Iter, typename Compare>
+		inline void unguardedInsertionSort(Iter begin, Iter end, Compare comp) {
+			typedef typename std::iterator_traits<Iter>::value_type T;
+			if (begin == end) return;
+
+			for (Iter current = begin + 1; current != end; ++current) {
+				Iter sift = current;
+				Iter siftPrevious = current - 1;
+
+				if (comp(*sift, *siftPrevious)) {
+					T temp = std::move(*sift);
+					do {
+						*sift-- = std::move(*siftPrevious);
+					} while (comp(temp, *--siftPrevious));
+					*sift = std::move(temp);
+				}
+			}
+		}
+
+		/* Attempts to insertion sort [begin, end)
+		* @return false if more than PARTIAL_INSERTION_SORT_LIMIT elements had to be moved,
+		* in which case the range is left partially sorted
+		*/
+		template <typename Iter, typename Compare>
+		inline bool partialInsertionSort(Iter begin, Iter end, Compare comp) {
+			typedef typename std::iterator_traits<Iter>::value_type T;
+			if (begin == end) return true;
+
+			int moved = 0;
+			for (Iter current = begin + 1; current != end; ++current) {
+				Iter sift = current;
+				Iter siftPrevious = current - 1;
+
+				if (comp(*sift, *siftPrevious)) {
+					T temp = std::move(*sift);
+					do {
+						*sift-- = std::move(*siftPrevious);
+					} while (sift != begin && comp(temp, *--siftPrevious));
+					*sift = std::move(temp);
+					moved += (int)(current - sift);
+				}
+
+				if (moved > PARTIAL_INSERTION_SORT_LIMIT) return false;
+			}
+
+			return true;
+		}
+
+		template <typename Iter, typename Compare>
+		inline void swapElements(Iter a, Iter b, Compare&) {
+			std::iter_swap(a, b);
+		}
+
+		template <typename Iter, typename Compare>
+		inline void swapElements(Iter a, Iter b, instrumentation_detail::CountingCompare<Compare>& comp) {
+			++*comp.swaps;
+			std::iter_swap(a, b);
+		}
+
+		template <typename Iter, typename Compare>
+		inline void sort2(Iter a, Iter b, Compare comp) {
+			if (comp(*b, *a)) swapElements(a, b, comp);
+		}
+
+		template <typename Iter, typename Compare>
+		inline void sort3(Iter a, Iter b, Iter c, Compare comp) {
+			sort2(a, b, comp);
+			sort2(b, c, comp);
+			sort2(a, b, comp);
+		}
+
+		template <typename Iter, typename Compare>
+		inline void siftDown(Iter begin, std::ptrdiff_t root, std::ptrdiff_t size, Compare comp) {
+			typedef typename std::iterator_traits<Iter>::value_type T;
+			T temp = std::move(begin[root]);
+
+			std::ptrdiff_t child = 2 * root + 1;
+			while (child < size) {
+				// pick the larger child
+				if (child + 1 < size && comp(begin[child], begin[child + 1])) child++;
+				if (!comp(temp, begin[child])) break;
+
+				begin[root] = std::move(begin[child]);
+				root = child;
+				child = 2 * root + 1;
+			}
+			begin[root] = std::move(temp);
+		}
+
+		/* Sorts [begin, end) with heapsort; used when quicksort keeps picking bad pivots
+		*/
+		template <typename Iter, typename Compare>
+		inline void heapSort(Iter begin, Iter end, Compare comp) {
+			std::ptrdiff_t size = end - begin;
+
+			// build a max heap
+			for (std::ptrdiff_t i = size / 2 - 1; i >= 0; i--) {
+				siftDown(begin, i, size, comp);
+			}
+
+			// repeatedly move the maximum to the end of the range
+			for (std::ptrdiff_t i = size - 1; i > 0; i--) {
+				swapElements(begin, begin + i, comp);
+				siftDown(begin, 0, i, comp);
+			}
+		}
+
+		/* Partitions [begin, end) around the pivot *begin. Elements equal to the pivot go to
+		* the right partition.
+		* @return a pair containing the final position of the pivot and whether the range was
+		* already partitioned
+		*/
+		template <typename Iter, typename Compare>
+		inline std::pair<Iter, bool> partitionRight(Iter begin, Iter end, Compare comp) {
+			typedef typename std::iterator_traits<Iter>::value_type T;
+			T pivot(std::move(*begin));
+
+			Iter first = begin;
+			Iter last = end;
+
+			// find the first element greater than or equal to the pivot
+			// (the median of 3 pivot selection guarantees this exists)
+			while (comp(*++first, pivot));
+
+			// find the first element strictly smaller than the pivot; we need a bounds
+			// check only if no element was moved by the previous loop
+			if (first - 1 == begin) {
+				while (first < last && !comp(*--last, pivot));
+			}
+			else {
+				while (!comp(*--last, pivot));
+			}
+
+			// if the first pair of elements that should be swapped to partition are the same
+			// element, the range was already correctly partitioned
+			bool alreadyPartitioned = first >= last;
+
+			while (first < last) {
+				swapElements(first, last, comp);
+				while (comp(*++first, pivot));
+				while (!comp(*--last, pivot));
+			}
+
+			// put the pivot in the right place
+			Iter pivotPosition = first - 1;
+			*begin = std::move(*pivotPosition);
+			*pivotPosition = std::move(pivot);
+
+			return std::make_pair(pivotPosition, alreadyPartitioned);
+		}
+
+		/* Partitions [begin, end) around the pivot *begin. Elements equal to the pivot go to
+		* the left partition. Used when many elements are equal to the pivot since the whole
+		* left partition is then done and never needs to be recursed into.
+		* @return the final position of the pivot
+		*/
+		template <typename Iter, typename Compare>
+		inline Iter partitionLeft(Iter begin, Iter end, Compare comp) {
+			typedef typename std::iterator_traits<Iter>::value_type T;
+			T pivot(std::move(*begin));
+
+			Iter first = begin;
+			Iter last = end;
+
+			while (comp(pivot, *--last));
+
+			if (last + 1 == end) {
+				while (first < last && !comp(pivot, *++first));
+			}
+			else {
+				while (!comp(pivot, *++first));
+			}
+
+			while (first < last) {
+				swapElements(first, last, comp);
+				while (comp(pivot, *--last));
+				while (!comp(pivot, *++first));
+			}
+
+			Iter pivotPosition = last;
+			*begin = std::move(*pivotPosition);
+			*pivotPosition = std::move(pivot);
+
+			return pivotPosition;
+		}
+
+		/* Main pdqsort loop
+		* @param badAllowed the number of highly unbalanced partitions allowed before falling
+		* back to heapsort
+		* @param leftmost whether [begin, end) is the leftmost partition; if it is not, the
+		* element before begin is a lower bound for the range
+		*/
+		template <typename Iter, typename Compare>
+		void pdqsortLoop(Iter begin, Iter end, Compare comp, int badAllowed, bool leftmost) {
+			typedef typename std::iterator_traits<Iter>::difference_type diff_t;
+
+			// use a while loop for tail recursion elimination
+			while (true) {
+				diff_t size = end - begin;
+
+				if (size < INSERTION_SORT_THRESHOLD) {
+					if (leftmost) insertionSort(begin, end, comp);
+					else unguardedInsertionSort(begin, end, comp);
+					return;
+				}
+
+				// choose the pivot as the median of 3 or the pseudomedian of 9 and move it to begin
+				diff_t half = size / 2;
+				if (size > NINTHER_THRESHOLD) {
+					sort3(begin, begin + half, end - 1, comp);
+					sort3(begin + 1, begin + (half - 1), end - 2, comp);
+					sort3(begin + 2, begin + (half + 1), end - 3, comp);
+					sort3(begin + (half - 1), begin + half, begin + (half + 1), comp);
+					swapElements(begin, begin + half, comp);
+				}
+				else {
+					sort3(begin + half, begin, end - 1, comp);
+				}
+
+				// if the element before this partition is equal to the pivot, every element of
+				// the partition is at least the pivot, so put all equal elements to the left
+				// and only continue with the greater ones
+				if (!leftmost && !comp(*(begin - 1), *begin)) {
+					begin = partitionLeft(begin, end, comp) + 1;
+					continue;
+				}
+
+				std::pair<Iter, bool> partitionResult = partitionRight(begin, end, comp);
+				Iter pivotPosition = partitionResult.first;
+				bool alreadyPartitioned = partitionResult.second;
+
+				diff_t leftSize = pivotPosition - begin;
+				diff_t rightSize = end - (pivotPosition + 1);
+				bool highlyUnbalanced = leftSize < size / 8 || rightSize < size / 8;
+
+				if (highlyUnbalanced) {
+					// too many bad pivots: switch to heapsort to guarantee O(n log n)
+					if (--badAllowed == 0) {
+						heapSort(begin, end, comp);
+						return;
+					}
+
+					// break up patterns that may be causing the bad partitions
+					if (leftSize >= INSERTION_SORT_THRESHOLD) {
+						swapElements(begin, begin + leftSize / 4, comp);
+						swapElements(pivotPosition - 1, pivotPosition - leftSize / 4, comp);
+
+						if (leftSize > NINTHER_THRESHOLD) {
+							swapElements(begin + 1, begin + (leftSize / 4 + 1), comp);
+							swapElements(begin + 2, begin + (leftSize / 4 + 2), comp);
+							swapElements(pivotPosition - 2, pivotPosition - (leftSize / 4 + 1), comp);
+							swapElements(pivotPosition - 3, pivotPosition - (leftSize / 4 + 2), comp);
+						}
+					}
+
+					if (rightSize >= INSERTION_SORT_THRESHOLD) {
+						swapElements(pivotPosition + 1, pivotPosition + (1 + rightSize / 4), comp);
+						swapElements(end - 1, end - rightSize / 4, comp);
+
+						if (rightSize > NINTHER_THRESHOLD) {
+							swapElements(pivotPosition + 2, pivotPosition + (2 + rightSize / 4), comp);
+							swapElements(pivotPosition + 3, pivotPosition + (3 + rightSize / 4), comp);
+							swapElements(end - 2, end - (1 + rightSize / 4), comp);
+							swapElements(end - 3, end - (2 + rightSize / 4), comp);
+						}
+					}
+				}
+				else if (alreadyPartitioned
+					&& partialInsertionSort(begin, pivotPosition, comp)
+					&& partialInsertionSort(pivotPosition + 1, end, comp)) {
+					// the partition was decent and both halves were (nearly) sorted already
+					return;
+				}
+
+				// recurse into the left partition and loop on the right one
+				pdqsortLoop(begin, pivotPosition, comp, badAllowed, leftmost);
+				begin = pivotPosition + 1;
+				leftmost = false;
+			}
+		}
+
+		/* Merge sorts [begin, end) using buffer as scratch space for the left half
+		*/
+		template <typename Iter, typename Compare, typename T>
+		void mergeSortLoop(Iter begin, Iter end, Compare comp, std::vector<T>& buffer) {
+			if (end - begin <= MERGE_SORT_THRESHOLD) {
+				insertionSort(begin, end, comp);
+				return;
+			}
+
+			Iter middle = begin + (end - begin) / 2;
+			mergeSortLoop(begin, middle, comp, buffer);
+			mergeSortLoop(middle, end, comp, buffer);
+
+			// the halves are already in order so there is nothing to merge
+			if (!comp(*middle, *(middle - 1))) return;
+
+			buffer.assign(std::make_move_iterator(begin), std::make_move_iterator(middle));
+
+			typename std::vector<T>::iterator left = buffer.begin();
+			Iter right = middle;
+			Iter out = begin;
+			while (left != buffer.end() && right != end) {
+				// take from the left half on ties to keep the sort stable
+				if (comp(*right, *left)) {
+					*out++ = std::move(*right++);
+				}
+				else {
+					*out++ = std::move(*left++);
+				}
+			}
+
+			// whatever is left of the right half is already in place
+			std::move(left, buffer.end(), out);
+		}
+
+		template <typename T>
+		inline int log2(T n) {
+			int log = 0;
+			while (n >>= 1) log++;
+			return log;
+		}
+
+		/* Whether Sort(first, last) without a comparator can take the arithmetic path,
+		* i.e. the range is a raw array of integers, floats or doubles
+		*/
+		template <typename RandomIt>
+		struct UsesArithmeticSort : std::false_type {};
+
+		template <typename T>
+		struct UsesArithmeticSort<T*> : radix_detail::IsRadixSortable<T> {};
+
+		/* Sorts [first, last) with pdqsort, counting comparisons and swaps when instrumented
+		*/
+		template <typename Iter, typename Compare>
+		inline void pdqsort(Iter first, Iter last, Compare comp) {
+#if ALG_INSTRUMENTATION
+			instrumentation_detail::SortCounts counts;
+			pdqsortLoop(first, last, counts.wrap(comp), log2(last - first), true);
+#else
+			pdqsortLoop(first, last, comp, log2(last - first), true);
+#endif
+		}
+
+		template <typename Iter, typename Compare, typename T>
+		inline void mergeSort(Iter first, Iter last, Compare comp, std::vector<T>& buffer) {
+#if ALG_INSTRUMENTATION
+			instrumentation_detail::SortCounts counts;
+			mergeSortLoop(first, last, counts.wrap(comp), buffer);
+#else
+			mergeSortLoop(first, last, comp, buffer);
+#endif
+		}
+
+		template <typename RandomIt>
+		inline void sortDefault(RandomIt first, RandomIt last, std::false_type) {
+			if (last - first < 2) return;
+			pdqsort(first, last, std::less<typename std::iterator_traits<RandomIt>::value_type>());
+		}
+
+		template <typename T>
+		inline void sortDefault(T* first, T* last, std::true_type) {
+			std::ptrdiff_t size = last - first;
+			if (size < 2) return;
+
+			if (size <= network_detail::MAX_NETWORK_SIZE) {
+				SortingNetwork(first, (int)size);
+			}
+			else if (size >= RADIX_SORT_THRESHOLD) {
+				RadixSort(first, last);
+			}
+			else {
+				pdqsort(first, last, std::less<T>());
+			}
+		}
+	}
+
+	/* Sort the range [first, last) with pattern-defeating quicksort
+	@param first iterator to the first element to be sorted
+	@param last iterator past the last element to be sorted
+	@param comp the comparator; comp(a, b) returns true if a should come before b
+
+	Notes: not stable; O(n log n) worst case, O(n) for sorted or reverse sorted input
+	*/
+	template <typename RandomIt, typename Compare>
+	static void Sort(RandomIt first, RandomIt last, Compare comp) {
+		if (last - first < 2) return;
+		sort_detail::pdqsort(first, last, comp);
+	}
+
+	/* Sort the range [first, last) in ascending order
+	Notes: raw arrays of integers, floats or doubles are sorted with a sorting network or
+	radix sort instead of comparisons
+	*/
+	template <typename RandomIt>
+	static void Sort(RandomIt first, RandomIt last) {
+		sort_detail::sortDefault(first, last, typename sort_detail::UsesArithmeticSort<RandomIt>::type());
+	}
+
+	/* Sort array <arr> starting from <start> until <end> with pattern-defeating quicksort
+	@param arr the array to be sorted
+	@param start the starting index of the subarray to be sorted
+	@param end the ending index of the subarray to be sorted (inclusive, same as BubbleSort)
+	@param comp the comparator; comp(a, b) returns true if a should come before b
+
+	Notes: mutates arr; not stable
+	*/
+	template <typename T, typename Compare>
+	static void Sort(T arr[], int start, int end, Compare comp) {
+		if (end <= start) return;
+		Sort(arr + start, arr + end + 1, comp);
+	}
+
+	template <typename T>
+	static void Sort(T arr[], int start, int end) {
+		if (end <= start) return;
+		Sort(arr + start, arr + end + 1);
+	}
+
+	/* Sort the range [first, last) with merge sort, keeping equal elements in their
+	original order
+	@param first iterator to the first element to be sorted
+	@param last iterator past the last element to be sorted
+	@param comp the comparator; comp(a, b) returns true if a should come before b
+
+	Notes: allocates a buffer of half the range
+	*/
+	template <typename RandomIt, typename Compare>
+	static void StableSort(RandomIt first, RandomIt last, Compare comp) {
+		typedef typename std::iterator_traits<RandomIt>::value_type T;
+		if (last - first < 2) return;
+
+		std::vector<T> buffer;
+		buffer.reserve((last - first) / 2 + 1);
+		sort_detail::mergeSort(first, last, comp, buffer);
+	}
+
+	template <typename RandomIt>
+	static void StableSort(RandomIt first, RandomIt last) {
+		StableSort(first, last, std::less<typename std::iterator_traits<RandomIt>::value_type>());
+	}
+
+	/* Stable sort array <arr> starting from <start> until <end>
+	@param arr the array to be sorted
+	@param start the starting index of the subarray to be sorted
+	@param end the ending index of the subarray to be sorted (inclusive, same as BubbleSort)
+	@param comp the comparator; comp(a, b) returns true if a should come before b
+
+	Notes: mutates arr
+	*/
+	template <typename T, typename Compare>
+	static void StableSort(T arr[], int start, int end, Compare comp) {
+		if (end <= start) return;
+		StableSort(arr + start, arr + end + 1, comp);
+	}
+
+	template <typename T>
+	static void StableSort(T arr[], int start, int end) {
+		StableSort(arr, start, end, std::less<T>());
+	}
+}
@@ -0,0 +1,406 @@
+#pragma once
+#include "cpu_features.h"
+#include <cstdint>
+#include <exception>
+#include <limits>
+
+// bitonic sorting networks for small blocks of up to 64 elements
+// https://en.wikipedia.org/wiki/Bitonic_sorter
+//
+// The SIMD kernels keep a W x W block (W = number of lanes) in W registers. Compare-exchanges
+// between logical indices that differ in a low bit are done between registers; to do the
+// ones that differ in a high bit, the block is transposed so those become register pairs too.
+// AVX2 sorts up to 64 int/float or 16 double, SSE2 sorts up to 16 int/float, and anything
+// else goes through the scalar network.
+
+#if defined(_MSC_VER)
+#define ALG_TARGET_SSE2
+#else
+#define ALG_TARGET_SSE2 __attribute__((target("sse2")))
+#endif
+
+// passing vectors by value between the force inlined kernel and its helpers is fine here
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace alg {
+	class SortingNetworkSizeException : public std::exception {
+	public:
+		virtual const char* what() const throw() {
+			return "sorting network size out of bounds";
+		}
+	};
+
+	namespace network_detail {
+		// the largest block any of the networks sort
+		const int MAX_NETWORK_SIZE = 64;
+
+		template <typename T>
+		inline void compareExchange(T& a, T& b) {
+			// written with selects so the compiler can make it branchless
+			T low = b < a ? b : a;
+			T high = b < a ? a : b;
+			a = low;
+			b = high;
+		}
+
+		/* Sorts <size> (a power of two) elements with a scalar bitonic network
+		*/
+		template <typename T>
+		inline void scalarBitonic(T* arr, int size) {
+			for (int k = 2; k <= size; k <<= 1) {
+				for (int j = k >> 1; j > 0; j >>= 1) {
+					for (int i = 0; i < size; i++) {
+						int other = i ^ j;
+						if (other > i) {
+							if ((i & k) == 0) {
+								compareExchange(arr[i], arr[other]);
+							}
+							else {
+								compareExchange(arr[other], arr[i]);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		template <typename T>
+		inline T paddingValue() {
+			return std::numeric_limits<T>::has_infinity
+				? std::numeric_limits<T>::infinity()
+				: std::numeric_limits<T>::max();
+		}
+
+		/* Bitonic sort of up to W * W elements held in W SIMD registers
+		* V provides the vector type, lane count and the handful of operations the network needs.
+		* Force inlined so the intrinsics end up in the target specific entry points below.
+		*/
+		template <typename V>
+		ALG_FORCE_INLINE void simdBitonic(typename V::Scalar* arr, int size) {
+			typedef typename V::Scalar T;
+			typedef typename V::Vector Vector;
+			const int W = V::LANES;
+			const int M = W * W;
+			const int LOG_W = W == 8 ? 3 : (W == 4 ? 2 : 1);
+
+			// pad the block with the largest value so the padding ends up at the end
+			T block[M];
+			for (int i = 0; i < size; i++) block[i] = arr[i];
+			for (int i = size; i < M; i++) block[i] = paddingValue<T>();
+
+			Vector reg[W];
+			for (int r = 0; r < W; r++) reg[r] = V::load(block + r * W);
+
+			// in layout A register r, lane c holds logical index r | (c << LOG_W);
+			// in layout B (after a transpose) it holds (r << LOG_W) | c
+			bool layoutA = true;
+
+			for (int k = 2; k <= M; k <<= 1) {
+				for (int j = k >> 1; j > 0; j >>= 1) {
+					if (j < W) {
+						if (!layoutA) {
+							V::transpose(reg);
+							layoutA = true;
+						}
+
+						// the direction bit k is a register bit, a lane bit or beyond the block
+						Vector laneMask = V::laneMask(k < M ? (k >> LOG_W) : 0);
+						for (int r = 0; r < W; r++) {
+							if (r & j) continue;
+							Vector low = V::min(reg[r], reg[r ^ j]);
+							Vector high = V::max(reg[r], reg[r ^ j]);
+							if (k < W) {
+								bool descending = (r & k) != 0;
+								reg[r] = descending ? high : low;
+								reg[r ^ j] = descending ? low : high;
+							}
+							else {
+								reg[r] = V::select(laneMask, low, high);
+								reg[r ^ j] = V::select(laneMask, high, low);
+							}
+						}
+					}
+					else {
+						if (layoutA) {
+							V::transpose(reg);
+							layoutA = false;
+						}
+
+						int jr = j >> LOG_W;
+						int kr = k >> LOG_W;
+						for (int r = 0; r < W; r++) {
+							if (r & jr) continue;
+							Vector low = V::min(reg[r], reg[r ^ jr]);
+							Vector high = V::max(reg[r], reg[r ^ jr]);
+							bool descending = k < M && (r & kr) != 0;
+							reg[r] = descending ? high : low;
+							reg[r ^ jr] = descending ? low : high;
+						}
+					}
+				}
+			}
+
+			// layout B stores the registers in logical order
+			if (layoutA) V::transpose(reg);
+			for (int r = 0; r < W; r++) V::store(block + r * W, reg[r]);
+			for (int i = 0; i < size; i++) arr[i] = block[i];
+		}
+
+#if ALG_X86
+		struct Sse2Int32 {
+			typedef int32_t Scalar;
+			typedef __m128i Vector;
+			static const int LANES = 4;
+
+			ALG_TARGET_SSE2 static inline Vector load(const Scalar* p) { return _mm_loadu_si128((const __m128i*)p); }
+			ALG_TARGET_SSE2 static inline void store(Scalar* p, Vector v) { _mm_storeu_si128((__m128i*)p, v); }
+
+			// SSE2 has no 32 bit min/max so build them from a compare
+			ALG_TARGET_SSE2 static inline Vector min(Vector a, Vector b) {
+				Vector greater = _mm_cmpgt_epi32(a, b);
+				return _mm_or_si128(_mm_and_si128(greater, b), _mm_andnot_si128(greater, a));
+			}
+			ALG_TARGET_SSE2 static inline Vector max(Vector a, Vector b) {
+				Vector greater = _mm_cmpgt_epi32(a, b);
+				return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+			}
+
+			// picks <ifSet> in lanes where mask is set
+			ALG_TARGET_SSE2 static inline Vector select(Vector mask, Vector ifClear, Vector ifSet) {
+				return _mm_or_si128(_mm_and_si128(mask, ifSet), _mm_andnot_si128(mask, ifClear));
+			}
+			// lane c is set if (c & bit) != 0
+			ALG_TARGET_SSE2 static inline Vector laneMask(int bit) {
+				return _mm_setr_epi32(0, -((1 & bit) != 0), -((2 & bit) != 0), -((3 & bit) != 0));
+			}
+			ALG_TARGET_SSE2 static inline void transpose(Vector* r) {
+				__m128 r0 = _mm_castsi128_ps(r[0]), r1 = _mm_castsi128_ps(r[1]);
+				__m128 r2 = _mm_castsi128_ps(r[2]), r3 = _mm_castsi128_ps(r[3]);
+				_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+				r[0] = _mm_castps_si128(r0);
+				r[1] = _mm_castps_si128(r1);
+				r[2] = _mm_castps_si128(r2);
+				r[3] = _mm_castps_si128(r3);
+			}
+		};
+
+		struct Sse2Float {
+			typedef float Scalar;
+			typedef __m128 Vector;
+			static const int LANES = 4;
+
+			ALG_TARGET_SSE2 static inline Vector load(const Scalar* p) { return _mm_loadu_ps(p); }
+			ALG_TARGET_SSE2 static inline void store(Scalar* p, Vector v) { _mm_storeu_ps(p, v); }
+			ALG_TARGET_SSE2 static inline Vector min(Vector a, Vector b) { return _mm_min_ps(a, b); }
+			ALG_TARGET_SSE2 static inline Vector max(Vector a, Vector b) { return _mm_max_ps(a, b); }
+			ALG_TARGET_SSE2 static inline Vector select(Vector mask, Vector ifClear, Vector ifSet) {
+				return _mm_or_ps(_mm_and_ps(mask, ifSet), _mm_andnot_ps(mask, ifClear));
+			}
+			ALG_TARGET_SSE2 static inline Vector laneMask(int bit) {
+				return _mm_castsi128_ps(Sse2Int32::laneMask(bit));
+			}
+			ALG_TARGET_SSE2 static inline void transpose(Vector* r) {
+				_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+			}
+		};
+
+		struct Avx2Int32 {
+			typedef int32_t Scalar;
+			typedef __m256i Vector;
+			static const int LANES = 8;
+
+			ALG_TARGET_AVX2 static inline Vector load(const Scalar* p) { return _mm256_loadu_si256((const __m256i*)p); }
+			ALG_TARGET_AVX2 static inline void store(Scalar* p, Vector v) { _mm256_storeu_si256((__m256i*)p, v); }
+			ALG_TARGET_AVX2 static inline Vector min(Vector a, Vector b) { return _mm256_min_epi32(a, b); }
+			ALG_TARGET_AVX2 static inline Vector max(Vector a, Vector b) { return _mm256_max_epi32(a, b); }
+			ALG_TARGET_AVX2 static inline Vector select(Vector mask, Vector ifClear, Vector ifSet) {
+				return _mm256_blendv_epi8(ifClear, ifSet, mask);
+			}
+			ALG_TARGET_AVX2 static inline Vector laneMask(int bit) {
+				return _mm256_setr_epi32(0, -((1 & bit) != 0), -((2 & bit) != 0), -((3 & bit) != 0),
+					-((4 & bit) != 0), -((5 & bit) != 0), -((6 & bit) != 0), -((7 & bit) != 0));
+			}
+			ALG_TARGET_AVX2 static inline void transpose(Vector* r) {
+				__m256 f[8];
+				for (int i = 0; i < 8; i++) f[i] = _mm256_castsi256_ps(r[i]);
+				transpose8x8(f);
+				for (int i = 0; i < 8; i++) r[i] = _mm256_castps_si256(f[i]);
+			}
+
+			ALG_TARGET_AVX2 static inline void transpose8x8(__m256* r) {
+				__m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+				__m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+				__m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+				__m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+				__m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+				__m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+				__m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+				__m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+
+				__m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+				__m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+				__m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+				__m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+				__m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+				__m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+				__m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+				__m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+				r[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+				r[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+				r[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+				r[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+				r[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+				r[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+				r[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+				r[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+			}
+		};
+
+		struct Avx2Float {
+			typedef float Scalar;
+			typedef __m256 Vector;
+			static const int LANES = 8;
+
+			ALG_TARGET_AVX2 static inline Vector load(const Scalar* p) { return _mm256_loadu_ps(p); }
+			ALG_TARGET_AVX2 static inline void store(Scalar* p, Vector v) { _mm256_storeu_ps(p, v); }
+			ALG_TARGET_AVX2 static inline Vector min(Vector a, Vector b) { return _mm256_min_ps(a, b); }
+			ALG_TARGET_AVX2 static inline Vector max(Vector a, Vector b) { return _mm256_max_ps(a, b); }
+			ALG_TARGET_AVX2 static inline Vector select(Vector mask, Vector ifClear, Vector ifSet) {
+				return _mm256_blendv_ps(ifClear, ifSet, mask);
+			}
+			ALG_TARGET_AVX2 static inline Vector laneMask(int bit) {
+				return _mm256_castsi256_ps(Avx2Int32::laneMask(bit));
+			}
+			ALG_TARGET_AVX2 static inline void transpose(Vector* r) {
+				Avx2Int32::transpose8x8(r);
+			}
+		};
+
+		struct Avx2Double {
+			typedef double Scalar;
+			typedef __m256d Vector;
+			static const int LANES = 4;
+
+			ALG_TARGET_AVX2 static inline Vector load(const Scalar* p) { return _mm256_loadu_pd(p); }
+			ALG_TARGET_AVX2 static inline void store(Scalar* p, Vector v) { _mm256_storeu_pd(p, v); }
+			ALG_TARGET_AVX2 static inline Vector min(Vector a, Vector b) { return _mm256_min_pd(a, b); }
+			ALG_TARGET_AVX2 static inline Vector max(Vector a, Vector b) { return _mm256_max_pd(a, b); }
+			ALG_TARGET_AVX2 static inline Vector select(Vector mask, Vector ifClear, Vector ifSet) {
+				return _mm256_blendv_pd(ifClear, ifSet, mask);
+			}
+			ALG_TARGET_AVX2 static inline Vector laneMask(int bit) {
+				return _mm256_castsi256_pd(_mm256_setr_epi64x(0, -(long long)((1 & bit) != 0),
+					-(long long)((2 & bit) != 0), -(long long)((3 & bit) != 0)));
+			}
+			ALG_TARGET_AVX2 static inline void transpose(Vector* r) {
+				__m256d t0 = _mm256_unpacklo_pd(r[0], r[1]);
+				__m256d t1 = _mm256_unpackhi_pd(r[0], r[1]);
+				__m256d t2 = _mm256_unpacklo_pd(r[2], r[3]);
+				__m256d t3 = _mm256_unpackhi_pd(r[2], r[3]);
+				r[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+				r[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+				r[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+				r[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+			}
+		};
+
+		// target specific entry points; the kernel is inlined into each of them
+		ALG_TARGET_SSE2 static void sse2Network(int32_t* arr, int size) { simdBitonic<Sse2Int32>(arr, size); }
+		ALG_TARGET_SSE2 static void sse2Network(float* arr, int size) { simdBitonic<Sse2Float>(arr, size); }
+		ALG_TARGET_AVX2 static void avx2Network(int32_t* arr, int size) { simdBitonic<Avx2Int32>(arr, size); }
+		ALG_TARGET_AVX2 static void avx2Network(float* arr, int size) { simdBitonic<Avx2Float>(arr, size); }
+		ALG_TARGET_AVX2 static void avx2Network(double* arr, int size) { simdBitonic<Avx2Double>(arr, size); }
+#endif
+
+		template <typename T>
+		inline bool hasNaN(const T* arr, int size) {
+			for (int i = 0; i < size; i++) {
+				if (arr[i] != arr[i]) return true;
+			}
+			return false;
+		}
+
+		/* Tries the SIMD kernels; they only exist for 32 bit ints, floats and doubles
+		* @return true if the block was sorted
+		*/
+		template <typename T>
+		inline bool simdNetwork(T*, int) {
+			return false;
+		}
+
+#if ALG_X86
+		inline bool simdNetwork(int32_t* arr, int size) {
+			// the smaller SSE2 block is cheaper when everything fits in it
+			const CpuFeatures& cpu = GetCpuFeatures();
+			if (cpu.sse2 && size <= 16) {
+				sse2Network(arr, size);
+				return true;
+			}
+			if (cpu.avx2 && size <= 64) {
+				avx2Network(arr, size);
+				return true;
+			}
+			return false;
+		}
+
+		inline bool simdNetwork(float* arr, int size) {
+			// vector min/max do not preserve NaNs, so leave those to the scalar network
+			if (hasNaN(arr, size)) return false;
+
+			const CpuFeatures& cpu = GetCpuFeatures();
+			if (cpu.sse2 && size <= 16) {
+				sse2Network(arr, size);
+				return true;
+			}
+			if (cpu.avx2 && size <= 64) {
+				avx2Network(arr, size);
+				return true;
+			}
+			return false;
+		}
+
+		inline bool simdNetwork(double* arr, int size) {
+			if (hasNaN(arr, size)) return false;
+
+			if (GetCpuFeatures().avx2 && size <= 16) {
+				avx2Network(arr, size);
+				return true;
+			}
+			return false;
+		}
+#endif
+	}
+
+	/* Sort a block of at most 64 arithmetic values with a bitonic sorting network
+	@param arr the array to be sorted
+	@param size the number of elements to sort, at most 64
+
+	Throws SortingNetworkSizeException if <size> is larger than 64.
+	Notes: picks an AVX2 or SSE2 kernel at runtime when the CPU has one for T, otherwise runs
+	the scalar network
+	*/
+	template <typename T>
+	static void SortingNetwork(T arr[], int size) {
+		if (size > network_detail::MAX_NETWORK_SIZE) throw SortingNetworkSizeException();
+		if (size < 2) return;
+		if (network_detail::simdNetwork(arr, size)) return;
+
+		T block[network_detail::MAX_NETWORK_SIZE];
+		int padded = 2;
+		while (padded < size) padded <<= 1;
+
+		for (int i = 0; i < size; i++) block[i] = arr[i];
+		for (int i = size; i < padded; i++) block[i] = network_detail::paddingValue<T>();
+
+		network_detail::scalarBitonic(block, padded);
+		for (int i = 0; i < size; i++) arr[i] = block[i];
+	}
+}
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
@@ -0,0 +1,186 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+// lock-free single producer, single consumer circular queue
+// the producer only writes the tail index and the consumer only writes the head index, so a
+// release store on one side and an acquire load on the other is all the synchronization needed.
+// Both indices sit on their own cache line together with the owning side's cached copy of the
+// other index; the cache is only refreshed when it says the queue is full (or empty), so in the
+// steady state neither side touches the other side's cache line.
+// https://en.wikipedia.org/wiki/Circular_buffer
+// RE: https://rigtorp.se/ringbuffer/
+
+namespace alg {
+	template<typename T>
+	class SPSCQueue {
+	private:
+		enum { CACHE_LINE = 64 };
+
+		// one slot stays empty so that head == tail only means empty
+		size_t m_slots;
+		T* m_elements;
+
+		// consumer side
+		alignas(CACHE_LINE) std::atomic<size_t> m_head; // index of the front of the queue
+		size_t m_tailCache;
+
+		// producer side
+		alignas(CACHE_LINE) std::atomic<size_t> m_tail; // index one past the end of the queue
+		size_t m_headCache;
+
+		char m_padding[CACHE_LINE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+		inline size_t next(size_t index) const {
+			return index + 1 == m_slots ? 0 : index + 1;
+		}
+
+		// number of elements between <head> and <tail>; branches instead of % keeps the
+		// division out of the fast path
+		inline size_t distance(size_t head, size_t tail) const {
+			return tail >= head ? tail - head : tail + m_slots - head;
+		}
+
+		/* Number of slots the producer can fill from <tail>, refreshing the cached head if
+		* fewer than <wanted> look free
+		*/
+		inline size_t freeSlots(size_t tail, size_t wanted) {
+			size_t free = m_slots - 1 - distance(m_headCache, tail);
+			if (free < wanted) {
+				m_headCache = m_head.load(std::memory_order_acquire);
+				free = m_slots - 1 - distance(m_headCache, tail);
+			}
+			return free;
+		}
+
+		/* Number of elements the consumer can take from <head>, refreshing the cached tail if
+		* fewer than <wanted> look available
+		*/
+		inline size_t usedSlots(size_t head, size_t wanted) {
+			size_t used = distance(head, m_tailCache);
+			if (used < wanted) {
+				m_tailCache = m_tail.load(std::memory_order_acquire);
+				used = distance(head, m_tailCache);
+			}
+			return used;
+		}
+
+	public:
+		SPSCQueue(int capacity) : m_head(0), m_tailCache(0), m_tail(0), m_headCache(0) {
+			m_slots = (capacity > 0 ? (size_t)capacity : 1) + 1;
+			// a cache line of slack on both sides keeps neighbouring allocations off the
+			// lines of the first and last slots
+			size_t padding = (CACHE_LINE + sizeof(T) - 1) / sizeof(T);
+			m_elements = static_cast<T*>(::operator new(sizeof(T) * (m_slots + 2 * padding))) + padding;
+		}
+
+		/* Note: neither side may use the queue while it is destroyed
+		*/
+		~SPSCQueue() {
+			size_t head = m_head.load();
+			size_t tail = m_tail.load();
+			for (; head != tail; head = next(head)) m_elements[head].~T();
+
+			size_t padding = (CACHE_LINE + sizeof(T) - 1) / sizeof(T);
+			::operator delete(m_elements - padding);
+		}
+
+		SPSCQueue(const SPSCQueue&) = delete;
+		SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+		/* Construct an element from <args> at the end of the queue; producer only
+		@return true if queue is not full, false if the queue is full
+		*/
+		template <typename... Args>
+		inline bool try_emplace(Args&&... args) {
+			size_t tail = m_tail.load(std::memory_order_relaxed);
+			if (freeSlots(tail, 1) == 0) return false;
+
+			new (&m_elements[tail]) T(std::forward<Args>(args)...);
+			m_tail.store(next(tail), std::memory_order_release);
+			return true;
+		}
+
+		inline bool try_enqueue(const T& value) {
+			return try_emplace(value);
+		}
+
+		inline bool try_enqueue(T&& value) {
+			return try_emplace(std::move(value));
+		}
+
+		/* Move the element at the front of the queue into <value>; consumer only
+		@return false if the queue is empty
+		*/
+		inline bool try_dequeue(T& value) {
+			size_t head = m_head.load(std::memory_order_relaxed);
+			if (usedSlots(head, 1) == 0) return false;
+
+			value = std::move(m_elements[head]);
+			m_elements[head].~T();
+			m_head.store(next(head), std::memory_order_release);
+			return true;
+		}
+
+		/* Enqueue up to <count> elements read from <first>, publishing them all at once;
+		* producer only (pass a std::move_iterator to move the elements in)
+		@return the number of elements enqueued
+		*/
+		template <typename InputIt>
+		int try_enqueue_bulk(InputIt first, int count) {
+			if (count <= 0) return 0;
+			size_t tail = m_tail.load(std::memory_order_relaxed);
+			size_t free = freeSlots(tail, (size_t)count);
+			if ((size_t)count > free) count = (int)free;
+
+			size_t index = tail;
+			for (int i = 0; i < count; i++, ++first) {
+				new (&m_elements[index]) T(*first);
+				index = next(index);
+			}
+			m_tail.store(index, std::memory_order_release);
+			return count;
+		}
+
+		/* Move up to <maxCount> elements from the front of the queue to <out>, releasing their
+		* slots all at once; consumer only
+		@return the number of elements dequeued
+		*/
+		template <typename OutputIt>
+		int try_dequeue_bulk(OutputIt out, int maxCount) {
+			if (maxCount <= 0) return 0;
+			size_t head = m_head.load(std::memory_order_relaxed);
+			size_t used = usedSlots(head, (size_t)maxCount);
+			int count = (size_t)maxCount < used ? maxCount : (int)used;
+
+			size_t index = head;
+			for (int i = 0; i < count; i++, ++out) {
+				*out = std::move(m_elements[index]);
+				m_elements[index].~T();
+				index = next(index);
+			}
+			m_head.store(index, std::memory_order_release);
+			return count;
+		}
+
+		/* Note: only a snapshot while the other side is running
+		*/
+		inline bool is_empty() const {
+			return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+		}
+
+		/* Note: only a snapshot while the other side is running
+		*/
+		inline int getSize() const {
+			size_t head = m_head.load(std::memory_order_acquire);
+			size_t tail = m_tail.load(std::memory_order_acquire);
+			return (int)distance(head, tail);
+		}
+
+		inline int getCapacity() const {
+			return (int)(m_slots - 1);
+		}
+	};
+}
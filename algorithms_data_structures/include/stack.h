@@ -1,18 +1,154 @@
 #pragma once
+#include "instrumentation.h"
+#include "memory_usage.h"
+#include <array>
 #include <exception>
+#include <new>
+#include <utility>
 
 // stack implementation with pushing and popping from the end of an array
 // indexing is O(1) operation so it's faster than moving all the elements by
 // pushing the front
+// Stack<T> grows geometrically on the heap; Stack<T, N> keeps at most N elements inline
+// (no heap allocation at all) and is usable in constant expressions
 
 namespace alg {
 
 	// template stuff:
 	// https://stackoverflow.com/questions/495021/why-can-templates-only-be-implemented-in-the-header-file
 
-	template<typename T>
-	
+	/* Fixed capacity stack with its N elements stored inline in a std::array
+	* Note: the elements are default constructed up front, so T has to be default constructible
+	*/
+	template<typename T, int N = 0>
 	class Stack {
+	private:
+		// thrown as temporaries rather than kept as members so that the stack stays a literal type
+		class StackEmptyException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "stack is empty";
+			}
+		};
+
+		class StackFullException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "stack is full";
+			}
+		};
+
+		class StackIndexOutOfBoundsException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "stack index out of bounds";
+			}
+		};
+
+		static_assert(N > 0, "Stack capacity has to be positive");
+
+		std::array<T, N> m_elements;
+		int m_size;
+
+	public:
+		constexpr Stack() : m_elements(), m_size(0) {}
+
+		constexpr bool is_empty() const {
+			return (m_size == 0);
+		}
+
+		/* Remove the element at the top of the stack and return it (moved out)
+		@return the element at the top of the stack
+		*/
+		constexpr T pop() {
+			if (m_size == 0) {
+				ALG_COUNT(StackEmptyRejections);
+				throw StackEmptyException();
+			}
+			return std::move(m_elements[--m_size]);
+		}
+
+		/* Push an element to the top of the stack
+		@return true if stack is not full, false if the stack is full
+		*/
+		constexpr bool push(const T& value) {
+			if (m_size == N) {
+				ALG_COUNT(StackFullRejections);
+				return false;
+			}
+			m_elements[m_size++] = value;
+			return true;
+		}
+
+		constexpr bool push(T&& value) {
+			if (m_size == N) {
+				ALG_COUNT(StackFullRejections);
+				return false;
+			}
+			m_elements[m_size++] = std::move(value);
+			return true;
+		}
+
+		/* Construct an element from <args> at the top of the stack
+		* Note: throws an error if the stack is full
+		@return the new element
+		*/
+		template <typename... Args>
+		constexpr T& emplace(Args&&... args) {
+			if (m_size == N) {
+				ALG_COUNT(StackFullRejections);
+				throw StackFullException();
+			}
+			m_elements[m_size] = T(std::forward<Args>(args)...);
+			return m_elements[m_size++];
+		}
+
+		/* Return the element at the top of the stack without modifying the stack itself.
+		* @return the element at the top of the stack
+		*/
+		constexpr T& peek() {
+			if (m_size == 0) {
+				ALG_COUNT(StackEmptyRejections);
+				throw StackEmptyException();
+			}
+			return m_elements[m_size - 1];
+		}
+
+		constexpr int getSize() const {
+			return m_size;
+		}
+
+		constexpr int getCapacity() const {
+			return N;
+		}
+
+		/* Everything is inline: no heap bytes, the unused slots are overhead
+		*/
+		MemoryUsage memoryUsage() const {
+			MemoryUsage usage;
+			usage.objectBytes = sizeof(*this);
+			usage.allocatedBytes = 0;
+			usage.liveBytes = (size_t)m_size * sizeof(T);
+			usage.payloadBytes = usage.liveBytes;
+			usage.elementCount = m_size;
+			usage.nodeCount = 0;
+			return usage;
+		}
+
+		/* Return value by index, starting at the top of the stack
+		@return the element at the specified index
+		*/
+		constexpr const T& operator [] (int index) const {
+			if (index < 0 || index >= m_size) throw StackIndexOutOfBoundsException();
+			return m_elements[m_size - 1 - index];
+		}
+	};
+
+	/* Stack that grows on the heap
+	* Note: elements are moved, never copied, when the array grows
+	*/
+	template<typename T>
+	class Stack<T, 0> {
 	private:
 		class StackEmptyException : public std::exception {
 		public:
@@ -30,56 +166,156 @@ namespace alg {
 
 		int m_capacity;
 		int m_size;
-		T* m_elements;
+		T* m_elements; // raw storage; only the first m_size elements are constructed
 
-	public:
-		Stack(int capacity) {
+		static T* allocate(int capacity) {
+			if (capacity == 0) return nullptr;
+			ALG_COUNT(StackAllocations);
+			T* elements = static_cast<T*>(::operator new(sizeof(T) * capacity));
+			ALG_TRACK_ALLOCATION(sizeof(T) * capacity);
+			return elements;
+		}
+
+		static void deallocate(T* elements, int capacity) {
+			if (elements == nullptr) return;
+			ALG_TRACK_DEALLOCATION(sizeof(T) * capacity);
+			::operator delete(elements);
+		}
+
+		void destroyAll() {
+			for (int i = 0; i < m_size; i++) {
+				m_elements[i].~T();
+			}
+			deallocate(m_elements, m_capacity);
+		}
+
+		/* Move the elements to a new array of <capacity> elements
+		*/
+		void reallocate(int capacity) {
+			T* elements = allocate(capacity);
+			int moved = 0;
+			try {
+				for (; moved < m_size; moved++) {
+					new (&elements[moved]) T(std::move_if_noexcept(m_elements[moved]));
+				}
+			}
+			catch (...) {
+				for (int i = 0; i < moved; i++) elements[i].~T();
+				deallocate(elements, capacity);
+				throw;
+			}
+
+			destroyAll();
+			m_elements = elements;
 			m_capacity = capacity;
+		}
+
+		// doubling keeps the amortized cost of a push O(1)
+		inline void grow() {
+			reallocate(m_capacity < 4 ? 8 : m_capacity * 2);
+		}
+
+	public:
+		Stack(int capacity = 0) {
+			m_capacity = capacity > 0 ? capacity : 0;
 			m_size = 0;
-			m_elements = new T[capacity];
+			m_elements = allocate(m_capacity);
 		}
 
 		// called when the Stack is deleted
 		~Stack() {
 			// elements are deleted since they are in an array and not deleted by default;
 			// the other attributes like capacity and size are deleted by default with the Stack.
-			delete [] m_elements;
+			destroyAll();
+		}
+
+		Stack(const Stack& other) : Stack(other.m_size) {
+			for (; m_size < other.m_size; m_size++) {
+				new (&m_elements[m_size]) T(other.m_elements[m_size]);
+			}
+		}
+
+		Stack(Stack&& other) noexcept {
+			m_capacity = other.m_capacity;
+			m_size = other.m_size;
+			m_elements = other.m_elements;
+			other.m_capacity = 0;
+			other.m_size = 0;
+			other.m_elements = nullptr;
+		}
+
+		Stack& operator=(Stack other) {
+			std::swap(m_capacity, other.m_capacity);
+			std::swap(m_size, other.m_size);
+			std::swap(m_elements, other.m_elements);
+			return *this;
 		}
 
 		// the "inline" keyword is an optimization technique for the program to store the memory
 		// addresses of instructions. This is used for simple functions.
-		inline bool is_empty() {
+		inline bool is_empty() const {
 			return (m_size == 0);
 		}
 
-		/* Remove the element at the top of the stack and return it
+		/* Remove the element at the top of the stack and return it (moved out)
 		@return the element at the top of the stack
 		*/
 		inline T pop() {
-			if (m_size > 0) {
-				m_size--;
-				return m_elements[m_size];
+			if (m_size == 0) {
+				ALG_COUNT(StackEmptyRejections);
+				throw exception_empty;
 			}
-			throw exception_empty;
+
+			T value = std::move(m_elements[m_size - 1]);
+			m_elements[--m_size].~T();
+			return value;
 		}
 
 		/* Push an element to the top of the stack
-		@return true if stack is not full, false if the stack is full
+		@return true; the stack grows when it is full
 		*/
 		inline bool push(const T& value) {
-			if (m_size < m_capacity) {
-				m_elements[m_size++] = value;
-				return true;
+			emplace(value);
+			return true;
+		}
+
+		inline bool push(T&& value) {
+			emplace(std::move(value));
+			return true;
+		}
+
+		/* Construct an element from <args> at the top of the stack
+		@return the new element
+		*/
+		template <typename... Args>
+		inline T& emplace(Args&&... args) {
+			if (m_size == m_capacity) {
+				// build the element first: args may refer to an element that is about to move
+				T value(std::forward<Args>(args)...);
+				grow();
+				new (&m_elements[m_size]) T(std::move(value));
 			}
-			return false;
+			else {
+				new (&m_elements[m_size]) T(std::forward<Args>(args)...);
+			}
+			return m_elements[m_size++];
+		}
+
+		/* Make room for at least <capacity> elements
+		*/
+		void reserve(int capacity) {
+			if (capacity > m_capacity) reallocate(capacity);
 		}
 
 		/* Return the element at the top of the stack without modifying the stack itself.
 		* @return the element at the top of the stack
 		*/
-		inline T peek() {
-			if (m_size == 0) throw exception_empty;
-			return m_elements[m_size];
+		inline T& peek() {
+			if (m_size == 0) {
+				ALG_COUNT(StackEmptyRejections);
+				throw exception_empty;
+			}
+			return m_elements[m_size - 1];
 		}
 
 		inline int getSize() const {
@@ -90,11 +326,24 @@ namespace alg {
 			return m_capacity;
 		}
 
+		/* Bytes held by the stack; the unused capacity counts as overhead
+		*/
+		MemoryUsage memoryUsage() const {
+			MemoryUsage usage;
+			usage.objectBytes = sizeof(*this);
+			usage.allocatedBytes = (size_t)m_capacity * sizeof(T);
+			usage.liveBytes = (size_t)m_size * sizeof(T);
+			usage.payloadBytes = usage.liveBytes;
+			usage.elementCount = m_size;
+			usage.nodeCount = m_elements != nullptr ? 1 : 0;
+			return usage;
+		}
+
 		/* Return value by index, starting at the top of the stack
 		@return the element at the specified index
 		*/
 		inline const T& operator [] (int index) const {
-			if (index < m_capacity) {
+			if (index >= 0 && index < m_size) {
 				return m_elements[m_size - 1 - index];
 			}
 			else {
@@ -102,4 +351,4 @@ namespace alg {
 			}
 		}
 	};
-}
\ No newline at end of file
+}
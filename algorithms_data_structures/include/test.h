@@ -1,15 +1,44 @@
 #pragma once
 #include "bubble_sort.h"
+#include "sort.h"
+#include "parallel_sort.h"
+#include "external_sort.h"
 #include "stack.h"
+#include "concurrent_stack.h"
 #include "queue.h"
+#include "deque.h"
+#include "spsc_queue.h"
+#include "mpmc_queue.h"
 #include "binary_search_tree.h"
+#include "frozen_bst.h"
+#include "red_black_tree.h"
+#include "order_statistic_tree.h"
+#include "b_plus_tree.h"
+#include "concurrent_skip_list.h"
 #include "linked_list.h"
+#include "intrusive_list.h"
+#include "unrolled_list.h"
 #include "elo.h"
+#include "elo_replay.h"
+#include "elo_store.h"
+#include "rating_index.h"
+#include "instrumentation.h"
+#include "memory_usage.h"
+#include "snapshot.h"
 #include <iostream>
 #include <vector>
 #include <array>
+#include <atomic>
 #include <algorithm>
 #include <random>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <set>
 
 using namespace std;
 
@@ -35,6 +64,157 @@ namespace alg {
 			cout << arr[len] << "]\n";
 		}
 
+		static void test_sort() {
+			cout << "Sort test!\n";
+			int arr[8] = { 8, 7, 6, 5, 4, 3, 2, 1 };
+			int len = size(arr) - 1;
+
+			alg::Sort(arr, 0, len);
+
+			cout << "Array after sorting: \n[";
+			for (int i = 0; i < len; i++) {
+				cout << arr[i] << ", ";
+			}
+			cout << arr[len] << "]\n";
+
+			cout << "Sorting 100000 shuffled ints in descending order with a comparator:\n";
+			vector<int> numbers(100000);
+			for (unsigned int i = 0; i < numbers.size(); i++) {
+				numbers[i] = i;
+			}
+			shuffle(numbers.begin(), numbers.end(), default_random_engine(1));
+			alg::Sort(numbers.begin(), numbers.end(), greater<int>());
+			cout << "is sorted: " << is_sorted(numbers.begin(), numbers.end(), greater<int>()) << "\n";
+
+			cout << "Stable sorting (key, order) pairs by key only:\n";
+			vector<pair<int, int>> pairs;
+			for (int i = 0; i < 1000; i++) {
+				pairs.push_back(make_pair(numbers[i] % 10, i));
+			}
+			alg::StableSort(pairs.begin(), pairs.end(), [](const pair<int, int>& a, const pair<int, int>& b) {
+				return a.first < b.first;
+			});
+			cout << "is stable: " << is_sorted(pairs.begin(), pairs.end()) << "\n";
+		}
+
+		static void test_sort_arithmetic() {
+			cout << "Arithmetic sort test!\n";
+			float floats[10] = { 3.5f, -1.0f, 0.0f, -0.0f, 1e30f, -1e30f, 2.25f, -7.5f, 0.5f, 3.5f };
+			alg::RadixSort(floats, 0, 9);
+			cout << "Floats after radix sorting: \n[";
+			for (int i = 0; i < 9; i++) {
+				cout << floats[i] << ", ";
+			}
+			cout << floats[9] << "]\n";
+
+			int small[20];
+			for (int i = 0; i < 20; i++) small[i] = (i * 7919) % 23 - 11;
+			alg::SortingNetwork(small, 20);
+			cout << "20 ints after the sorting network: \n[";
+			for (int i = 0; i < 19; i++) {
+				cout << small[i] << ", ";
+			}
+			cout << small[19] << "]\n";
+			int large[100] = {};
+			try {
+				alg::SortingNetwork(large, 100);
+			}
+			catch (exception& e) {
+				cout << "Sorting network on 100 ints: " << e.what() << "\n";
+			}
+
+			// compare the comparison path (a comparator forces it) against the arithmetic path
+			default_random_engine generator(1);
+			uniform_int_distribution<int> distribution;
+			for (int size : { 1000000, 10000000 }) {
+				vector<int> numbers(size);
+				for (int& number : numbers) number = distribution(generator);
+				vector<int> copy = numbers;
+
+				auto start = chrono::steady_clock::now();
+				alg::Sort(numbers.data(), 0, size - 1, less<int>());
+				auto middle = chrono::steady_clock::now();
+				alg::Sort(copy.data(), 0, size - 1);
+				auto end = chrono::steady_clock::now();
+
+				cout << size << " ints: comparison sort " << chrono::duration<double, milli>(middle - start).count()
+					<< "ms, radix sort " << chrono::duration<double, milli>(end - middle).count()
+					<< "ms, same result: " << (numbers == copy) << "\n";
+			}
+		}
+
+		static void test_parallel_sort() {
+			cout << "Parallel sort test!\n";
+			const int size = 10000000;
+			default_random_engine generator(1);
+			uniform_int_distribution<int> distribution;
+			vector<int> numbers(size);
+			for (int& number : numbers) number = distribution(generator);
+
+			vector<int> expected = numbers;
+			alg::Sort(expected.data(), 0, size - 1);
+
+			// scaling report: time the same input on 1 to N threads
+			int maxThreads = max(1, (int)thread::hardware_concurrency());
+			double baseline = 0;
+			for (int threads = 1; threads <= maxThreads; threads *= 2) {
+				vector<int> copy = numbers;
+				auto start = chrono::steady_clock::now();
+				alg::ParallelSort(copy.data(), 0, size - 1, threads);
+				double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+				if (threads == 1) baseline = elapsed;
+
+				cout << threads << " thread(s): " << elapsed << "ms, speedup " << baseline / elapsed
+					<< ", matches serial sort: " << (copy == expected) << "\n";
+
+				if (threads < maxThreads && threads * 2 > maxThreads) threads = maxThreads / 2;
+			}
+
+			cout << "Stable parallel sort of (key, order) pairs by key only:\n";
+			vector<pair<int, int>> pairs(1000000);
+			for (int i = 0; i < (int)pairs.size(); i++) {
+				pairs[i] = make_pair(numbers[i] % 100, i);
+			}
+			alg::ParallelSort(pairs.data(), 0, (int)pairs.size() - 1, 4, [](const pair<int, int>& a, const pair<int, int>& b) {
+				return a.first < b.first;
+			});
+			cout << "is stable: " << is_sorted(pairs.begin(), pairs.end()) << "\n";
+		}
+
+		static void test_external_sort() {
+			cout << "External sort test!\n";
+			const int size = 4000000;
+			const char* inputPath = "external_sort_input.bin";
+			const char* outputPath = "external_sort_output.bin";
+
+			default_random_engine generator(1);
+			uniform_int_distribution<int> distribution;
+			vector<int> numbers(size);
+			for (int& number : numbers) number = distribution(generator);
+
+			ofstream input(inputPath, ios::binary);
+			input.write((const char*)numbers.data(), size * sizeof(int));
+			input.close();
+
+			// 16MB of records with a 2MB budget: 8 runs, merged two at a time
+			cout << "Sorting " << size << " ints from a file with a 2MB memory budget\n";
+			auto start = chrono::steady_clock::now();
+			alg::ExternalSort<int>(inputPath, outputPath, 2 << 20);
+			cout << "took " << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << "ms\n";
+
+			vector<int> sorted(size);
+			ifstream output(outputPath, ios::binary);
+			output.read((char*)sorted.data(), size * sizeof(int));
+			streamsize read = output.gcount() / sizeof(int);
+			output.close();
+
+			alg::Sort(numbers.data(), 0, size - 1);
+			cout << "read back " << read << " records, matches in memory sort: " << (sorted == numbers) << "\n";
+
+			remove(inputPath);
+			remove(outputPath);
+		}
+
 		static void test_stack() {
 			alg::Stack<float> s(4);
 			cout << "new stack!\n";
@@ -45,12 +225,194 @@ namespace alg {
 			cout << "pushing value -3.14159\n";
 			s.push((float)-3.14159);
 
-			cout << "pushing 1, return value when not full: " << s.push(1) << "\n";
-			cout << "pushing 1, return value when full: " << s.push(1) << "\n";
+			cout << "pushing 1, capacity before: " << s.getCapacity();
+			s.push(1);
+			cout << ", after: " << s.getCapacity() << "\n";
+			cout << "pushing 1 past the initial capacity, capacity before: " << s.getCapacity();
+			s.push(1);
+			cout << ", after: " << s.getCapacity() << "\n";
+			cout << "peeking: " << s.peek() << ", indexing element at position 1: " << s[1] << "\n";
 
 			while (!s.is_empty()) {
 				cout << "popping value: " << s.pop() << "\n";
 			}
+
+			alg::Stack<string> strings;
+			strings.emplace(3, 'a');
+			strings.push("bb");
+			cout << "emplaced string(3, 'a') and pushed \"bb\", popping: " << strings.pop() << ", " << strings.pop() << "\n";
+
+			// the fixed capacity variant works in constant expressions
+			constexpr int fixedSum = []() {
+				alg::Stack<int, 4> fixed;
+				fixed.push(1);
+				fixed.push(2);
+				fixed.emplace(3);
+				return fixed.pop() + fixed.pop() + fixed.peek();
+			}();
+			static_assert(fixedSum == 6, "Stack<T, N> should be usable in constant expressions");
+			alg::Stack<int, 2> fixed;
+			fixed.push(1);
+			fixed.push(2);
+			cout << "fixed stack of 2, pushing a third: " << fixed.push(3) << "\n";
+
+			// benchmark against std::vector
+			const int size = 1000000;
+			const string payload(32, 'x');
+			auto time = [](auto body) {
+				auto start = chrono::steady_clock::now();
+				body();
+				return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			};
+			size_t checksum = 0;
+
+			double stackStrings = time([&]() {
+				alg::Stack<string> stack;
+				for (int i = 0; i < size; i++) stack.push(payload);
+				while (!stack.is_empty()) checksum += stack.pop().size();
+			});
+			double vectorStrings = time([&]() {
+				vector<string> stack;
+				for (int i = 0; i < size; i++) stack.push_back(payload);
+				while (!stack.empty()) {
+					string value = std::move(stack.back());
+					stack.pop_back();
+					checksum += value.size();
+				}
+			});
+			cout << size << " string pushes and pops: Stack " << stackStrings << "ms, std::vector " << vectorStrings << "ms\n";
+
+			// small bounded stacks created inside a hot loop
+			const int depth = 16;
+			double fixedLoop = time([&]() {
+				for (int i = 0; i < size / depth; i++) {
+					alg::Stack<int, depth> stack;
+					for (int j = 0; j < depth; j++) stack.push(i + j);
+					while (!stack.is_empty()) checksum += stack.pop();
+				}
+			});
+			double growableLoop = time([&]() {
+				for (int i = 0; i < size / depth; i++) {
+					alg::Stack<int> stack;
+					for (int j = 0; j < depth; j++) stack.push(i + j);
+					while (!stack.is_empty()) checksum += stack.pop();
+				}
+			});
+			double vectorLoop = time([&]() {
+				for (int i = 0; i < size / depth; i++) {
+					vector<int> stack;
+					for (int j = 0; j < depth; j++) stack.push_back(i + j);
+					while (!stack.empty()) {
+						checksum += stack.back();
+						stack.pop_back();
+					}
+				}
+			});
+			cout << size / depth << " stacks of " << depth << " ints: Stack<int, " << depth << "> " << fixedLoop
+				<< "ms, Stack<int> " << growableLoop << "ms, std::vector " << vectorLoop << "ms (checksum "
+				<< checksum << ")\n";
+		}
+
+		static void test_concurrent_stack() {
+			cout << "Concurrent stack test!\n";
+			alg::ConcurrentStack<int> stack;
+			for (int i = 1; i <= 3; i++) {
+				cout << "pushing value " << i << "\n";
+				stack.push(i);
+			}
+			int value;
+			while (stack.try_pop(value)) {
+				cout << "popping value: " << value << "\n";
+			}
+			cout << "nodes in the pool: " << stack.getPoolSize() << "\n";
+
+			// stress test: every thread pushes values tagged with its own id and pops whatever is
+			// on top; once everything is drained, each value must have been popped exactly once
+			// (nothing lost, duplicated or made up), whether it went through the stack or the
+			// elimination array
+			{
+				const int threads = 8;
+				const int perThread = 200000;
+				alg::ConcurrentStack<int> shared;
+				vector<vector<int>> popped(threads);
+
+				vector<thread> workers;
+				for (int t = 0; t < threads; t++) {
+					workers.push_back(thread([&shared, &popped, t, perThread]() {
+						mt19937 rng(t);
+						int pushed = 0;
+						int item;
+						while (pushed < perThread) {
+							if (rng() % 2 == 0) {
+								shared.push(t * perThread + pushed++);
+							}
+							else if (shared.try_pop(item)) {
+								popped[t].push_back(item);
+							}
+						}
+					}));
+				}
+				for (thread& worker : workers) worker.join();
+				while (shared.try_pop(value)) popped[0].push_back(value);
+
+				vector<int> seen(threads * perThread, 0);
+				int errors = 0;
+				for (vector<int>& values : popped) {
+					for (int v : values) {
+						if (v < 0 || v >= threads * perThread) errors++;
+						else seen[v]++;
+					}
+				}
+				for (int count : seen) {
+					if (count != 1) errors++;
+				}
+				cout << "Stress test with " << threads << " threads: " << errors << " errors\n";
+			}
+
+			// throughput of push/pop pairs; the mutex guards an alg::Stack
+			cout << "Throughput in million push/pop pairs per second (mutex + Stack / Treiber / Treiber with elimination):\n";
+			const int totalPairs = 1000000;
+			for (int threads : { 1, 2, 4, 8, 16, 32, 64 }) {
+				auto measure = [threads](auto push, auto pop) {
+					vector<thread> workers;
+					auto start = chrono::steady_clock::now();
+					for (int t = 0; t < threads; t++) {
+						workers.push_back(thread([&push, &pop, threads]() {
+							for (int i = 0; i < totalPairs / threads; i++) {
+								push(i);
+								pop();
+							}
+						}));
+					}
+					for (thread& worker : workers) worker.join();
+					double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+					return totalPairs / seconds / 1e6;
+				};
+
+				alg::Stack<int> locked;
+				mutex lock;
+				double lockedRate = measure([&](int item) {
+					lock_guard<mutex> guard(lock);
+					locked.push(item);
+				}, [&]() {
+					lock_guard<mutex> guard(lock);
+					if (!locked.is_empty()) locked.pop();
+				});
+
+				alg::ConcurrentStack<int> plain(1024, false);
+				double plainRate = measure([&](int item) { plain.push(item); }, [&]() {
+					int item;
+					plain.try_pop(item);
+				});
+
+				alg::ConcurrentStack<int> eliminating(1024, true);
+				double eliminatingRate = measure([&](int item) { eliminating.push(item); }, [&]() {
+					int item;
+					eliminating.try_pop(item);
+				});
+
+				cout << threads << " threads: " << lockedRate << " / " << plainRate << " / " << eliminatingRate << "\n";
+			}
 		}
 
 		static void test_queue() {
@@ -107,6 +469,347 @@ namespace alg {
 			while (!q.is_empty()) {
 				cout << "dequeueing value: " << q.dequeue() << "\n";
 			}
+
+			alg::Queue<int, true> masked(5);
+			cout << "capacity of a power of two queue created for 5 elements: " << masked.getCapacity() << "\n";
+			int values[] = { 1, 2, 3, 4, 5, 6 };
+			masked.enqueue_bulk(values, 6);
+			cout << "dequeueing 4 values in bulk: " << masked.dequeue_bulk(values, 4) << "\n";
+			cout << "enqueueing 6 values in bulk: " << masked.enqueue_bulk(values, 6) << " fit\n";
+			cout << masked.toString();
+			alg::Queue<int, true>::Regions readable = masked.readable_regions();
+			cout << "readable in place:";
+			for (int value : readable.first) cout << " " << value;
+			cout << " |";
+			for (int value : readable.second) cout << " " << value;
+			cout << "\n";
+			masked.commit_read(readable.size());
+
+			// moving a stream of ints through a queue one by one versus in blocks of 64
+			const int count = 50000000;
+			const int blockSize = 64;
+			auto run = [count](const char* name, auto transfer) {
+				auto start = chrono::steady_clock::now();
+				long long sum = transfer();
+				double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+				cout << "  " << name << ": " << count / seconds / 1e6 << " million items per second (sum " << sum << ")\n";
+			};
+			auto oneByOne = [count, blockSize](auto& queue) {
+				long long sum = 0;
+				for (int i = 0; i < count; i += blockSize) {
+					for (int j = 0; j < blockSize; j++) queue.enqueue(i + j);
+					for (int j = 0; j < blockSize; j++) sum += queue.dequeue();
+				}
+				return sum;
+			};
+
+			cout << "Transferring " << count << " ints through a queue of 1000 (1024) elements:\n";
+			alg::Queue<int> plain(1000);
+			alg::Queue<int, true> powerOfTwo(1000);
+			run("enqueue/dequeue", [&]() { return oneByOne(plain); });
+			run("enqueue/dequeue, power of two", [&]() { return oneByOne(powerOfTwo); });
+			run("enqueue_bulk/dequeue_bulk", [&]() {
+				long long sum = 0;
+				int block[blockSize];
+				for (int i = 0; i < count; i += blockSize) {
+					for (int j = 0; j < blockSize; j++) block[j] = i + j;
+					powerOfTwo.enqueue_bulk(block, blockSize);
+					powerOfTwo.dequeue_bulk(block, blockSize);
+					for (int j = 0; j < blockSize; j++) sum += block[j];
+				}
+				return sum;
+			});
+			run("writable/readable regions", [&]() {
+				long long sum = 0;
+				for (int i = 0; i < count; i += blockSize) {
+					alg::Queue<int, true>::Regions writable = powerOfTwo.writable_regions();
+					int written = 0;
+					for (int& slot : writable.first) {
+						if (written == blockSize) break;
+						slot = i + written++;
+					}
+					for (int& slot : writable.second) {
+						if (written == blockSize) break;
+						slot = i + written++;
+					}
+					powerOfTwo.commit_write(written);
+
+					alg::Queue<int, true>::Regions readable = powerOfTwo.readable_regions();
+					for (int value : readable.first) sum += value;
+					for (int value : readable.second) sum += value;
+					powerOfTwo.commit_read(readable.size());
+				}
+				return sum;
+			});
+		}
+
+		static void test_deque() {
+			cout << "Deque test!\n";
+			alg::Deque<int> d;
+			for (int i = 1; i <= 3; i++) {
+				cout << "pushing " << i << " to the back and " << -i << " to the front\n";
+				d.push_back(i);
+				d.push_front(-i);
+			}
+			cout << d.toString();
+			cout << "indexing element at position 2: " << d[2] << "\n";
+			cout << "popping from the front: " << d.pop_front() << ", from the back: " << d.pop_back() << "\n";
+			cout << d.toString();
+
+			// a burst far larger than a block, then back to empty: the blocks follow the size
+			int burst = alg::Deque<int>::getBlockSize() * 100;
+			for (int i = 0; i < burst; i++) d.push_back(i);
+			cout << "blocks in use after a burst of " << burst << " elements: " << d.getBlockCount();
+			while (!d.is_empty()) d.pop_front();
+			cout << ", once drained again: " << d.getBlockCount() << "\n";
+
+			// bursty producer: the queue fills up to <burst> elements and drains again, over and
+			// over; half the rounds push to the front and pop from the back instead
+			const int rounds = 200;
+			auto run = [&](const char* name, auto& queue, auto pushBack, auto pushFront, auto popBack, auto popFront) {
+				auto start = chrono::steady_clock::now();
+				long long sum = 0;
+				for (int round = 0; round < rounds; round++) {
+					if (round % 2 == 0) {
+						for (int i = 0; i < burst; i++) pushBack(queue, i);
+						for (int i = 0; i < burst; i++) sum += popFront(queue);
+					}
+					else {
+						for (int i = 0; i < burst; i++) pushFront(queue, i);
+						for (int i = 0; i < burst; i++) sum += popBack(queue);
+					}
+				}
+				double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+				cout << "  " << name << ": " << 2.0 * rounds * burst / seconds / 1e6
+					<< " million operations per second (sum " << sum << ")\n";
+			};
+
+			cout << "Pushing and popping bursts of " << burst << " ints " << rounds << " times:\n";
+			alg::Deque<int> deque;
+			run("alg::Deque", deque,
+				[](alg::Deque<int>& q, int v) { q.push_back(v); },
+				[](alg::Deque<int>& q, int v) { q.push_front(v); },
+				[](alg::Deque<int>& q) { return q.pop_back(); },
+				[](alg::Deque<int>& q) { return q.pop_front(); });
+			std::deque<int> standard;
+			run("std::deque", standard,
+				[](std::deque<int>& q, int v) { q.push_back(v); },
+				[](std::deque<int>& q, int v) { q.push_front(v); },
+				[](std::deque<int>& q) { int v = q.back(); q.pop_back(); return v; },
+				[](std::deque<int>& q) { int v = q.front(); q.pop_front(); return v; });
+		}
+
+		static void test_spsc_queue() {
+			cout << "SPSC queue test!\n";
+			alg::SPSCQueue<int> q(4);
+			for (int i = 1; i <= 5; i++) {
+				cout << "enqueueing value " << i << ": " << q.try_enqueue(i) << "\n";
+			}
+			int value;
+			while (q.try_dequeue(value)) {
+				cout << "dequeueing value: " << value << "\n";
+			}
+
+			int batch[] = { 1, 2, 3, 4, 5, 6 };
+			cout << "enqueueing 6 values in bulk: " << q.try_enqueue_bulk(batch, 6) << " fit\n";
+			cout << "dequeueing in bulk: " << q.try_dequeue_bulk(batch, 6) << " values\n";
+			cout << "bulk calls with a negative count move " << q.try_enqueue_bulk(batch, -1)
+				<< " and " << q.try_dequeue_bulk(batch, -1) << " values\n";
+
+			// throughput: one producer thread hands ints to one consumer thread
+			const int count = 10000000;
+			const int batchSize = 64;
+			auto run = [count](auto produce, auto consume) {
+				auto start = chrono::steady_clock::now();
+				thread consumer(consume);
+				produce();
+				consumer.join();
+				return count / chrono::duration<double>(chrono::steady_clock::now() - start).count() / 1e6;
+			};
+
+			long long sums[3] = { 0, 0, 0 };
+			alg::Queue<int> locked(1024);
+			mutex lock;
+			double lockedRate = run([&]() {
+				for (int i = 0; i < count; i++) {
+					while (true) {
+						{
+							lock_guard<mutex> guard(lock);
+							if (locked.enqueue(i)) break;
+						}
+						this_thread::yield();
+					}
+				}
+			}, [&]() {
+				for (int i = 0; i < count; i++) {
+					while (true) {
+						{
+							lock_guard<mutex> guard(lock);
+							if (!locked.is_empty()) {
+								sums[0] += locked.dequeue();
+								break;
+							}
+						}
+						this_thread::yield();
+					}
+				}
+			});
+
+			alg::SPSCQueue<int> spsc(1024);
+			double spscRate = run([&]() {
+				for (int i = 0; i < count; i++) {
+					while (!spsc.try_enqueue(i)) this_thread::yield();
+				}
+			}, [&]() {
+				for (int i = 0; i < count; i++) {
+					int item;
+					while (!spsc.try_dequeue(item)) this_thread::yield();
+					sums[1] += item;
+				}
+			});
+
+			double bulkRate = run([&]() {
+				int items[batchSize];
+				for (int i = 0; i < count; i += batchSize) {
+					int size = count - i < batchSize ? count - i : batchSize;
+					for (int j = 0; j < size; j++) items[j] = i + j;
+					for (int sent = 0; sent < size;) {
+						int enqueued = spsc.try_enqueue_bulk(items + sent, size - sent);
+						if (enqueued == 0) this_thread::yield();
+						sent += enqueued;
+					}
+				}
+			}, [&]() {
+				int items[batchSize];
+				for (int received = 0; received < count;) {
+					int dequeued = spsc.try_dequeue_bulk(items, batchSize);
+					if (dequeued == 0) this_thread::yield();
+					for (int j = 0; j < dequeued; j++) sums[2] += items[j];
+					received += dequeued;
+				}
+			});
+
+			cout << "Million items per second: mutex + Queue " << lockedRate << ", SPSCQueue " << spscRate
+				<< ", SPSCQueue in batches of " << batchSize << " " << bulkRate << " (sums "
+				<< (sums[0] == sums[1] && sums[1] == sums[2] ? "match" : "differ") << ")\n";
+		}
+
+		static void test_mpmc_queue() {
+			cout << "MPMC queue test!\n";
+			alg::MPMCQueue<int> q(3);
+			cout << "capacity of a queue created for 3 elements: " << q.getCapacity() << "\n";
+			for (int i = 1; i <= 5; i++) {
+				cout << "enqueueing value " << i << ": " << q.try_enqueue(i) << "\n";
+			}
+			int value;
+			while (q.try_dequeue(value)) {
+				cout << "dequeueing value: " << value << "\n";
+			}
+
+			// throughput and enqueue latency with several producers and consumers; every producer
+			// sends <count> / producers ints and the consumers take them until all have arrived
+			const int count = 2000000;
+			const int configurations[][2] = { { 1, 1 }, { 2, 2 }, { 4, 4 }, { 8, 8 }, { 1, 4 }, { 4, 1 } };
+
+			struct Result {
+				double rate;
+				double p50, p99, p999; // enqueue latency in nanoseconds
+				long long sum;
+			};
+			auto run = [count](int producers, int consumers, auto enqueue, auto dequeue) {
+				int perProducer = count / producers;
+				int total = perProducer * producers;
+				vector<vector<long long>> latencies(producers);
+				atomic<int> received(0);
+				atomic<long long> sum(0);
+
+				auto start = chrono::steady_clock::now();
+				vector<thread> threads;
+				for (int p = 0; p < producers; p++) {
+					threads.emplace_back([&, p]() {
+						vector<long long>& samples = latencies[p];
+						samples.reserve(perProducer);
+						for (int i = 0; i < perProducer; i++) {
+							auto before = chrono::steady_clock::now();
+							enqueue(i);
+							samples.push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - before).count());
+						}
+					});
+				}
+				for (int c = 0; c < consumers; c++) {
+					threads.emplace_back([&]() {
+						long long local = 0;
+						int item;
+						while (received.load(memory_order_relaxed) < total) {
+							if (dequeue(item)) {
+								local += item;
+								received.fetch_add(1, memory_order_relaxed);
+							}
+							else {
+								this_thread::yield();
+							}
+						}
+						sum += local;
+					});
+				}
+				for (thread& t : threads) t.join();
+				double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+				vector<long long> all;
+				for (vector<long long>& samples : latencies) all.insert(all.end(), samples.begin(), samples.end());
+				auto percentile = [&all](double p) {
+					size_t index = (size_t)(p * (all.size() - 1));
+					nth_element(all.begin(), all.begin() + index, all.end());
+					return (double)all[index];
+				};
+
+				Result result;
+				result.rate = total / seconds / 1e6;
+				result.p50 = percentile(0.5);
+				result.p99 = percentile(0.99);
+				result.p999 = percentile(0.999);
+				result.sum = sum;
+				return result;
+			};
+
+			auto print = [](const char* name, const Result& result) {
+				cout << "  " << name << ": " << result.rate << " million items per second, enqueue latency p50 "
+					<< result.p50 << "ns, p99 " << result.p99 << "ns, p99.9 " << result.p999 << "ns\n";
+			};
+
+			for (const auto& configuration : configurations) {
+				int producers = configuration[0];
+				int consumers = configuration[1];
+
+				alg::Queue<int> locked(1024);
+				mutex lock;
+				Result lockedResult = run(producers, consumers, [&](int item) {
+					while (true) {
+						{
+							lock_guard<mutex> guard(lock);
+							if (locked.enqueue(item)) return;
+						}
+						this_thread::yield();
+					}
+				}, [&](int& item) {
+					lock_guard<mutex> guard(lock);
+					if (locked.is_empty()) return false;
+					item = locked.dequeue();
+					return true;
+				});
+
+				alg::MPMCQueue<int> mpmc(1024);
+				Result mpmcResult = run(producers, consumers, [&](int item) {
+					while (!mpmc.try_enqueue(item)) this_thread::yield();
+				}, [&](int& item) {
+					return mpmc.try_dequeue(item);
+				});
+
+				cout << producers << " producers, " << consumers << " consumers (sums "
+					<< (lockedResult.sum == mpmcResult.sum ? "match" : "differ") << "):\n";
+				print("mutex + Queue", lockedResult);
+				print("MPMCQueue", mpmcResult);
+			}
 		}
 
 		static void test_bst() {
@@ -144,6 +847,388 @@ namespace alg {
 			cout << "Deleting value 3 (root plus two children):\n";
 			bst.deleteKey(3);
 			cout << bst.toString();
+
+			cout << "In-order walk:";
+			for (auto entry : bst) cout << " " << entry.first;
+			cout << "\nlower_bound(5): " << bst.lower_bound(5).key() << ", upper_bound(5): " << bst.upper_bound(5).key() << "\n";
+			cout << "Range scan of [2, 6]:";
+			bst.range(2, 6, [](const int& key, double& value) { cout << " " << key << ": " << value; });
+			cout << "\n";
+
+			// bulk loading a sorted snapshot versus inserting it key by key (which degenerates
+			// into a linked list for sorted input)
+			{
+				const int size = 20000;
+				vector<int> sortedKeys(size);
+				for (int i = 0; i < size; i++) sortedKeys[i] = i;
+
+				alg::BST<int, int> inserted, loaded;
+				auto start = chrono::steady_clock::now();
+				for (int key : sortedKeys) inserted.insert(key, key);
+				auto middle = chrono::steady_clock::now();
+				loaded.bulkLoad(sortedKeys.data(), sortedKeys.data(), size);
+				auto end = chrono::steady_clock::now();
+				cout << size << " sorted keys: insert " << chrono::duration<double, milli>(middle - start).count()
+					<< "ms, bulkLoad " << chrono::duration<double, milli>(end - middle).count() << "ms\n";
+			}
+
+			// node pool versus the global heap: build, churn and tear down a large tree
+			const int size = 1000000;
+			vector<int> keys(size);
+			for (int i = 0; i < size; i++) keys[i] = i;
+			shuffle(keys.begin(), keys.end(), default_random_engine(2));
+
+			auto run = [&keys](auto& tree) {
+				auto start = chrono::steady_clock::now();
+				for (int key : keys) tree.insert(key, key);
+				for (int i = 0; i < (int)keys.size(); i += 2) {
+					tree.deleteKey(keys[i]);
+					tree.insert(keys[i], keys[i]);
+				}
+				auto middle = chrono::steady_clock::now();
+				tree.clear();
+				auto end = chrono::steady_clock::now();
+				cout << chrono::duration<double, milli>(middle - start).count() << "ms to build and churn, "
+					<< chrono::duration<double, milli>(end - middle).count() << "ms to clear\n";
+			};
+			{
+				alg::BST<int, int, std::allocator<int>> heapTree;
+				cout << size << " nodes with std::allocator: ";
+				run(heapTree);
+			}
+			{
+				alg::BST<int, int> pooledTree;
+				cout << size << " nodes with NodePool: ";
+				run(pooledTree);
+			}
+		}
+
+		static void test_frozen_bst() {
+			cout << "Frozen BST test!\n";
+			alg::BST<int, int> bst;
+			array<int, 10> numbers = { 5, 2, 8, 1, 9, 3, 7, 3, 0, 6 };
+			for (int i = 0; i < (int)numbers.size(); i++) bst.insert(numbers[i], i);
+			alg::FrozenBST<int, int> frozen = bst.freeze();
+			cout << "Frozen from a bst of " << bst.getSize() << " keys (3 twice):";
+			frozen.forEach([](const int& key, const int& value) { cout << " " << key << ": " << value; });
+			cout << "\nValue of 3: bst " << bst.getValue(3) << ", frozen " << frozen.getValue(3)
+				<< "; contains 4: " << (frozen.contains(4) ? "yes" : "no") << "\n";
+
+			// every key of a random tree, and the gaps between them, against the pointer tree
+			const int size = 1000000;
+			vector<int> keys(size);
+			for (int i = 0; i < size; i++) keys[i] = 2 * i;
+			shuffle(keys.begin(), keys.end(), mt19937(4));
+			alg::BST<int, int> tree;
+			for (int key : keys) tree.insert(key, key + 1);
+			auto start = chrono::steady_clock::now();
+			alg::FrozenBST<int, int> index = tree.freeze();
+			cout << "Freezing " << size << " keys took "
+				<< chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << "ms\n";
+
+			bool same = true;
+			for (int key = -1; key <= 2 * size; key++) {
+				int value = 0;
+				bool found = index.find(key, value);
+				same = same && found == (key >= 0 && key < 2 * size && key % 2 == 0) && (!found || value == key + 1);
+			}
+			cout << "Lookups agree with the bst: " << (same ? "yes" : "no") << "\n";
+
+			// random lookups: pointer chasing versus the flat index, one by one and in batches
+			vector<int> lookups(4000000);
+			mt19937 rng(5);
+			for (int& key : lookups) key = keys[rng() % size];
+			long long bstSum = 0, frozenSum = 0, batchSum = 0;
+			start = chrono::steady_clock::now();
+			for (int key : lookups) bstSum += tree.getValue(key);
+			double bstTime = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / lookups.size();
+			start = chrono::steady_clock::now();
+			for (int key : lookups) {
+				int value = 0;
+				index.find(key, value);
+				frozenSum += value;
+			}
+			double frozenTime = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / lookups.size();
+			vector<int> values(lookups.size());
+			unique_ptr<bool[]> found(new bool[lookups.size()]);
+			start = chrono::steady_clock::now();
+			index.findMany(lookups.data(), lookups.size(), values.data(), found.get());
+			double batchTime = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / lookups.size();
+			for (int value : values) batchSum += value;
+			cout << "Per lookup in " << size << " keys: bst " << bstTime << "ns, frozen " << frozenTime << "ns, frozen batched "
+				<< batchTime << "ns (sums " << (bstSum == frozenSum && frozenSum == batchSum ? "match" : "differ") << ")\n";
+		}
+
+		static void test_red_black_tree() {
+			cout << "Red-black tree test!\n";
+			alg::RBTree<int, double> tree;
+
+			cout << "Inserting keys 0 to 9 in order (a plain BST would become a linked list):\n";
+			for (int i = 0; i < 10; i++) {
+				tree.insert(i, i);
+			}
+			cout << tree.toString();
+
+			cout << "Finding value for key \"5\": " << to_string(tree.getValue(5)) << "\n";
+
+			cout << "Deleting value 3 (two children):\n";
+			tree.deleteKey(3);
+			cout << tree.toString();
+
+			cout << "Deleting value 9 (leaf):\n";
+			tree.deleteKey(9);
+			cout << tree.toString();
+
+			// benchmark: sorted and random insert workloads, then a lookup of every key
+			const int size = 20000;
+			vector<int> sortedKeys(size);
+			for (int i = 0; i < size; i++) {
+				sortedKeys[i] = i;
+			}
+			vector<int> randomKeys = sortedKeys;
+			shuffle(randomKeys.begin(), randomKeys.end(), default_random_engine(1));
+
+			for (int workload = 0; workload < 2; workload++) {
+				const vector<int>& keys = workload == 0 ? sortedKeys : randomKeys;
+				alg::BST<int, int> bst;
+				alg::RBTree<int, int> rbTree;
+
+				auto start = chrono::steady_clock::now();
+				for (int key : keys) bst.insert(key, key);
+				for (int key : keys) bst.getValue(key);
+				auto middle = chrono::steady_clock::now();
+				for (int key : keys) rbTree.insert(key, key);
+				for (int key : keys) rbTree.getValue(key);
+				auto end = chrono::steady_clock::now();
+
+				cout << size << (workload == 0 ? " sorted" : " random") << " inserts + lookups: BST "
+					<< chrono::duration<double, milli>(middle - start).count() << "ms, RBTree "
+					<< chrono::duration<double, milli>(end - middle).count() << "ms\n";
+			}
+		}
+
+		static void test_order_statistic_tree() {
+			cout << "Order statistic tree test!\n";
+			alg::OrderStatisticTree<int, double> tree;
+
+			cout << "Inserting keys 0 to 9 in order ([subtree size]):\n";
+			for (int i = 0; i < 10; i++) {
+				tree.insert(i * 10, i);
+			}
+			cout << tree.toString();
+			cout << "rankOf(35): " << tree.rankOf(35) << ", selectKth(4): " << tree.selectKth(4) << "\n";
+
+			cout << "Deleting 30 (two children) and 90 (leaf):\n";
+			tree.deleteKey(30);
+			tree.deleteKey(90);
+			cout << tree.toString();
+			cout << "Keys with index [2, 5):";
+			tree.visit(2, 3, [](const int& key, double&) { cout << " " << key; });
+			cout << "\n";
+
+			// bulk load, then random inserts and deletes, checked against a sorted std::multiset
+			alg::OrderStatisticTree<int, int> checked;
+			multiset<int> reference;
+			vector<int> evens(2500);
+			for (int i = 0; i < 2500; i++) {
+				evens[i] = i * 2;
+				reference.insert(i * 2);
+			}
+			checked.bulkLoad(evens.data(), evens.data(), (int)evens.size());
+			mt19937 rng(3);
+			bool matches = true;
+			for (int i = 0; i < 200000; i++) {
+				int key = (int)(rng() % 5000);
+				if (rng() % 3 == 0) {
+					bool found = reference.count(key) > 0;
+					if (found) reference.erase(reference.find(key));
+					matches = matches && checked.deleteKey(key) == found;
+				}
+				else {
+					reference.insert(key);
+					checked.insert(key, key);
+				}
+				if (i % 1000 == 0) {
+					int index = reference.empty() ? 0 : (int)(rng() % reference.size());
+					matches = matches && checked.getSize() == (int)reference.size();
+					matches = matches && checked.rankOf(key) == (int)distance(reference.begin(), reference.lower_bound(key));
+					if (!reference.empty()) matches = matches && checked.selectKth(index) == *next(reference.begin(), index);
+				}
+			}
+			cout << "Bulk load of 2500 keys and 200000 random inserts and deletes, sizes, ranks and selects match std::multiset: "
+				<< (matches ? "yes" : "no") << "\n";
+		}
+
+		static void test_b_plus_tree() {
+			cout << "B+ tree test!\n";
+			alg::BPlusTree<int, double, 64> tree;
+
+			cout << "Inserting keys 0 to 19 with small (64 byte) nodes:\n";
+			for (int i = 0; i < 20; i++) {
+				tree.insert(i, i);
+			}
+			cout << tree.toString();
+
+			cout << "Finding value for key \"5\": " << to_string(tree.getValue(5)) << "\n";
+
+			cout << "Deleting keys 0 to 9:\n";
+			for (int i = 0; i < 10; i++) {
+				tree.deleteKey(i);
+			}
+			cout << tree.toString();
+
+			cout << "Range scan of [12, 15]: ";
+			tree.range(12, 15, [](int key, double value) {
+				cout << key << ": " << value << " ";
+			});
+			cout << "\n";
+
+			// benchmark: random lookups in a large tree
+			const int size = 1000000;
+			vector<int> keys(size);
+			for (int i = 0; i < size; i++) {
+				keys[i] = i;
+			}
+			shuffle(keys.begin(), keys.end(), default_random_engine(1));
+
+			alg::RBTree<int, int> rbTree;
+			alg::BPlusTree<int, int> bPlusTree;
+			for (int key : keys) {
+				rbTree.insert(key, key);
+				bPlusTree.insert(key, key);
+			}
+			shuffle(keys.begin(), keys.end(), default_random_engine(2));
+
+			long long checksum = 0;
+			auto start = chrono::steady_clock::now();
+			for (int key : keys) checksum += rbTree.getValue(key);
+			auto middle = chrono::steady_clock::now();
+			for (int key : keys) checksum -= bPlusTree.getValue(key);
+			auto end = chrono::steady_clock::now();
+
+			cout << size << " random lookups: RBTree " << chrono::duration<double, milli>(middle - start).count()
+				<< "ms, BPlusTree " << chrono::duration<double, milli>(end - middle).count()
+				<< "ms (height " << bPlusTree.getHeight() << "), checksum " << checksum << "\n";
+		}
+
+		static void test_concurrent_skip_list() {
+			cout << "Concurrent skip list test!\n";
+			alg::ConcurrentSkipList<int, double> list;
+
+			cout << "Inserting keys 0 to 9\n";
+			for (int i = 0; i < 10; i++) {
+				list.insert(i, i);
+			}
+			cout << "Inserting key 5 again: " << (list.insert(5, 50) ? "inserted" : "already there") << "\n";
+			cout << "Finding value for key \"5\": " << to_string(list.getValue(5)) << "\n";
+			bool deleted = list.deleteKey(5);
+			cout << "Deleting key 5: " << deleted;
+			deleted = list.deleteKey(5);
+			cout << ", again: " << deleted << "\n";
+
+			// stress test: threads race on a small key range; every successful insert and delete
+			// is counted per key, so afterwards a key has to be in the map exactly when its
+			// inserts outnumber its deletes
+			{
+				const int threads = 8;
+				const int keyRange = 512;
+				const int operations = 100000;
+				alg::ConcurrentSkipList<int, int> shared;
+				vector<vector<int>> balance(threads, vector<int>(keyRange, 0));
+				vector<int> badValues(threads, 0);
+
+				vector<thread> workers;
+				for (int t = 0; t < threads; t++) {
+					workers.push_back(thread([&shared, &balance, &badValues, t, keyRange, operations]() {
+						mt19937 rng(t);
+						for (int i = 0; i < operations; i++) {
+							int key = (int)(rng() % keyRange);
+							int value;
+							switch (rng() % 3) {
+							case 0:
+								if (shared.insert(key, key * 2)) balance[t][key]++;
+								break;
+							case 1:
+								if (shared.deleteKey(key)) balance[t][key]--;
+								break;
+							default:
+								if (shared.tryGetValue(key, value) && value != key * 2) badValues[t]++;
+							}
+						}
+					}));
+				}
+				for (thread& worker : workers) worker.join();
+
+				int errors = 0;
+				for (int key = 0; key < keyRange; key++) {
+					int total = 0;
+					for (int t = 0; t < threads; t++) total += balance[t][key];
+					if (total != (shared.contains(key) ? 1 : 0)) errors++;
+				}
+				for (int t = 0; t < threads; t++) errors += badValues[t];
+				alg::EpochCollect();
+				cout << "Stress test with " << threads << " threads: " << errors << " errors\n";
+			}
+
+			// throughput versus a BST behind one mutex; a write deletes and reinserts a key
+			cout << "Throughput in million operations per second (skip list / BST with a mutex):\n";
+			const int keyRange = 1 << 16;
+			const int totalOperations = 400000;
+			vector<int> keys(keyRange);
+			for (int i = 0; i < keyRange; i++) keys[i] = i;
+			shuffle(keys.begin(), keys.end(), default_random_engine(3));
+
+			for (int readPercent : { 90, 50 }) {
+				for (int threads : { 1, 2, 4, 8, 16, 32 }) {
+					alg::ConcurrentSkipList<int, int> skipList;
+					alg::BST<int, int> bst;
+					mutex bstMutex;
+					for (int key : keys) {
+						skipList.insert(key, key);
+						bst.insert(key, key);
+					}
+
+					auto measure = [threads, readPercent, keyRange](auto operation) {
+						vector<thread> workers;
+						auto start = chrono::steady_clock::now();
+						for (int t = 0; t < threads; t++) {
+							workers.push_back(thread([&operation, t, threads, readPercent, keyRange]() {
+								mt19937 rng(t);
+								for (int i = 0; i < totalOperations / threads; i++) {
+									int key = (int)(rng() % keyRange);
+									operation(key, (int)(rng() % 100) < readPercent);
+								}
+							}));
+						}
+						for (thread& worker : workers) worker.join();
+						double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+						return totalOperations / seconds / 1e6;
+					};
+
+					double skipListRate = measure([&skipList](int key, bool read) {
+						int value;
+						if (read) {
+							skipList.tryGetValue(key, value);
+						}
+						else {
+							skipList.deleteKey(key);
+							skipList.insert(key, key);
+						}
+					});
+					double bstRate = measure([&bst, &bstMutex](int key, bool read) {
+						lock_guard<mutex> lock(bstMutex);
+						if (read) {
+							bst.getValue(key);
+						}
+						else {
+							bst.deleteKey(key);
+							bst.insert(key, key);
+						}
+					});
+
+					cout << readPercent << "% reads, " << threads << " threads: " << skipListRate << " / " << bstRate << "\n";
+				}
+			}
 		}
 
 		static void test_linked_list() {
@@ -171,6 +1256,153 @@ namespace alg {
 
 			cout << "Popping from the back: " << linkedList.popLast() << "\n";
 			cout << linkedList.toString();
+
+			LinkedList<int> other;
+			for (int i = 4; i <= 6; i++) other.pushLast(i);
+			linkedList.pushLast(2);
+			linkedList.pushLast(3);
+			cout << "Splicing [4]->[5]->[6] onto the back:\n";
+			linkedList.splice(other);
+			cout << linkedList.toString();
+			cout << "Size: " << linkedList.getSize() << ", last element: " << linkedList.peekLast() << "\n";
+			linkedList.clear();
+
+			const int size = 1000000;
+			auto run = [size](auto& list) {
+				auto start = chrono::steady_clock::now();
+				for (int i = 0; i < size; i++) list.push(i);
+				auto middle = chrono::steady_clock::now();
+				list.clear();
+				auto end = chrono::steady_clock::now();
+				cout << chrono::duration<double, milli>(middle - start).count() << "ms to push, "
+					<< chrono::duration<double, milli>(end - middle).count() << "ms to clear\n";
+			};
+			{
+				LinkedList<int, std::allocator<int>> heapList;
+				cout << size << " elements with std::allocator: ";
+				run(heapList);
+			}
+			{
+				LinkedList<int> pooledList;
+				cout << size << " elements with NodePool: ";
+				run(pooledList);
+
+				// used to walk the whole list on every call
+				auto start = chrono::steady_clock::now();
+				for (int i = 0; i < size; i++) pooledList.pushLast(i);
+				long long sum = 0;
+				while (!pooledList.isEmpty()) sum += pooledList.popLast();
+				cout << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()
+					<< "ms to pushLast and popLast " << size << " elements (sum " << sum << ")\n";
+			}
+		}
+
+		struct CacheEntry : alg::IntrusiveListHook<> {
+			int key;
+			int value;
+		};
+
+		static void test_intrusive_list() {
+			cout << "Intrusive list test!\n";
+
+			// a tiny LRU cache: the entries live in a vector and the list only orders them
+			vector<CacheEntry> entries(4);
+			alg::IntrusiveList<CacheEntry> lru;
+			for (int i = 0; i < 4; i++) {
+				entries[i].key = i;
+				entries[i].value = i * 10;
+				lru.pushLast(entries[i]);
+			}
+			auto print = [&lru]() {
+				cout << "  least recently used first:";
+				for (CacheEntry& entry : lru) cout << " " << entry.key;
+				cout << "\n";
+			};
+			print();
+			cout << "Using key 1 and key 0:\n";
+			lru.moveToBack(entries[1]);
+			lru.moveToBack(entries[0]);
+			print();
+			CacheEntry& evicted = lru.pop();
+			cout << "Evicting key " << evicted.key << " (still linked: " << evicted.isLinked() << ")\n";
+			print();
+
+			alg::IntrusiveList<CacheEntry> other;
+			other.pushLast(evicted);
+			lru.splice(other);
+			cout << "Splicing it back: ";
+			print();
+
+			// moving an element to the back of the list from a pointer to it, versus the usual
+			// std::list plus a map from key to list position
+			const int size = 10000;
+			const int touches = 1000000;
+			vector<CacheEntry> many(size);
+			alg::IntrusiveList<CacheEntry> intrusive;
+			std::list<int> keys;
+			unordered_map<int, std::list<int>::iterator> positions;
+			for (int i = 0; i < size; i++) {
+				many[i].key = i;
+				intrusive.pushLast(many[i]);
+				positions[i] = keys.insert(keys.end(), i);
+			}
+			mt19937 rng(7);
+			vector<int> order(touches);
+			for (int& key : order) key = (int)(rng() % size);
+
+			auto start = chrono::steady_clock::now();
+			for (int key : order) intrusive.moveToBack(many[key]);
+			auto middle = chrono::steady_clock::now();
+			for (int key : order) keys.splice(keys.end(), keys, positions[key]);
+			auto end = chrono::steady_clock::now();
+			cout << touches << " LRU touches over " << size << " entries: IntrusiveList "
+				<< chrono::duration<double, milli>(middle - start).count() << "ms, std::list + unordered_map "
+				<< chrono::duration<double, milli>(end - middle).count() << "ms (same order: "
+				<< (intrusive.peek().key == keys.front() ? "yes" : "no") << ")\n";
+		}
+
+		static void test_unrolled_list() {
+			cout << "Unrolled list test!\n";
+			alg::UnrolledList<int, 32> list;
+			cout << "Elements per node with 32 byte nodes: " << list.getElementsPerNode() << "\n";
+			for (int i = 0; i < 10; i++) list.pushLast(i);
+			cout << list.toString();
+			cout << "Inserting 100 at index 2 (splits the full node):\n";
+			list.insert(2, 100);
+			cout << list.toString();
+			cout << "Erasing index 5 and 6:\n";
+			list.erase(5);
+			list.erase(5);
+			cout << list.toString();
+			cout << "Popping " << list.pop() << " from the front and " << list.popLast() << " from the back:\n";
+			cout << list.toString();
+			cout << "Element at index 3: " << list[3] << "\n";
+
+			// summing every element: one node per element, scattered over the heap the way a long
+			// lived list ends up, versus many elements per node
+			const int size = 1000000;
+			const int passes = 20;
+			mt19937 rng(3);
+			std::list<int> linked;
+			for (int i = 0; i < size; i++) linked.push_back((int)(rng() % size));
+			linked.sort(); // relinks the nodes, so neighbours in the list are far apart in memory
+			alg::UnrolledList<int> unrolled;
+			for (int value : linked) unrolled.pushLast(value);
+
+			auto start = chrono::steady_clock::now();
+			long long unrolledSum = 0;
+			for (int pass = 0; pass < passes; pass++) {
+				for (int value : unrolled) unrolledSum += value;
+			}
+			auto middle = chrono::steady_clock::now();
+			long long linkedSum = 0;
+			for (int pass = 0; pass < passes; pass++) {
+				for (int value : linked) linkedSum += value;
+			}
+			auto end = chrono::steady_clock::now();
+			cout << passes << " passes over " << size << " ints: UnrolledList " << chrono::duration<double, milli>(middle - start).count()
+				<< "ms, std::list " << chrono::duration<double, milli>(end - middle).count() << "ms (sums "
+				<< (unrolledSum == linkedSum ? "match" : "differ") << ")\n";
 		}
 
 		static void test_elo() {
@@ -194,6 +1426,557 @@ namespace alg {
 			playerA = (int)round(get<0>(EloEvaluate(playerA, 1720, 0)));
 			cout << "Player A loses to a player rated 1720. Their new elo is " << playerA << "\n";
 
+			// replaying a season: random pairings between <players>, random results
+			const int players = 10000;
+			const int games = 10000000;
+			vector<int> playersA(games), playersB(games);
+			vector<double> resultsA(games);
+			mt19937 rng(11);
+			for (int i = 0; i < games; i++) {
+				playersA[i] = (int)(rng() % players);
+				playersB[i] = (int)((playersA[i] + 1 + rng() % (players - 1)) % players);
+				resultsA[i] = (rng() % 3) * 0.5;
+			}
+
+			// the same games through the per game function (kept in doubles here, it truncates
+			// to int otherwise), the batch without SIMD and the batch
+			vector<double> reference(players, 1500.0), scalar(players, 1500.0), batch(players, 1500.0);
+			auto start = chrono::steady_clock::now();
+			for (int i = 0; i < games; i++) {
+				double a = reference[playersA[i]];
+				double b = reference[playersB[i]];
+				double qA = pow(10, a / 400);
+				double qB = pow(10, b / 400);
+				reference[playersA[i]] = a + KVALUE * (resultsA[i] - qA / (qA + qB));
+				reference[playersB[i]] = b + KVALUE * ((1.0 - resultsA[i]) - qB / (qA + qB));
+			}
+			auto afterReference = chrono::steady_clock::now();
+			alg::elo_detail::evaluateScalar(scalar.data(), playersA.data(), playersB.data(), resultsA.data(), games, KVALUE);
+			auto afterScalar = chrono::steady_clock::now();
+			EloEvaluateBatch(batch.data(), playersA.data(), playersB.data(), resultsA.data(), games);
+			auto afterBatch = chrono::steady_clock::now();
+
+			double maxDifference = 0;
+			bool identical = true;
+			for (int i = 0; i < players; i++) {
+				maxDifference = max(maxDifference, fabs(batch[i] - reference[i]));
+				identical = identical && batch[i] == scalar[i];
+			}
+			auto rate = [games](chrono::steady_clock::time_point from, chrono::steady_clock::time_point to) {
+				return games / chrono::duration<double>(to - from).count() / 1e6;
+			};
+			cout << "Replaying " << games << " games between " << players << " players, million games per second: pow "
+				<< rate(start, afterReference) << ", batch without SIMD " << rate(afterReference, afterScalar)
+				<< ", batch" << (GetCpuFeatures().avx2 ? " (AVX2) " : " ") << rate(afterScalar, afterBatch) << "\n";
+			cout << "Largest rating difference to the pow version: " << maxDifference
+				<< ", batch identical to the scalar batch: " << (identical ? "yes" : "no") << "\n";
+		}
+
+		static void test_elo_replay() {
+			cout << "Elo replay test!\n";
+			// a season of random pairings; every player plays about 200 games
+			const int players = 100000;
+			const int games = 10000000;
+			vector<int> playersA(games), playersB(games);
+			vector<double> resultsA(games);
+			mt19937 rng(7);
+			for (int i = 0; i < games; i++) {
+				playersA[i] = (int)(rng() % players);
+				playersB[i] = (int)((playersA[i] + 1 + rng() % (players - 1)) % players);
+				resultsA[i] = (rng() % 3) * 0.5;
+			}
+
+			vector<double> serial(players, 1500.0);
+			auto start = chrono::steady_clock::now();
+			EloEvaluateBatch(serial.data(), playersA.data(), playersB.data(), resultsA.data(), games);
+			double serialTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+			start = chrono::steady_clock::now();
+			alg::EloReplay replay(playersA.data(), playersB.data(), resultsA.data(), games, players);
+			double planTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			cout << games << " games between " << players << " players: serial replay " << serialTime
+				<< "ms, splitting into " << replay.getWaveCount() << " waves " << planTime << "ms\n";
+
+			// scaling report: the same schedule on 1 to N threads
+			int maxThreads = max(4, (int)thread::hardware_concurrency());
+			double baseline = 0;
+			for (int threads = 1; threads <= maxThreads; threads *= 2) {
+				vector<double> ratings(players, 1500.0);
+				start = chrono::steady_clock::now();
+				replay.replay(ratings.data(), threads);
+				double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+				if (threads == 1) baseline = elapsed;
+
+				cout << threads << " thread(s): " << elapsed << "ms, speedup " << baseline / elapsed
+					<< ", identical to the serial replay: " << (ratings == serial) << "\n";
+
+				if (threads < maxThreads && threads * 2 > maxThreads) threads = maxThreads / 2;
+			}
+		}
+
+		static void test_elo_store() {
+			cout << "Elo store test!\n";
+			const char* path = "elo_store_test.bin";
+			const char* csvPath = "elo_store_test.csv";
+			const int players = 1000000;
+			const int games = 2000000;
+			remove(path);
+
+			vector<int> playersA(games), playersB(games);
+			vector<double> resultsA(games);
+			mt19937 rng(5);
+			for (int i = 0; i < games; i++) {
+				playersA[i] = (int)(rng() % players);
+				playersB[i] = (int)((playersA[i] + 1 + rng() % (players - 1)) % players);
+				resultsA[i] = (rng() % 3) * 0.5;
+			}
+
+			vector<double> expected(players, 1500.0);
+			EloEvaluateBatch(expected.data(), playersA.data(), playersB.data(), resultsA.data(), games);
+			{
+				alg::EloStore store(path, players);
+				auto start = chrono::steady_clock::now();
+				store.play(playersA.data(), playersB.data(), resultsA.data(), games);
+				double playTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+				start = chrono::steady_clock::now();
+				store.flush();
+				cout << "Played " << games << " games into the store in " << playTime << "ms, flushed in "
+					<< chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << "ms\n";
+			}
+
+			// startup: mapping the store against parsing the same table from CSV
+			{
+				ofstream csv(csvPath);
+				csv.precision(17);
+				for (int i = 0; i < players; i++) csv << i << "," << expected[i] << "\n";
+			}
+			auto start = chrono::steady_clock::now();
+			vector<double> parsed(players);
+			{
+				ifstream csv(csvPath);
+				int id;
+				char comma;
+				double rating;
+				while (csv >> id >> comma >> rating) parsed[id] = rating;
+			}
+			double parseTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			// the stores have to be closed before the file can be removed (on Windows)
+			{
+				start = chrono::steady_clock::now();
+				alg::EloStore reader(path);
+				double openTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+				cout << "Loading " << players << " ratings: CSV " << parseTime << "ms, opening the store "
+					<< openTime << "ms\n";
+
+				bool identical = true;
+				for (int i = 0; i < players; i++) identical = identical && reader.getRating(i) == expected[i];
+				cout << "Store identical to EloEvaluateBatch: " << (identical ? "yes" : "no") << "\n";
+
+				// a second mapping reads while the first one writes; the writer keeps rating == games, so
+				// a read that saw half an update would show them apart
+				{
+					alg::EloStore writer(path, players);
+					atomic<bool> done(false);
+					long long reads = 0, mismatches = 0;
+					thread readerThread([&]() {
+						mt19937 readRng(9);
+						while (!done.load()) {
+							alg::EloRecord record = reader.get((int)(readRng() % 16));
+							mismatches += record.rating != (double)record.games;
+							reads++;
+						}
+					});
+					for (uint32_t round = 1; round <= 200000; round++) writer.set((int)(round % 16), (double)round, round);
+					done = true;
+					readerThread.join();
+					cout << "Concurrent reads: " << reads << ", torn reads: " << mismatches << "\n";
+				}
+
+				// a writer that stalls in the middle of an update (simulated by an odd sequence number
+				// while it holds the store open) keeps readers waiting instead of failing them
+				{
+					alg::EloStore writer(path, players);
+					{
+						fstream file(path, ios::in | ios::out | ios::binary);
+						uint32_t odd = 1;
+						file.seekp(64 + 16 * 42);
+						file.write((const char*)&odd, sizeof(odd));
+					}
+					double waited = 0;
+					thread readerThread([&]() { waited = reader.getRating(42); });
+					this_thread::sleep_for(chrono::milliseconds(200));
+					writer.set(42, 1234.0, 1);
+					readerThread.join();
+					cout << "A reader waiting 200ms on a stalled writer read its update: " << (waited == 1234.0 ? "yes" : "no") << "\n";
+					try {
+						alg::EloStore second(path, players);
+					}
+					catch (exception& e) {
+						cout << "Opening a second writer: " << e.what() << "\n";
+					}
+				}
+
+				// a writer that dies in the middle of an update leaves an odd sequence number behind
+				{
+					fstream file(path, ios::in | ios::out | ios::binary);
+					uint32_t odd = 5;
+					file.seekp(64 + 16 * 42);
+					file.write((const char*)&odd, sizeof(odd));
+				}
+				try {
+					reader.getRating(42);
+				}
+				catch (exception& e) {
+					cout << "Reading it read only: " << e.what() << "\n";
+				}
+				alg::EloStore reopened(path, players);
+				cout << "Torn records after a simulated crash: " << reopened.getTornCount()
+					<< ", player 42 torn after opening for writing: " << reopened.isTorn(42) << "\n";
+				try {
+					reopened.getRating(42);
+				}
+				catch (exception& e) {
+					cout << "Reading it from the writer: " << e.what() << "\n";
+				}
+				try {
+					reopened.play(42, 43, 1.0);
+				}
+				catch (exception& e) {
+					cout << "Playing a game with it: " << e.what() << "\n";
+				}
+				reopened.repair(42);
+				cout << "After repairing it, torn: " << reopened.isTorn(42) << ", read only mapping reads "
+					<< reader.getRating(42) << "\n";
+
+				// a damaged header is refused
+				{
+					fstream file(path, ios::in | ios::out | ios::binary);
+					file.seekp(16);
+					file.write("\x01", 1);
+				}
+				try {
+					alg::EloStore damaged(path);
+				}
+				catch (exception& e) {
+					cout << "Opening a damaged store: " << e.what() << "\n";
+				}
+			}
+			remove(csvPath);
+			remove(path);
+		}
+		static void test_rating_index() {
+			cout << "Rating index test!\n";
+			const int players = 10000000;
+			vector<double> ratings(players);
+			mt19937 rng(13);
+			normal_distribution<double> distribution(1500.0, 300.0);
+			for (double& rating : ratings) rating = distribution(rng);
+
+			auto start = chrono::steady_clock::now();
+			alg::RatingIndex index(ratings.data(), players);
+			cout << "Indexing " << players << " players took "
+				<< chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << "ms\n";
+
+			vector<alg::RatedPlayer> top = index.leaderboard(0, 3);
+			cout << "Top 3:";
+			for (const alg::RatedPlayer& entry : top) cout << " " << entry.player << " (" << entry.rating << ")";
+			cout << "\nRank of player 0 (" << ratings[0] << "): " << index.rankOf(0) << "\n";
+			vector<alg::RatedPlayer> close = index.nearest(2000.0, 3);
+			cout << "3 players closest to 2000:";
+			for (const alg::RatedPlayer& entry : close) cout << " " << entry.player << " (" << entry.rating << ")";
+			cout << "\n";
+
+			// the same queries as linear scans over the rating array
+			const int queries = 1000;
+			start = chrono::steady_clock::now();
+			double rankSum = 0;
+			for (int q = 0; q < queries; q++) rankSum += index.rankOf((int)(rng() % players));
+			double rankTime = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / queries;
+			start = chrono::steady_clock::now();
+			for (int q = 0; q < queries; q++) index.nearest(distribution(rng), 10);
+			double nearestTime = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / queries;
+			start = chrono::steady_clock::now();
+			for (int q = 0; q < queries; q++) index.leaderboard((int)(rng() % 100000), 50);
+			double pageTime = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / queries;
+
+			start = chrono::steady_clock::now();
+			int player = (int)(rng() % players);
+			int scanRank = 1;
+			for (int i = 0; i < players; i++) {
+				scanRank += ratings[i] > ratings[player] || (ratings[i] == ratings[player] && i < player);
+			}
+			double scanTime = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+			cout << "Per query: rankOf " << rankTime << "us (average rank " << rankSum / queries << "), nearest(10) " << nearestTime << "us, leaderboard page of 50 "
+				<< pageTime << "us; rank by linear scan " << scanTime << "us (rank " << scanRank << ", index says "
+				<< index.rankOf(player) << ")\n";
+
+			// one thread applies games for two seconds while others query
+			const int readers = 3;
+			atomic<bool> done(false);
+			atomic<long long> queryCount(0);
+			vector<thread> threads;
+			for (int t = 0; t < readers; t++) {
+				threads.push_back(thread([&, t]() {
+					mt19937 readRng(100 + t);
+					long long local = 0;
+					while (!done.load()) {
+						index.rankOf((int)(readRng() % players));
+						index.nearest(1000.0 + readRng() % 1000, 10);
+						local += 2;
+					}
+					queryCount += local;
+				}));
+			}
+			long long games = 0;
+			start = chrono::steady_clock::now();
+			double elapsed = 0;
+			while (elapsed < 2.0) {
+				int a = (int)(rng() % players);
+				int b = (int)((a + 1 + rng() % (players - 1)) % players);
+				index.applyGame(a, b, (rng() % 3) * 0.5);
+				games++;
+				elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			}
+			done = true;
+			for (thread& t : threads) t.join();
+			cout << "With " << readers << " threads querying: " << games / elapsed / 1e3 << "k games applied/s, "
+				<< queryCount.load() / elapsed / 1e3 << "k queries/s\n";
+
+			// the index still agrees with the ratings after the updates
+			bool consistent = true;
+			for (int rank = 1; rank <= 1000; rank++) {
+				alg::RatedPlayer entry = index.selectKth(rank);
+				consistent = consistent && index.rankOf(entry.player) == rank && index.getRating(entry.player) == entry.rating;
+			}
+			cout << "Ranks consistent after the updates: " << (consistent ? "yes" : "no") << "\n";
 		}
+
+		static void test_instrumentation() {
+			cout << "Instrumentation test!\n";
+			if (!alg::INSTRUMENTATION_ENABLED) {
+				cout << "Instrumentation is compiled out (build with ALG_INSTRUMENTATION=1); counters stay at zero\n";
+			}
+			alg::ResetInstrumentation();
+
+			// a BST fed sorted keys degenerates into a list: every insert walks all the nodes
+			const int size = 2000;
+			vector<int> keys(size);
+			for (int i = 0; i < size; i++) keys[i] = i;
+			{
+				alg::BST<int, int> degenerate;
+				for (int key : keys) degenerate.insert(key, key);
+				for (int key : keys) degenerate.getValue(key);
+			}
+			alg::InstrumentationSnapshot sorted = alg::TakeInstrumentationSnapshot();
+
+			alg::ResetInstrumentation();
+			shuffle(keys.begin(), keys.end(), mt19937(3));
+			{
+				alg::BST<int, int> random;
+				for (int key : keys) random.insert(key, key);
+				for (int key : keys) random.getValue(key);
+			}
+			alg::InstrumentationSnapshot shuffled = alg::TakeInstrumentationSnapshot();
+
+			const alg::HistogramSnapshot& sortedFind = sorted.get(alg::Histogram::BSTFindVisits);
+			const alg::HistogramSnapshot& shuffledFind = shuffled.get(alg::Histogram::BSTFindVisits);
+			cout << "Nodes visited per lookup, sorted inserts: mean " << sortedFind.mean() << ", p99 <= "
+				<< sortedFind.percentile(0.99) << ", max " << sortedFind.max << "\n";
+			cout << "Nodes visited per lookup, shuffled inserts: mean " << shuffledFind.mean() << ", p99 <= "
+				<< shuffledFind.percentile(0.99) << ", max " << shuffledFind.max << "\n";
+			cout << "BST nodes allocated: " << shuffled.get(alg::Counter::BSTAllocations) << "\n";
+
+			alg::ResetInstrumentation();
+			vector<int> reversed(1000);
+			for (int i = 0; i < 1000; i++) reversed[i] = 1000 - i;
+			vector<int> copy = reversed;
+			alg::BubbleSort(copy.data(), 0, 999);
+			alg::InstrumentationSnapshot bubble = alg::TakeInstrumentationSnapshot();
+			cout << "BubbleSort of 1000 reversed ints: " << bubble.get(alg::Histogram::BubbleSortPasses).max << " passes, "
+				<< bubble.get(alg::Counter::SortComparisons) << " comparisons, " << bubble.get(alg::Counter::SortSwaps) << " swaps\n";
+
+			alg::ResetInstrumentation();
+			copy = reversed;
+			alg::Sort(copy.begin(), copy.end(), less<int>());
+			alg::InstrumentationSnapshot pdq = alg::TakeInstrumentationSnapshot();
+			cout << "Sort of the same: " << pdq.get(alg::Counter::SortComparisons) << " comparisons, "
+				<< pdq.get(alg::Counter::SortSwaps) << " swaps\n";
+
+			alg::ResetInstrumentation();
+			alg::Stack<int, 4> fixed;
+			for (int i = 0; i < 6; i++) fixed.push(i);
+			alg::Queue<int> queue(4);
+			for (int i = 0; i < 6; i++) queue.enqueue(i);
+			try {
+				alg::Stack<int> growing;
+				growing.pop();
+			}
+			catch (exception&) {}
+			alg::LinkedList<int> list;
+			for (int i = 0; i < 10; i++) list.pushLast(i);
+			cout << alg::TakeInstrumentationSnapshot().toString();
+		}
+
+		static void test_memory_usage() {
+			cout << "Memory usage test!\n";
+			const int size = 100000;
+
+			alg::Stack<int> stack;
+			for (int i = 0; i < size; i++) stack.push(i);
+			cout << "Stack<int>: " << stack.memoryUsage().toString() << "\n";
+			alg::Stack<int, 64> fixed;
+			for (int i = 0; i < 10; i++) fixed.push(i);
+			cout << "Stack<int, 64> holding 10: " << fixed.memoryUsage().toString() << "\n";
+			alg::Queue<int> queue(size);
+			for (int i = 0; i < size / 2; i++) queue.enqueue(i);
+			cout << "Queue<int> half full: " << queue.memoryUsage().toString() << "\n";
+
+			alg::BST<int, int> pooled;
+			alg::LinkedList<int> list;
+			mt19937 rng(5);
+			for (int i = 0; i < size; i++) {
+				pooled.insert((int)rng(), i);
+				list.push(i);
+			}
+			cout << "BST<int, int>: " << pooled.memoryUsage().toString() << "\n";
+			cout << "LinkedList<int>: " << list.memoryUsage().toString() << "\n";
+
+			// nodes on the heap, every allocation recorded
+			alg::MemoryStats stats;
+			{
+				typedef alg::TrackingAllocator<int> Tracked;
+				alg::BST<int, int, Tracked> tracked;
+				for (int i = 0; i < size; i++) tracked.insert((int)rng(), i);
+				cout << "BST<int, int, TrackingAllocator>: " << tracked.memoryUsage().toString() << "\n";
+				cout << "Tracked through the global stats: " << alg::GlobalMemoryStats().getCurrentBytes() << " bytes now\n";
+			}
+			{
+				alg::TrackingAllocator<int> allocator(stats);
+				alg::LinkedList<int, alg::TrackingAllocator<int>> tracked(allocator);
+				for (int i = 0; i < size; i++) tracked.push(i);
+				for (int i = 0; i < size / 2; i++) tracked.pop();
+				cout << "LinkedList with its own stats after " << size << " pushes and " << size / 2 << " pops: "
+					<< stats.getCurrentBytes() << " bytes now, peak " << stats.getPeakBytes() << ", "
+					<< stats.getAllocationCount() << " allocations\n";
+			}
+			cout << "After destroying it: " << stats.getCurrentBytes() << " bytes, "
+				<< stats.getDeallocationCount() << " deallocations\n";
+		}
+
+		static void test_snapshot() {
+			cout << "Snapshot test!\n";
+			const char* path = "snapshot_test.bin";
+
+			alg::Stack<int> stack;
+			for (int i = 0; i < 5; i++) stack.push(i);
+			alg::SaveSnapshot(stack, path);
+			alg::Stack<int> restoredStack;
+			alg::LoadSnapshot(path, restoredStack);
+			cout << "Stack of 5 restored, top " << restoredStack.peek() << ", size " << restoredStack.getSize() << "\n";
+
+			// a queue that wrapped around its ring
+			alg::Queue<int> queue(4);
+			for (int i = 0; i < 4; i++) queue.enqueue(i);
+			queue.dequeue();
+			queue.dequeue();
+			queue.enqueue(4);
+			alg::SaveSnapshot(queue, path);
+			alg::Queue<int> restoredQueue(8);
+			alg::LoadSnapshot(path, restoredQueue);
+			cout << "Queue restored:";
+			while (!restoredQueue.is_empty()) cout << " " << restoredQueue.dequeue();
+			cout << "\n";
+
+			alg::LinkedList<int> list;
+			for (int i = 0; i < 5; i++) list.pushLast(i * i);
+			alg::SaveSnapshot(list, path);
+			alg::MappedSnapshot<int> mappedList(path);
+			cout << "LinkedList mapped without loading:";
+			for (int value : mappedList) cout << " " << value;
+			cout << "\n";
+
+			try {
+				alg::LoadSnapshot(path, restoredStack);
+			}
+			catch (const alg::SnapshotException& e) {
+				cout << "Loading the list into a stack: " << e.what() << "\n";
+			}
+			try {
+				alg::MappedSnapshot<double> wrongType(path);
+			}
+			catch (const alg::SnapshotException& e) {
+				cout << "Mapping it as doubles: " << e.what() << "\n";
+			}
+
+			alg::BST<int, int> bst;
+			array<int, 10> numbers = { 5, 2, 8, 1, 9, 3, 7, 4, 0, 6 };
+			for (int i = 0; i < (int)numbers.size(); i++) bst.insert(numbers[i], i);
+			alg::SaveSnapshot(bst, path);
+			{
+				alg::MappedBST<int, int> mapped(path);
+				cout << "BST mapped (" << (mapped.verify() ? "checksum ok" : "checksum wrong") << "):";
+				mapped.forEach([](const int& key, const int& value) { cout << " " << key << ": " << value; });
+				cout << "\nValue of 3: " << mapped.getValue(3) << "; contains 10: " << (mapped.contains(10) ? "yes" : "no") << "\n";
+			}
+			alg::BST<int, int> restoredBST;
+			alg::LoadSnapshot(path, restoredBST);
+			cout << "BST loaded back, balanced:\n" << restoredBST.toString();
+
+			// one flipped byte in the payload, then a truncated file
+			{
+				fstream file(path, ios::in | ios::out | ios::binary);
+				file.seekp(64 + sizeof(int) * 3);
+				file.put((char)0x7f);
+			}
+			cout << "After flipping a byte: " << (alg::MappedBST<int, int>(path).verify() ? "checksum ok" : "checksum wrong") << "\n";
+			{
+				ofstream file(path, ios::binary | ios::trunc);
+				file.write("ALGSNAP", 8);
+			}
+			try {
+				alg::MappedBST<int, int> truncated(path);
+			}
+			catch (const alg::SnapshotException& e) {
+				cout << "Opening a truncated snapshot: " << e.what() << "\n";
+			}
+
+			// restart of a large index: insert every key again, bulk load the snapshot, or map it
+			const int size = 2000000;
+			vector<int> keys(size);
+			for (int i = 0; i < size; i++) keys[i] = 2 * i;
+			alg::BST<int, int> tree;
+			tree.bulkLoad(keys.data(), keys.data(), size);
+			auto start = chrono::steady_clock::now();
+			alg::SaveSnapshot(tree, path);
+			double saveTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+			shuffle(keys.begin(), keys.end(), mt19937(6));
+			start = chrono::steady_clock::now();
+			alg::BST<int, int> inserted;
+			for (int key : keys) inserted.insert(key, key);
+			double insertTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+			start = chrono::steady_clock::now();
+			alg::BST<int, int> loaded;
+			alg::LoadSnapshot(path, loaded);
+			double loadTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+			start = chrono::steady_clock::now();
+			alg::MappedBST<int, int> mapped(path);
+			double mapTime = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+			long long sum = 0;
+			for (int i = 0; i < 1000; i++) sum += mapped.getValue(keys[i]);
+			double firstLookups = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+			bool same = loaded.getSize() == (size_t)size;
+			for (int i = 0; i < size; i += 97) {
+				same = same && loaded.getValue(keys[i]) == keys[i] && mapped.getValue(keys[i]) == keys[i];
+			}
+			cout << "Snapshot of " << size << " keys written in " << saveTime << "ms; restart by inserting " << insertTime
+				<< "ms, by loading the snapshot " << loadTime << "ms, by mapping it " << mapTime << "ms ("
+				<< firstLookups << "ms with the first 1000 lookups); contents " << (same && sum > 0 ? "match" : "differ") << "\n";
+			remove(path);
+		}
+
 	};
 }
@@ -0,0 +1,208 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// small work-stealing thread pool
+// every worker owns a deque: it pushes and pops its own tasks at the back (newest first, which
+// keeps the working set hot) and steals from the front of the others when it runs dry
+// https://en.wikipedia.org/wiki/Work_stealing
+
+namespace alg {
+	class ThreadPool {
+	private:
+		typedef std::function<void()> Task;
+
+		struct WorkQueue {
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		// one queue per worker plus a shared one (the last) for threads outside the pool
+		std::vector<std::unique_ptr<WorkQueue>> m_queues;
+		std::vector<std::thread> m_threads;
+
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wake;
+		int m_queued; // number of tasks sitting in the queues, guarded by m_sleepMutex
+		bool m_stop;
+
+		// which pool and queue the current thread works for
+		static ThreadPool*& currentPool() {
+			thread_local ThreadPool* pool = nullptr;
+			return pool;
+		}
+
+		static int& currentIndex() {
+			thread_local int index = -1;
+			return index;
+		}
+
+		int ownQueue() {
+			return currentPool() == this ? currentIndex() : (int)m_queues.size() - 1;
+		}
+
+		bool popFrom(int index, bool back, Task& task) {
+			WorkQueue& queue = *m_queues[index];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.tasks.empty()) return false;
+
+			if (back) {
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+			}
+			else {
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+			}
+			return true;
+		}
+
+		void workerLoop(int index) {
+			currentPool() = this;
+			currentIndex() = index;
+
+			while (true) {
+				if (runPendingTask()) continue;
+
+				std::unique_lock<std::mutex> lock(m_sleepMutex);
+				m_wake.wait(lock, [this] { return m_stop || m_queued > 0; });
+				if (m_stop && m_queued == 0) return;
+			}
+		}
+
+	public:
+		/* Starts <threads> worker threads
+		* Note: threads that wait on a TaskGroup help run tasks, so a pool with 0 workers is
+		* valid and simply runs everything on the waiting thread
+		*/
+		ThreadPool(int threads) {
+			m_queued = 0;
+			m_stop = false;
+
+			if (threads < 0) threads = 0;
+			for (int i = 0; i <= threads; i++) {
+				m_queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue));
+			}
+			for (int i = 0; i < threads; i++) {
+				m_threads.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+			}
+		}
+
+		// waits for the queued tasks to finish and joins the workers
+		~ThreadPool() {
+			{
+				std::lock_guard<std::mutex> lock(m_sleepMutex);
+				m_stop = true;
+			}
+			m_wake.notify_all();
+
+			for (std::thread& thread : m_threads) {
+				thread.join();
+			}
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		/* Queue a task; tasks submitted from a worker go to that worker's own deque
+		*/
+		void submit(Task task) {
+			WorkQueue& queue = *m_queues[ownQueue()];
+			{
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				queue.tasks.push_back(std::move(task));
+			}
+			{
+				std::lock_guard<std::mutex> lock(m_sleepMutex);
+				m_queued++;
+			}
+			m_wake.notify_one();
+		}
+
+		/* Run one queued task on the calling thread: the newest task of its own queue, or
+		* else the oldest task stolen from another queue
+		* @return true if a task was run
+		*/
+		bool runPendingTask() {
+			int own = ownQueue();
+			int count = (int)m_queues.size();
+			Task task;
+
+			bool found = popFrom(own, true, task);
+			for (int i = 1; i < count && !found; i++) {
+				found = popFrom((own + i) % count, false, task);
+			}
+			if (!found) return false;
+
+			{
+				std::lock_guard<std::mutex> lock(m_sleepMutex);
+				m_queued--;
+			}
+			task();
+			return true;
+		}
+
+		inline int getThreadCount() const {
+			return (int)m_threads.size();
+		}
+	};
+
+	/* A set of tasks that can be waited on together (fork/join)
+	* The waiting thread keeps running pool tasks instead of blocking, so nested groups
+	* cannot deadlock the pool.
+	*/
+	class TaskGroup {
+	private:
+		ThreadPool& m_pool;
+		std::atomic<int> m_pending;
+		std::mutex m_errorMutex;
+		std::exception_ptr m_error;
+
+	public:
+		TaskGroup(ThreadPool& pool) : m_pool(pool), m_pending(0) {}
+
+		~TaskGroup() {
+			// never leave tasks running that reference this group
+			while (m_pending.load(std::memory_order_acquire) > 0) {
+				if (!m_pool.runPendingTask()) std::this_thread::yield();
+			}
+		}
+
+		template <typename F>
+		void run(F task) {
+			m_pending.fetch_add(1, std::memory_order_relaxed);
+			m_pool.submit([this, task]() {
+				try {
+					task();
+				}
+				catch (...) {
+					std::lock_guard<std::mutex> lock(m_errorMutex);
+					if (!m_error) m_error = std::current_exception();
+				}
+				m_pending.fetch_sub(1, std::memory_order_release);
+			});
+		}
+
+		/* Wait for every task of the group
+		* Note: rethrows the first exception thrown by a task
+		*/
+		void wait() {
+			while (m_pending.load(std::memory_order_acquire) > 0) {
+				if (!m_pool.runPendingTask()) std::this_thread::yield();
+			}
+
+			if (m_error) {
+				std::exception_ptr error = m_error;
+				m_error = nullptr;
+				std::rethrow_exception(error);
+			}
+		}
+	};
+}
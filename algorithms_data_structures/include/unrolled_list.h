@@ -0,0 +1,408 @@
+#pragma once
+#include "node_pool.h"
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+// unrolled doubly linked list
+// every node holds up to ELEMENTS_PER_NODE elements in a small array sized to <NodeBytes>, so a
+// traversal touches one node (a few cache lines) per ELEMENTS_PER_NODE elements instead of one
+// scattered node per element, and the two links are paid once per node.
+// Inserting into a full node splits it in halves; a node that drops below half full after an
+// erase takes in its successor if they fit together, which keeps the nodes at least about half
+// full for inserts and erases in the middle. Pushing and popping at the ends is O(1) (shifting
+// at most one node's worth of elements).
+// https://en.wikipedia.org/wiki/Unrolled_linked_list
+
+namespace alg {
+	template <typename T, int NodeBytes = 256, typename Allocator = NodePool<T>>
+	class UnrolledList {
+	private:
+		class IndexOutOfBoundsException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "unrolled list index out of bounds";
+			}
+		} exception_ioob;
+
+		class StackEmptyException : public std::exception {
+		public:
+			virtual const char* what() const throw() {
+				return "popping from an empty unrolled list";
+			}
+		} exception_empty;
+
+		// fit as many elements as possible into NodeBytes, but at least 4
+		// (an enum so the constants are never odr-used)
+		enum {
+			FITTING = (NodeBytes - 2 * sizeof(void*) - sizeof(int)) / sizeof(T),
+			ELEMENTS_PER_NODE = FITTING < 4 ? 4 : FITTING
+		};
+
+		struct Node {
+			Node* next;
+			Node* previous;
+			int count; // the first <count> elements are constructed
+			alignas(T) unsigned char storage[sizeof(T) * ELEMENTS_PER_NODE];
+
+			inline T* elements() {
+				return reinterpret_cast<T*>(storage);
+			}
+		};
+
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Node> NodeAllocator;
+
+		Node* m_head;
+		Node* m_tail;
+		unsigned int m_size;
+		NodeAllocator m_allocator;
+
+		Node* createNode() {
+			Node* node = m_allocator.allocate(1);
+			node->next = nullptr;
+			node->previous = nullptr;
+			node->count = 0;
+			return node;
+		}
+
+		void destroyNode(Node* node) {
+			T* elements = node->elements();
+			for (int i = 0; i < node->count; i++) elements[i].~T();
+			m_allocator.deallocate(node, 1);
+		}
+
+		/* Link the empty node <node> right after <previous> (at the front if that is nullptr)
+		*/
+		void linkAfter(Node* previous, Node* node) {
+			node->previous = previous;
+			node->next = previous == nullptr ? m_head : previous->next;
+			if (node->next == nullptr) {
+				m_tail = node;
+			}
+			else {
+				node->next->previous = node;
+			}
+			if (previous == nullptr) {
+				m_head = node;
+			}
+			else {
+				previous->next = node;
+			}
+		}
+
+		void unlinkNode(Node* node) {
+			if (node->previous == nullptr) {
+				m_head = node->next;
+			}
+			else {
+				node->previous->next = node->next;
+			}
+			if (node->next == nullptr) {
+				m_tail = node->previous;
+			}
+			else {
+				node->next->previous = node->previous;
+			}
+			destroyNode(node);
+		}
+
+		/* Move elements [from, from + count) of <source> to the end of <target>
+		*/
+		static void moveElements(Node* source, int from, int count, Node* target) {
+			T* src = source->elements() + from;
+			T* dst = target->elements() + target->count;
+			for (int i = 0; i < count; i++) {
+				new (&dst[i]) T(std::move(src[i]));
+				src[i].~T();
+			}
+			target->count += count;
+		}
+
+		/* Open a gap at <index> in a node that is not full
+		*/
+		static void openGap(Node* node, int index) {
+			T* elements = node->elements();
+			if (index == node->count) return;
+			new (&elements[node->count]) T(std::move(elements[node->count - 1]));
+			for (int i = node->count - 1; i > index; i--) elements[i] = std::move(elements[i - 1]);
+			elements[index].~T();
+		}
+
+		/* Close the gap left by the destroyed element at <index>
+		*/
+		static void closeGap(Node* node, int index) {
+			T* elements = node->elements();
+			if (index == node->count - 1) return;
+			new (&elements[index]) T(std::move(elements[index + 1]));
+			for (int i = index + 1; i < node->count - 1; i++) elements[i] = std::move(elements[i + 1]);
+			elements[node->count - 1].~T();
+		}
+
+		/* Find the node holding element <index>, which has to exist
+		* @param offset set to the position of the element inside the node
+		*/
+		Node* locate(unsigned int index, int& offset) {
+			Node* node;
+			if (index < m_size / 2) {
+				node = m_head;
+				while (index >= (unsigned int)node->count) {
+					index -= node->count;
+					node = node->next;
+				}
+			}
+			else {
+				// closer to the back
+				unsigned int fromBack = m_size - 1 - index;
+				node = m_tail;
+				while (fromBack >= (unsigned int)node->count) {
+					fromBack -= node->count;
+					node = node->previous;
+				}
+				index = node->count - 1 - fromBack;
+			}
+			offset = (int)index;
+			return node;
+		}
+
+		/* Construct an element from <value> at <offset> of <node>, splitting the node if it is full
+		*/
+		template <typename V>
+		void insertAt(Node* node, int offset, V&& value) {
+			if (node->count == ELEMENTS_PER_NODE) {
+				Node* second = createNode();
+				linkAfter(node, second);
+				int half = ELEMENTS_PER_NODE / 2;
+				moveElements(node, half, ELEMENTS_PER_NODE - half, second);
+				node->count = half;
+				if (offset > half) {
+					offset -= half;
+					node = second;
+				}
+			}
+
+			openGap(node, offset);
+			new (&node->elements()[offset]) T(std::forward<V>(value));
+			node->count++;
+			m_size++;
+		}
+
+		/* Destroy the element at <offset> of <node>, then unlink the node if it ran empty or take
+		* in its successor if it ran below half full and both fit in one node
+		*/
+		void eraseAt(Node* node, int offset) {
+			node->elements()[offset].~T();
+			closeGap(node, offset);
+			node->count--;
+			m_size--;
+
+			if (node->count == 0) {
+				unlinkNode(node);
+			}
+			else if (node->count < ELEMENTS_PER_NODE / 2 && node->next != nullptr &&
+				node->count + node->next->count <= ELEMENTS_PER_NODE) {
+				Node* next = node->next;
+				moveElements(next, 0, next->count, node);
+				next->count = 0;
+				unlinkNode(next);
+			}
+		}
+
+		void destruct(Node* node, std::false_type) {
+			while (node != nullptr) {
+				Node* next = node->next;
+				destroyNode(node);
+				node = next;
+			}
+		}
+
+		// nothing to destroy, so drop the whole pool at once
+		void destruct(Node*, std::true_type) {
+			m_allocator.release();
+		}
+
+	public:
+		/* Forward iterator over the elements, front to back
+		*/
+		class iterator {
+		private:
+			friend class UnrolledList;
+			Node* m_node;
+			int m_offset;
+
+			iterator(Node* node, int offset) : m_node(node), m_offset(offset) {}
+
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef T value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef T* pointer;
+			typedef T& reference;
+
+			iterator() : m_node(nullptr), m_offset(0) {}
+
+			inline T& operator*() const {
+				return m_node->elements()[m_offset];
+			}
+
+			inline T* operator->() const {
+				return &m_node->elements()[m_offset];
+			}
+
+			iterator& operator++() {
+				if (++m_offset == m_node->count) {
+					m_node = m_node->next;
+					m_offset = 0;
+				}
+				return *this;
+			}
+
+			inline bool operator==(const iterator& other) const {
+				return m_node == other.m_node && m_offset == other.m_offset;
+			}
+
+			inline bool operator!=(const iterator& other) const {
+				return !(*this == other);
+			}
+		};
+
+		UnrolledList() {
+			m_head = nullptr;
+			m_tail = nullptr;
+			m_size = 0;
+		}
+
+		~UnrolledList() {
+			clear();
+		}
+
+		UnrolledList(const UnrolledList&) = delete;
+		UnrolledList& operator=(const UnrolledList&) = delete;
+
+		/* Removes every element
+		* Note: O(slabs) rather than O(n) with a NodePool and a trivially destructible T
+		*/
+		void clear() {
+			typedef std::integral_constant<bool, node_pool_detail::ReleasesInBulk<NodeAllocator>::value &&
+				std::is_trivially_destructible<T>::value> ReleaseAll;
+			destruct(m_head, ReleaseAll());
+			m_head = nullptr;
+			m_tail = nullptr;
+			m_size = 0;
+		}
+
+		/* Pushes an element to the front of the list
+		*/
+		void push(T data) {
+			if (m_head == nullptr) linkAfter(nullptr, createNode());
+			insertAt(m_head, 0, std::move(data));
+		}
+
+		/* Pushes an element to the back of the list
+		*/
+		void pushLast(T data) {
+			if (m_tail == nullptr || m_tail->count == ELEMENTS_PER_NODE) linkAfter(m_tail, createNode());
+			insertAt(m_tail, m_tail->count, std::move(data));
+		}
+
+		/* Inserts an element so that it ends up at <index>; O(n / ELEMENTS_PER_NODE) to find
+		* the node
+		*/
+		void insert(unsigned int index, T data) {
+			if (index > m_size) throw exception_ioob;
+			if (index == m_size) {
+				pushLast(std::move(data));
+				return;
+			}
+			int offset;
+			Node* node = locate(index, offset);
+			insertAt(node, offset, std::move(data));
+		}
+
+		/* Removes the first element
+		* @return the first element in the list
+		*/
+		T pop() {
+			if (m_head == nullptr) throw exception_empty;
+			T data = std::move(m_head->elements()[0]);
+			eraseAt(m_head, 0);
+			return data;
+		}
+
+		/* Removes the last element
+		* @return the last element in the list
+		*/
+		T popLast() {
+			if (m_tail == nullptr) throw exception_empty;
+			T data = std::move(m_tail->elements()[m_tail->count - 1]);
+			eraseAt(m_tail, m_tail->count - 1);
+			return data;
+		}
+
+		/* Removes the element at <index>
+		*/
+		void erase(unsigned int index) {
+			if (index >= m_size) throw exception_ioob;
+			int offset;
+			Node* node = locate(index, offset);
+			eraseAt(node, offset);
+		}
+
+		/* Return the element at <index>; O(n / ELEMENTS_PER_NODE)
+		*/
+		T& operator [] (unsigned int index) {
+			if (index >= m_size) throw exception_ioob;
+			int offset;
+			Node* node = locate(index, offset);
+			return node->elements()[offset];
+		}
+
+		inline T& peek() {
+			if (m_size == 0) throw exception_empty;
+			return m_head->elements()[0];
+		}
+
+		inline T& peekLast() {
+			if (m_size == 0) throw exception_empty;
+			return m_tail->elements()[m_tail->count - 1];
+		}
+
+		inline bool isEmpty() const {
+			return m_size == 0;
+		}
+
+		inline unsigned int getSize() const {
+			return m_size;
+		}
+
+		inline static int getElementsPerNode() {
+			return ELEMENTS_PER_NODE;
+		}
+
+		iterator begin() {
+			return iterator(m_head, 0);
+		}
+
+		iterator end() {
+			return iterator(nullptr, 0);
+		}
+
+		// WARNING: make sure std::to_string works on type T
+		std::string toString() {
+			std::string str;
+			if (m_head == nullptr) return "unrolled list is empty\n";
+			for (Node* node = m_head; node != nullptr; node = node->next) {
+				str += "[";
+				for (int i = 0; i < node->count; i++) {
+					if (i > 0) str += ", ";
+					str += std::to_string(node->elements()[i]);
+				}
+				str += node->next == nullptr ? "]\n" : "]->";
+			}
+			return str;
+		}
+	};
+}
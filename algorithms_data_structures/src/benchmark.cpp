@@ -0,0 +1,374 @@
+#include "../include/benchmark.h"
+#include "../include/binary_search_tree.h"
+#include "../include/bubble_sort.h"
+#include "../include/elo.h"
+#include "../include/linked_list.h"
+#include "../include/memory_usage.h"
+#include "../include/queue.h"
+#include "../include/sort.h"
+#include "../include/stack.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// benchmark suite: every container and algorithm over the input sizes and distributions that
+// matter to it, written as JSON (see include/benchmark.h)
+// the container benchmarks tick a LatencyRecorder after every operation, which gives their p99;
+// sorts and the batch Elo replay are one call per run and only report the spread of their runs
+// usage: benchmark [--filter=text] [--runs=n] [--warmup=n] [--quick] [--out=file.json]
+//                  [--baseline=file.json] [--threshold=0.1]
+//        benchmark --memory [--quick]
+// with a baseline, the exit code is 1 if any benchmark got slower than it by more than the
+// threshold or the baseline can not be read, so CI can fail on it
+// --memory prints the memory footprint of every container at 1K, 1M and 10M elements instead
+
+using namespace alg;
+
+static const Distribution ALL_DISTRIBUTIONS[] = {
+	Distribution::Random, Distribution::Sorted, Distribution::Reversed, Distribution::FewUnique
+};
+
+static void benchmarkSort(BenchmarkRunner& runner, bool quick) {
+	std::vector<int> sizes = quick ? std::vector<int>{ 1000, 100000 } : std::vector<int>{ 1000, 100000, 1000000 };
+	for (int size : sizes) {
+		for (Distribution distribution : ALL_DISTRIBUTIONS) {
+			std::vector<int> input = MakeInput(size, distribution);
+			auto copy = [&]() { return input; };
+
+			runner.run("sort/Sort", distribution, size, size, copy, [size](std::vector<int>& data) {
+				Sort(data.data(), 0, size - 1);
+				return data[size / 2];
+			});
+			runner.run("sort/StableSort", distribution, size, size, copy, [size](std::vector<int>& data) {
+				StableSort(data.data(), 0, size - 1);
+				return data[size / 2];
+			});
+			runner.run("sort/std::sort", distribution, size, size, copy, [size](std::vector<int>& data) {
+				std::sort(data.begin(), data.end());
+				return data[size / 2];
+			});
+			if (size <= 1000) {
+				// quadratic
+				runner.run("sort/BubbleSort", distribution, size, size, copy, [size](std::vector<int>& data) {
+					BubbleSort(data.data(), 0, size - 1);
+					return data[size / 2];
+				});
+			}
+		}
+	}
+}
+
+static void benchmarkStack(BenchmarkRunner& runner, bool quick) {
+	for (int size : { 1000, quick ? 100000 : 1000000 }) {
+		std::vector<int> input = MakeInput(size, Distribution::Random);
+		auto copy = [&]() { return input; };
+
+		// one push plus one pop per element
+		runner.run("stack/push_pop", Distribution::Random, size, 2LL * size, copy, [](std::vector<int>& data, LatencyRecorder& recorder) {
+			Stack<int> stack;
+			for (int value : data) {
+				stack.push(value);
+				recorder.tick();
+			}
+			long long sum = 0;
+			while (!stack.is_empty()) {
+				sum += stack.pop();
+				recorder.tick();
+			}
+			return sum;
+		});
+		runner.run("stack/push_pop_reserved", Distribution::Random, size, 2LL * size, copy, [size](std::vector<int>& data, LatencyRecorder& recorder) {
+			Stack<int> stack(size);
+			for (int value : data) {
+				stack.push(value);
+				recorder.tick();
+			}
+			long long sum = 0;
+			while (!stack.is_empty()) {
+				sum += stack.pop();
+				recorder.tick();
+			}
+			return sum;
+		});
+	}
+}
+
+static void benchmarkQueue(BenchmarkRunner& runner, bool quick) {
+	for (int size : { 1000, quick ? 100000 : 1000000 }) {
+		std::vector<int> input = MakeInput(size, Distribution::Random);
+		auto copy = [&]() { return input; };
+
+		runner.run("queue/enqueue_dequeue", Distribution::Random, size, 2LL * size, copy, [size](std::vector<int>& data, LatencyRecorder& recorder) {
+			Queue<int> queue(size);
+			for (int value : data) {
+				queue.enqueue(value);
+				recorder.tick();
+			}
+			long long sum = 0;
+			while (!queue.is_empty()) {
+				sum += queue.dequeue();
+				recorder.tick();
+			}
+			return sum;
+		});
+		// a small ring that wraps around many times
+		runner.run("queue/ring_64", Distribution::Random, size, 2LL * size, copy, [](std::vector<int>& data, LatencyRecorder& recorder) {
+			Queue<int, true> queue(64);
+			long long sum = 0;
+			// one enqueue and, sooner or later, one dequeue per element
+			for (int value : data) {
+				if (!queue.enqueue(value)) {
+					sum += queue.dequeue();
+					queue.enqueue(value);
+				}
+				recorder.tick();
+				recorder.tick();
+			}
+			while (!queue.is_empty()) sum += queue.dequeue();
+			return sum;
+		});
+	}
+}
+
+static void benchmarkBST(BenchmarkRunner& runner, bool quick) {
+	typedef BST<int, int> Tree;
+	std::vector<int> sizes = quick ? std::vector<int>{ 1000, 10000 } : std::vector<int>{ 1000, 10000, 100000 };
+	for (int size : sizes) {
+		for (Distribution distribution : ALL_DISTRIBUTIONS) {
+			// sorted and reversed keys turn the unbalanced tree into a list: quadratic
+			if (size > 10000 && distribution != Distribution::Random) continue;
+
+			std::vector<int> keys = MakeInput(size, distribution);
+			runner.run("bst/insert", distribution, size, size, [&]() { return keys; }, [](std::vector<int>& data, LatencyRecorder& recorder) {
+				Tree tree;
+				for (int key : data) {
+					tree.insert(key, key);
+					recorder.tick();
+				}
+				return tree.getValue(data[0]);
+			});
+
+			// lookups in random order of the keys that are in the tree
+			std::vector<int> lookups = keys;
+			std::shuffle(lookups.begin(), lookups.end(), std::mt19937(2));
+			runner.run("bst/getValue", distribution, size, size, [&]() {
+				std::unique_ptr<Tree> tree(new Tree);
+				for (int key : keys) tree->insert(key, key);
+				return tree;
+			}, [&](std::unique_ptr<Tree>& tree, LatencyRecorder& recorder) {
+				long long sum = 0;
+				for (int key : lookups) {
+					sum += tree->getValue(key);
+					recorder.tick();
+				}
+				return sum;
+			});
+
+			if (distribution == Distribution::Random) {
+				runner.run("bst/frozen_find", distribution, size, size, [&]() {
+					Tree tree;
+					for (int key : keys) tree.insert(key, key);
+					return tree.freeze();
+				}, [&](FrozenBST<int, int>& frozen, LatencyRecorder& recorder) {
+					long long sum = 0;
+					for (int key : lookups) {
+						int value = 0;
+						frozen.find(key, value);
+						sum += value;
+						recorder.tick();
+					}
+					return sum;
+				});
+			}
+		}
+	}
+}
+
+static void benchmarkLinkedList(BenchmarkRunner& runner, bool quick) {
+	for (int size : { 1000, quick ? 100000 : 1000000 }) {
+		std::vector<int> input = MakeInput(size, Distribution::Random);
+		auto copy = [&]() { return input; };
+
+		runner.run("linked_list/push_pop", Distribution::Random, size, 2LL * size, copy, [](std::vector<int>& data, LatencyRecorder& recorder) {
+			LinkedList<int> list;
+			for (int value : data) {
+				list.push(value);
+				recorder.tick();
+			}
+			long long sum = 0;
+			while (!list.isEmpty()) {
+				sum += list.pop();
+				recorder.tick();
+			}
+			return sum;
+		});
+		runner.run("linked_list/pushLast_pop", Distribution::Random, size, 2LL * size, copy, [](std::vector<int>& data, LatencyRecorder& recorder) {
+			LinkedList<int> list;
+			for (int value : data) {
+				list.pushLast(value);
+				recorder.tick();
+			}
+			long long sum = 0;
+			while (!list.isEmpty()) {
+				sum += list.pop();
+				recorder.tick();
+			}
+			return sum;
+		});
+	}
+}
+
+static void benchmarkElo(BenchmarkRunner& runner, bool quick) {
+	const int players = 10000;
+	for (int games : { 10000, quick ? 100000 : 1000000 }) {
+		std::vector<int> random = MakeInput(3 * games, Distribution::Random);
+		std::vector<int> playersA(games), playersB(games);
+		std::vector<double> resultsA(games);
+		for (int i = 0; i < games; i++) {
+			playersA[i] = random[3 * i] % players;
+			playersB[i] = (playersA[i] + 1 + random[3 * i + 1] % (players - 1)) % players;
+			resultsA[i] = (random[3 * i + 2] % 3) * 0.5;
+		}
+		auto fresh = [&]() { return std::vector<double>(players, 1500.0); };
+
+		runner.run("elo/EloEvaluate", Distribution::Random, games, games, fresh, [&](std::vector<double>& ratings, LatencyRecorder& recorder) {
+			for (int i = 0; i < games; i++) {
+				std::tuple<double, double> result = EloEvaluate(ratings[playersA[i]], ratings[playersB[i]], resultsA[i]);
+				ratings[playersA[i]] = std::get<0>(result);
+				ratings[playersB[i]] = std::get<1>(result);
+				recorder.tick();
+			}
+			return ratings[0];
+		});
+		runner.run("elo/EloEvaluateBatch", Distribution::Random, games, games, fresh, [&](std::vector<double>& ratings) {
+			EloEvaluateBatch(ratings.data(), playersA.data(), playersB.data(), resultsA.data(), games);
+			return ratings[0];
+		});
+	}
+}
+
+static void printMemoryUsage(const char* name, int size, const MemoryUsage& usage) {
+	std::printf("%-32s %9d  %8.2f bytes/element  %8.2f overhead/element  %12zu bytes (%zu allocated, %zu live)\n",
+		name, size, usage.bytesPerElement(), usage.overheadPerElement(), usage.totalBytes(), usage.allocatedBytes,
+		usage.liveBytes);
+}
+
+/* Fills every container with <size> elements and prints what it holds
+*/
+static void memoryBenchmark(int size) {
+	std::vector<int> keys = MakeInput(size, Distribution::Random);
+	{
+		Stack<int> stack;
+		for (int key : keys) stack.push(key);
+		printMemoryUsage("Stack<int>", size, stack.memoryUsage());
+	}
+	{
+		Stack<int> stack(size);
+		for (int key : keys) stack.push(key);
+		printMemoryUsage("Stack<int> reserved", size, stack.memoryUsage());
+	}
+	{
+		Queue<int> queue(size);
+		for (int key : keys) queue.enqueue(key);
+		printMemoryUsage("Queue<int>", size, queue.memoryUsage());
+	}
+	{
+		Queue<int, true> queue(size);
+		for (int key : keys) queue.enqueue(key);
+		printMemoryUsage("Queue<int, true>", size, queue.memoryUsage());
+	}
+	{
+		BST<int, int> tree;
+		for (int key : keys) tree.insert(key, key);
+		printMemoryUsage("BST<int, int>", size, tree.memoryUsage());
+	}
+	{
+		// the heap's own per block overhead is not visible from here and not included
+		BST<int, int, std::allocator<int>> tree;
+		for (int key : keys) tree.insert(key, key);
+		printMemoryUsage("BST<int, int> heap nodes", size, tree.memoryUsage());
+	}
+	{
+		LinkedList<int> list;
+		for (int key : keys) list.pushLast(key);
+		printMemoryUsage("LinkedList<int>", size, list.memoryUsage());
+	}
+	{
+		MemoryStats stats;
+		TrackingAllocator<int> allocator(stats);
+		LinkedList<int, TrackingAllocator<int>> list(allocator);
+		for (int key : keys) list.pushLast(key);
+		while (list.getSize() > (unsigned int)size / 2) list.pop();
+		printMemoryUsage("LinkedList<int> tracked, half", size, list.memoryUsage());
+		std::printf("%-32s %9d  peak %zu bytes, %zu allocations\n", "", size, stats.getPeakBytes(),
+			stats.getAllocationCount());
+	}
+}
+
+/* The value of --<name>=value in <argument>, or nullptr if it is a different option
+*/
+static const char* option(const char* argument, const char* name) {
+	size_t length = std::strlen(name);
+	if (std::strncmp(argument, "--", 2) != 0 || std::strncmp(argument + 2, name, length) != 0) return nullptr;
+	if (argument[2 + length] == '=') return argument + 3 + length;
+	return argument[2 + length] == 0 ? "" : nullptr;
+}
+
+int main(int argc, char* argv[])
+{
+	int runs = 15;
+	int warmup = 2;
+	bool quick = false;
+	bool memory = false;
+	double threshold = 0.1;
+	std::string filter, outPath, baselinePath;
+
+	for (int i = 1; i < argc; i++) {
+		const char* value;
+		if ((value = option(argv[i], "filter")) != nullptr) filter = value;
+		else if ((value = option(argv[i], "runs")) != nullptr) runs = std::atoi(value);
+		else if ((value = option(argv[i], "warmup")) != nullptr) warmup = std::atoi(value);
+		else if ((value = option(argv[i], "quick")) != nullptr) quick = true;
+		else if ((value = option(argv[i], "memory")) != nullptr) memory = true;
+		else if ((value = option(argv[i], "out")) != nullptr) outPath = value;
+		else if ((value = option(argv[i], "baseline")) != nullptr) baselinePath = value;
+		else if ((value = option(argv[i], "threshold")) != nullptr) threshold = std::atof(value);
+		else {
+			std::fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if (memory) {
+		std::vector<int> sizes = quick ? std::vector<int>{ 1000, 1000000 } : std::vector<int>{ 1000, 1000000, 10000000 };
+		for (int size : sizes) memoryBenchmark(size);
+		return 0;
+	}
+
+	BenchmarkRunner runner(runs, warmup, filter);
+	benchmarkSort(runner, quick);
+	benchmarkStack(runner, quick);
+	benchmarkQueue(runner, quick);
+	benchmarkBST(runner, quick);
+	benchmarkLinkedList(runner, quick);
+	benchmarkElo(runner, quick);
+
+	std::string json = runner.toJson();
+	if (outPath.empty()) {
+		std::fputs(json.c_str(), stdout);
+	}
+	else {
+		std::ofstream out(outPath);
+		out << json;
+	}
+
+	if (baselinePath.empty()) return 0;
+	int regressions = compareBenchmarks(runner.getResults(), baselinePath, threshold);
+	return regressions != 0 ? 1 : 0;
+}